@@ -0,0 +1,668 @@
+// Load generator for whole nodes: throughput and end-to-end latency of messages between
+// sender and receiver nodes on loopback.
+//
+// Every node is a child process with its own NetworkManager and logs, in a scratch directory
+// that also collects its stderr and is kept if the run fails.
+// Each sender connects to fanout receivers and sends them messages through
+// NetworkManager::sendMessage (direct mode, one call per receiver) or broadcastMessage
+// (broadcast mode). Senders stop on congestion until their peers catch up, so the queues
+// never overflow. With a rate, messages are stamped with the time they were due rather than
+// the time they went out, so a sender falling behind shows up as latency instead of hiding it.
+//
+// Receivers record the latency of every message from its stamp to its delivery to the
+// application, after decoding and logging. Senders and receivers share the host's monotonic
+// clock, so no clock synchronization is needed.
+//
+// Prints a summary on stderr and one JSON object with the configuration and results on stdout.
+//
+// Usage: ./p2p_bench [--senders=2] [--receivers=2] [--fanout=1] [--mode=direct|broadcast]
+//                    [--size=256] [--rate=0] [--messages=100000] [--duration=0] [--port=7000]
+//                    [--io-threads=1] [--durability=none|batched|message]
+//                    [--no-encryption] [--no-compression]
+//
+// size is the message content in bytes, rate is messages per second per sender (0 for as fast
+// as possible), and a sender stops after messages messages or duration seconds, whichever
+// comes first (duration 0 for no limit).
+
+#include "control/Json.h"
+#include "log/LogManager.h"
+#include "message/Message.h"
+#include "network/NetworkManager.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+    using control::Json;
+
+    // Benchmark configuration, from the command line.
+    struct Config {
+        std::size_t senders = 2;
+        std::size_t receivers = 2;
+        std::size_t fanout = 1;
+        bool broadcast = false;
+        std::size_t size = 256;
+        double rate = 0;
+        std::uint64_t messages = 100000;
+        double duration = 0;
+        unsigned short port = 7000;
+        std::size_t ioThreads = 1;
+        std::string durability = "batched";
+        bool encryption = true;
+        bool compression = true;
+    };
+
+    // Bytes at the start of every message holding its stamp, in hex nanoseconds.
+    constexpr std::size_t STAMP_SIZE = 16;
+
+    // How long nodes may take to start and connect, and how long receivers wait for
+    // stragglers once the senders are done.
+    constexpr auto STARTUP_TIMEOUT = std::chrono::seconds(120);
+    constexpr auto DRAIN_IDLE_TIMEOUT = std::chrono::seconds(5);
+
+    // Returns the monotonic clock in nanoseconds; the same clock in every process on the host.
+    std::int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    // Latency histogram with log-linear buckets: exact below 64 ns, then 64 buckets per power
+    // of two, so every recorded value is within 1.6% of its bucket. Safe to record into
+    // from several threads.
+    class Histogram {
+    public:
+        static constexpr int SUB_BITS = 6;
+        static constexpr std::size_t SUB_BUCKETS = 1u << SUB_BITS;
+        static constexpr std::size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+        void record(std::uint64_t value) {
+            counts_[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Returns the non-empty buckets as [index, count] pairs.
+        Json toJson() const {
+            Json out = Json(Json::Array());
+            for (std::size_t i = 0; i < BUCKETS; ++i) {
+                std::uint64_t count = counts_[i].load(std::memory_order_relaxed);
+                if (count > 0) {
+                    out.push(Json(Json::Array{Json(i), Json(count)}));
+                }
+            }
+            return out;
+        }
+
+        // Adds the buckets from toJson() of another histogram.
+        void merge(const Json& buckets) {
+            for (const auto& pair : buckets.asArray()) {
+                std::size_t index = static_cast<std::size_t>(pair.asArray().at(0).asInteger());
+                if (index < BUCKETS) {
+                    counts_[index].fetch_add(pair.asArray().at(1).asInteger(), std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Returns the value below which a fraction q of the recorded values lie, or 0 if empty.
+        double percentile(double q) const {
+            std::uint64_t total = 0;
+            for (const auto& count : counts_) {
+                total += count.load(std::memory_order_relaxed);
+            }
+            if (total == 0) {
+                return 0;
+            }
+            std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(q * total)));
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < BUCKETS; ++i) {
+                seen += counts_[i].load(std::memory_order_relaxed);
+                if (seen >= rank) {
+                    return midpointOf(i);
+                }
+            }
+            return midpointOf(BUCKETS - 1);
+        }
+
+    private:
+        static std::size_t bucketOf(std::uint64_t value) {
+            if (value < SUB_BUCKETS) {
+                return static_cast<std::size_t>(value);
+            }
+            int exponent = 63 - __builtin_clzll(value);
+            return (exponent - SUB_BITS + 1) * SUB_BUCKETS + ((value >> (exponent - SUB_BITS)) - SUB_BUCKETS);
+        }
+
+        static double midpointOf(std::size_t index) {
+            if (index < SUB_BUCKETS) {
+                return static_cast<double>(index);
+            }
+            int shift = static_cast<int>(index / SUB_BUCKETS) - 1;
+            double low = std::ldexp(static_cast<double>(index % SUB_BUCKETS + SUB_BUCKETS), shift);
+            return low + std::ldexp(0.5, shift);
+        }
+
+        std::array<std::atomic<std::uint64_t>, BUCKETS> counts_{};
+    };
+
+    // Pipes between the parent and one node: commands down, one-line JSON reports up.
+    struct Node {
+        pid_t pid = -1;
+        FILE* commands = nullptr;
+        FILE* reports = nullptr;
+        unsigned short port = 0;
+        bool sender = false;
+        std::vector<unsigned short> targets;
+    };
+
+    // Reads one line from in, without its newline; returns false at end of input.
+    bool readLine(FILE* in, std::string& line) {
+        char* buffer = nullptr;
+        std::size_t capacity = 0;
+        ssize_t length = ::getline(&buffer, &capacity, in);
+        if (length < 0) {
+            std::free(buffer);
+            return false;
+        }
+        line.assign(buffer, length > 0 && buffer[length - 1] == '\n' ? length - 1 : length);
+        std::free(buffer);
+        return true;
+    }
+
+    void writeLine(FILE* out, const std::string& line) {
+        std::fputs(line.c_str(), out);
+        std::fputc('\n', out);
+        std::fflush(out);
+    }
+
+    // Applies the node settings of the configuration to this process's node.
+    network::NetworkManager& configureNode(const Config& config) {
+        logging::LogWriter::Options options;
+        if (config.durability == "none") {
+            options.durability = logging::Durability::NONE;
+        } else if (config.durability == "message") {
+            options.durability = logging::Durability::PER_MESSAGE;
+        }
+        logging::LogManager::instance().setWriterOptions(options);
+
+        network::NetworkManager& net = network::NetworkManager::instance();
+        net.setIoThreads(config.ioThreads);
+        net.setEncryption(config.encryption);
+        net.setCompression(config.compression);
+        return net;
+    }
+
+    // Receiver node: records the latency of every message until drained, then reports and
+    // waits for "exit".
+    int runReceiver(const Config& config, Node& node) {
+        network::NetworkManager& net = configureNode(config);
+        Histogram latency;
+        std::atomic<std::uint64_t> received{0};
+        std::atomic<std::uint64_t> bytes{0};
+        std::atomic<std::int64_t> lastNs{0};
+        std::atomic<std::int64_t> maxLatency{0};
+        std::atomic<std::int64_t> totalLatency{0};
+        net.onMessageReceived([&](const message::Message& msg) {
+            std::int64_t now = nowNs();
+            const std::string& content = msg.getContent();
+            if (content.size() < STAMP_SIZE) {
+                return;
+            }
+            std::int64_t stamp = static_cast<std::int64_t>(std::strtoull(content.substr(0, STAMP_SIZE).c_str(), nullptr, 16));
+            std::int64_t value = std::max<std::int64_t>(0, now - stamp);
+            latency.record(static_cast<std::uint64_t>(value));
+            totalLatency.fetch_add(value, std::memory_order_relaxed);
+            std::int64_t seenMax = maxLatency.load(std::memory_order_relaxed);
+            while (value > seenMax && !maxLatency.compare_exchange_weak(seenMax, value)) {
+            }
+            std::int64_t seenLast = lastNs.load(std::memory_order_relaxed);
+            while (now > seenLast && !lastNs.compare_exchange_weak(seenLast, now)) {
+            }
+            bytes.fetch_add(content.size(), std::memory_order_relaxed);
+            received.fetch_add(1, std::memory_order_release);
+        });
+        net.startServer(node.port);
+        writeLine(node.reports, "{\"ready\":true}");
+
+        // Wait for "drain <expected>", then for the expected messages or a quiet spell.
+        std::string command;
+        if (!readLine(node.commands, command) || command.rfind("drain ", 0) != 0) {
+            return 1;
+        }
+        std::uint64_t expected = std::strtoull(command.c_str() + 6, nullptr, 10);
+        std::uint64_t lastCount = received.load(std::memory_order_acquire);
+        auto lastProgress = Clock::now();
+        while (true) {
+            std::uint64_t count = received.load(std::memory_order_acquire);
+            if (count >= expected) {
+                break;
+            }
+            if (count != lastCount) {
+                lastCount = count;
+                lastProgress = Clock::now();
+            } else if (Clock::now() - lastProgress > DRAIN_IDLE_TIMEOUT) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        Json report;
+        report["received"] = received.load();
+        report["bytes"] = bytes.load();
+        report["last_ns"] = lastNs.load();
+        report["max_ns"] = maxLatency.load();
+        report["total_ns"] = totalLatency.load();
+        report["histogram"] = latency.toJson();
+        writeLine(node.reports, report.dump());
+        readLine(node.commands, command);
+        net.shutdown();
+        return 0;
+    }
+
+    // Waits while any peer of the node is congested.
+    void waitUncongested(network::NetworkManager& net) {
+        while (true) {
+            auto peers = net.listPeers();
+            if (std::none_of(peers.begin(), peers.end(), [](const auto& peer) { return peer->isCongested(); })) {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+
+    // Sender node: connects to its receivers, then sends on "go".
+    int runSender(const Config& config, Node& node) {
+        network::NetworkManager& net = configureNode(config);
+        net.startServer(node.port);
+        std::vector<std::string> targets;
+        for (unsigned short port : node.targets) {
+            net.connectToPeer("127.0.0.1", port);
+            targets.push_back("127.0.0.1:" + std::to_string(port));
+        }
+        auto deadline = Clock::now() + STARTUP_TIMEOUT;
+        while (true) {
+            auto peers = net.listPeers();
+            std::size_t ready = std::count_if(peers.begin(), peers.end(),
+                                              [](const auto& peer) { return peer->handshakeComplete(); });
+            if (ready >= targets.size()) {
+                break;
+            }
+            if (Clock::now() > deadline) {
+                return 1;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        writeLine(node.reports, "{\"ready\":true}");
+
+        std::string command;
+        if (!readLine(node.commands, command) || command != "go") {
+            return 1;
+        }
+
+        // Contents come from a random pool larger than the deflate window, taken at advancing
+        // offsets, so that messages do not compress better than real traffic would.
+        std::size_t padding = config.size > STAMP_SIZE ? config.size - STAMP_SIZE : 0;
+        std::string pool(std::max<std::size_t>(1024 * 1024, 2 * padding), '\0');
+        std::mt19937_64 random(node.port);
+        for (char& c : pool) {
+            c = static_cast<char>('!' + random() % 94);
+        }
+        std::size_t poolOffset = 0;
+
+        std::int64_t start = nowNs();
+        std::int64_t interval = config.rate > 0 ? static_cast<std::int64_t>(1e9 / config.rate) : 0;
+        std::int64_t end = config.duration > 0 ? start + static_cast<std::int64_t>(config.duration * 1e9) : INT64_MAX;
+        std::uint64_t sent = 0;
+        std::uint64_t dropped = 0;
+        std::uint64_t congestedWaits = 0;
+        std::string content(STAMP_SIZE + padding, '\0');
+        std::string address = net.getListeningAddress();
+        char stamp[STAMP_SIZE + 1];
+        while (sent < config.messages) {
+            std::int64_t due = interval > 0 ? start + static_cast<std::int64_t>(sent) * interval : nowNs();
+            if (due >= end || nowNs() >= end) {
+                break;
+            }
+            if (interval > 0) {
+                std::this_thread::sleep_until(Clock::time_point(std::chrono::nanoseconds(due)));
+            }
+            std::snprintf(stamp, sizeof(stamp), "%016" PRIx64, static_cast<std::uint64_t>(due));
+            std::memcpy(&content[0], stamp, STAMP_SIZE);
+            if (poolOffset + padding > pool.size()) {
+                poolOffset = 0;
+            }
+            std::memcpy(&content[STAMP_SIZE], pool.data() + poolOffset, padding);
+            poolOffset += padding + 1;
+
+            message::Message msg(address, "bench", content, message::MessageType::SENT);
+            std::string encoded = msg.encode();
+            bool congested = false;
+            if (config.broadcast) {
+                congested = net.broadcastMessage(encoded) > 0;
+            } else {
+                for (const auto& target : targets) {
+                    network::SendStatus status = net.sendMessage(target, encoded);
+                    dropped += status == network::SendStatus::DROPPED;
+                    congested |= status == network::SendStatus::CONGESTED;
+                }
+            }
+            ++sent;
+            if (congested) {
+                ++congestedWaits;
+                waitUncongested(net);
+            }
+        }
+        std::int64_t finish = nowNs();
+
+        // Wait for the queues to drain so the receivers are not cut short.
+        while (true) {
+            auto peers = net.listPeers();
+            if (std::all_of(peers.begin(), peers.end(), [](const auto& peer) { return peer->queuedBytes() == 0; })) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        Json report;
+        report["sent"] = sent;
+        report["dropped"] = dropped;
+        report["congested_waits"] = congestedWaits;
+        report["start_ns"] = start;
+        report["end_ns"] = finish;
+        writeLine(node.reports, report.dump());
+        readLine(node.commands, command);
+        net.shutdown();
+        return 0;
+    }
+
+    // Parses --name=value options into config; returns false on an unknown or malformed one.
+    bool parseArguments(int argc, char* argv[], Config& config) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto eq = arg.find('=');
+            std::string name = arg.substr(0, eq);
+            std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+            try {
+                if (name == "--senders") {
+                    config.senders = std::stoul(value);
+                } else if (name == "--receivers") {
+                    config.receivers = std::stoul(value);
+                } else if (name == "--fanout") {
+                    config.fanout = std::stoul(value);
+                } else if (name == "--mode" && (value == "direct" || value == "broadcast")) {
+                    config.broadcast = value == "broadcast";
+                } else if (name == "--size") {
+                    config.size = std::stoul(value);
+                } else if (name == "--rate") {
+                    config.rate = std::stod(value);
+                } else if (name == "--messages") {
+                    config.messages = std::stoull(value);
+                } else if (name == "--duration") {
+                    config.duration = std::stod(value);
+                } else if (name == "--port") {
+                    config.port = static_cast<unsigned short>(std::stoul(value));
+                } else if (name == "--io-threads") {
+                    config.ioThreads = std::stoul(value);
+                } else if (name == "--durability" && (value == "none" || value == "batched" || value == "message")) {
+                    config.durability = value;
+                } else if (name == "--no-encryption" && eq == std::string::npos) {
+                    config.encryption = false;
+                } else if (name == "--no-compression" && eq == std::string::npos) {
+                    config.compression = false;
+                } else {
+                    std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+                    return false;
+                }
+            } catch (const std::exception&) {
+                std::fprintf(stderr, "Invalid value: %s\n", arg.c_str());
+                return false;
+            }
+        }
+        if (config.senders == 0 || config.receivers == 0 || config.fanout == 0 || config.fanout > config.receivers) {
+            std::fprintf(stderr, "Need at least one sender and receiver, and 1 <= fanout <= receivers\n");
+            return false;
+        }
+        if (config.size < STAMP_SIZE) {
+            std::fprintf(stderr, "Messages must be at least %zu bytes\n", STAMP_SIZE);
+            return false;
+        }
+        return true;
+    }
+
+    // Forks a node running in its own directory under root. The child never returns.
+    void spawn(const Config& config, Node& node, const std::filesystem::path& root, std::vector<int>& parentFds) {
+        int down[2];
+        int up[2];
+        if (::pipe(down) != 0 || ::pipe(up) != 0) {
+            throw std::runtime_error("pipe() failed");
+        }
+        std::filesystem::path dir = root / ("node-" + std::to_string(node.port));
+        std::filesystem::create_directories(dir);
+        std::fflush(nullptr);
+        node.pid = ::fork();
+        if (node.pid < 0) {
+            throw std::runtime_error("fork() failed");
+        }
+        if (node.pid == 0) {
+            ::prctl(PR_SET_PDEATHSIG, SIGTERM);
+            for (int fd : parentFds) {
+                ::close(fd);
+            }
+            ::close(down[1]);
+            ::close(up[0]);
+            int devNull = ::open("/dev/null", O_WRONLY);
+            ::dup2(devNull, STDOUT_FILENO);
+            int errors = ::open((dir / "stderr.txt").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            ::dup2(errors, STDERR_FILENO);
+            std::filesystem::current_path(dir);
+            node.commands = ::fdopen(down[0], "r");
+            node.reports = ::fdopen(up[1], "w");
+            int status = node.sender ? runSender(config, node) : runReceiver(config, node);
+            std::fflush(nullptr);
+            ::_exit(status);
+        }
+        ::close(down[0]);
+        ::close(up[1]);
+        parentFds.push_back(down[1]);
+        parentFds.push_back(up[0]);
+        node.commands = ::fdopen(down[1], "w");
+        node.reports = ::fdopen(up[0], "r");
+    }
+
+    // Reads a node's next report; throws if the node died.
+    Json readReport(Node& node) {
+        std::string line;
+        if (!readLine(node.reports, line)) {
+            throw std::runtime_error(std::string(node.sender ? "Sender" : "Receiver") + " on port " +
+                                     std::to_string(node.port) + " failed");
+        }
+        return Json::parse(line);
+    }
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Config config;
+    if (!parseArguments(argc, argv, config)) {
+        return 2;
+    }
+
+    // Receivers listen on the first ports, senders on the ones after. Sender i sends to
+    // receivers i, i+1, ... (mod receivers), so every receiver gets an even share.
+    std::vector<Node> nodes(config.receivers + config.senders);
+    std::vector<std::uint64_t> sendersPerReceiver(config.receivers, 0);
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        nodes[i].port = static_cast<unsigned short>(config.port + i);
+        nodes[i].sender = i >= config.receivers;
+        if (nodes[i].sender) {
+            for (std::size_t k = 0; k < config.fanout; ++k) {
+                std::size_t receiver = (i - config.receivers + k) % config.receivers;
+                nodes[i].targets.push_back(nodes[receiver].port);
+                ++sendersPerReceiver[receiver];
+            }
+        }
+    }
+
+    char rootTemplate[] = "/tmp/p2p_bench.XXXXXX";
+    if (!::mkdtemp(rootTemplate)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::filesystem::path root = rootTemplate;
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int status = 0;
+    std::vector<int> parentFds;
+    try {
+        // Receivers first, so they are listening by the time the senders connect.
+        for (auto& node : nodes) {
+            spawn(config, node, root, parentFds);
+        }
+        for (auto& node : nodes) {
+            readReport(node);
+        }
+        std::fprintf(stderr, "%zu receivers and %zu senders ready\n", config.receivers, config.senders);
+
+        for (auto& node : nodes) {
+            if (node.sender) {
+                writeLine(node.commands, "go");
+            }
+        }
+
+        // Every sender's messages reach each of its targets, except those it saw dropped.
+        std::uint64_t sent = 0;
+        std::uint64_t dropped = 0;
+        std::uint64_t congestedWaits = 0;
+        std::int64_t start = INT64_MAX;
+        std::int64_t sendEnd = 0;
+        std::vector<std::uint64_t> perSender;
+        for (auto& node : nodes) {
+            if (node.sender) {
+                Json report = readReport(node);
+                std::uint64_t count = report.find("sent")->asInteger();
+                sent += count;
+                perSender.push_back(count);
+                dropped += report.find("dropped")->asInteger();
+                congestedWaits += report.find("congested_waits")->asInteger();
+                start = std::min<std::int64_t>(start, report.find("start_ns")->asInteger());
+                sendEnd = std::max<std::int64_t>(sendEnd, report.find("end_ns")->asInteger());
+            }
+        }
+
+        std::vector<std::uint64_t> expected(config.receivers, 0);
+        for (std::size_t i = config.receivers, s = 0; i < nodes.size(); ++i, ++s) {
+            for (unsigned short port : nodes[i].targets) {
+                expected[port - config.port] += perSender[s];
+            }
+        }
+        std::uint64_t expectedTotal = 0;
+        for (std::size_t r = 0; r < config.receivers; ++r) {
+            expectedTotal += expected[r];
+            writeLine(nodes[r].commands, "drain " + std::to_string(expected[r]));
+        }
+        expectedTotal -= std::min(expectedTotal, dropped);
+
+        Histogram latency;
+        std::uint64_t delivered = 0;
+        std::uint64_t bytes = 0;
+        std::int64_t last = start;
+        std::int64_t maxLatency = 0;
+        double totalLatency = 0;
+        for (std::size_t r = 0; r < config.receivers; ++r) {
+            Json report = readReport(nodes[r]);
+            delivered += report.find("received")->asInteger();
+            bytes += report.find("bytes")->asInteger();
+            last = std::max<std::int64_t>(last, report.find("last_ns")->asInteger());
+            maxLatency = std::max<std::int64_t>(maxLatency, report.find("max_ns")->asInteger());
+            totalLatency += static_cast<double>(report.find("total_ns")->asInteger());
+            latency.merge(*report.find("histogram"));
+        }
+        // Senders leave first, so no node sees its peer vanish mid-session.
+        for (auto& node : nodes) {
+            if (node.sender) {
+                writeLine(node.commands, "exit");
+                ::waitpid(node.pid, nullptr, 0);
+                node.pid = -1;
+            }
+        }
+        for (std::size_t r = 0; r < config.receivers; ++r) {
+            writeLine(nodes[r].commands, "exit");
+        }
+
+        double elapsed = std::max<std::int64_t>(1, last - start) / 1e9;
+        Json result;
+        Json& settings = result["config"];
+        settings["senders"] = config.senders;
+        settings["receivers"] = config.receivers;
+        settings["fanout"] = config.fanout;
+        settings["mode"] = config.broadcast ? "broadcast" : "direct";
+        settings["size"] = config.size;
+        settings["rate"] = config.rate;
+        settings["messages"] = config.messages;
+        settings["duration"] = config.duration;
+        settings["io_threads"] = config.ioThreads;
+        settings["durability"] = config.durability;
+        settings["encryption"] = config.encryption;
+        settings["compression"] = config.compression;
+        result["sent"] = sent;
+        result["expected"] = expectedTotal;
+        result["delivered"] = delivered;
+        result["lost"] = expectedTotal > delivered ? expectedTotal - delivered : 0;
+        result["dropped"] = dropped;
+        result["congested_waits"] = congestedWaits;
+        result["send_seconds"] = (sendEnd - start) / 1e9;
+        result["elapsed_seconds"] = elapsed;
+        result["msgs_per_sec"] = delivered / elapsed;
+        result["mb_per_sec"] = bytes / elapsed / 1e6;
+        Json& micros = result["latency_us"];
+        micros["p50"] = latency.percentile(0.5) / 1e3;
+        micros["p99"] = latency.percentile(0.99) / 1e3;
+        micros["p999"] = latency.percentile(0.999) / 1e3;
+        micros["max"] = maxLatency / 1e3;
+        micros["mean"] = delivered > 0 ? totalLatency / delivered / 1e3 : 0.0;
+
+        std::fprintf(stderr, "delivered %" PRIu64 " of %" PRIu64 " messages in %.2f s: %.0f msgs/s, %.1f MB/s\n",
+                     delivered, expectedTotal, elapsed, delivered / elapsed, bytes / elapsed / 1e6);
+        std::fprintf(stderr, "latency p50 %.0f us, p99 %.0f us, p999 %.0f us, max %.0f us\n",
+                     latency.percentile(0.5) / 1e3, latency.percentile(0.99) / 1e3, latency.percentile(0.999) / 1e3,
+                     maxLatency / 1e3);
+        std::printf("%s\n", result.dump().c_str());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        for (auto& node : nodes) {
+            if (node.pid > 0) {
+                ::kill(node.pid, SIGTERM);
+            }
+        }
+        status = 1;
+    }
+
+    for (auto& node : nodes) {
+        if (node.pid > 0) {
+            int childStatus = 0;
+            ::waitpid(node.pid, &childStatus, 0);
+        }
+    }
+    if (status == 0) {
+        std::error_code ignored;
+        std::filesystem::remove_all(root, ignored);
+    } else {
+        std::fprintf(stderr, "Node logs kept in %s\n", root.c_str());
+    }
+    return status;
+}
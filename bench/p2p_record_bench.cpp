@@ -0,0 +1,114 @@
+// Measures the throughput of one connection with and without the encrypted record layer.
+//
+// Two Peers are connected over loopback and one streams message frames to the other as fast
+// as the receiver takes them, for several message sizes. Everything but the record layer is
+// the same in both modes, so the difference is what encryption costs.
+//
+// Usage: ./p2p_record_bench [megabytes-per-run]
+
+#include "network/Peer.h"
+#include "network/RecordLayer.h"
+#include <atomic>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    using tcp = boost::asio::ip::tcp;
+    using Clock = std::chrono::steady_clock;
+
+    // Result of one run.
+    struct Result {
+        double messagesPerSecond;
+        double megabytesPerSecond;
+    };
+
+    // Streams count messages of size bytes from one peer to another and times their arrival.
+    Result run(std::size_t size, std::size_t count, bool encrypted) {
+        boost::asio::io_context io;
+        auto guard = boost::asio::make_work_guard(io);
+        tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        auto outgoing = std::make_shared<tcp::socket>(boost::asio::make_strand(io));
+        auto incoming = std::make_shared<tcp::socket>(boost::asio::make_strand(io));
+        outgoing->connect(acceptor.local_endpoint());
+        acceptor.accept(*incoming);
+        outgoing->set_option(tcp::no_delay(true));
+
+        auto sender = std::make_shared<network::Peer>(outgoing, "sender");
+        auto receiver = std::make_shared<network::Peer>(incoming, "receiver");
+        if (encrypted) {
+            network::KeyExchange senderKeys;
+            network::KeyExchange receiverKeys;
+            sender->startSession(senderKeys.derive(receiverKeys.publicKey()));
+            receiver->startSession(receiverKeys.derive(senderKeys.publicKey()));
+        } else {
+            sender->startSession(network::SessionKeys());
+            receiver->startSession(network::SessionKeys());
+        }
+
+        std::mutex mutex;
+        std::condition_variable done;
+        std::size_t received = 0;
+        receiver->onMessage([&](const network::FrameView&) {
+            if (++received == count) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.notify_one();
+            }
+            return true;
+        });
+        receiver->startReceiving();
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 2; ++i) {
+            threads.emplace_back([&io]() { io.run(); });
+        }
+
+        auto frame = network::makeSharedFrame(network::FrameType::MESSAGE, std::string(size, 'x'));
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < count; ++i) {
+            while (sender->isCongested()) {
+                std::this_thread::yield();
+            }
+            sender->sendFrame(frame);
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&]() { return received == count; });
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        receiver->close();
+        sender->close();
+        guard.reset();
+        io.stop();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        return Result{count / seconds, count * static_cast<double>(size) / seconds / (1024 * 1024)};
+    }
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    const std::size_t sizes[] = {64, 1024, 16 * 1024, 256 * 1024};
+
+    std::printf("%10s  %16s %12s  %16s %12s\n", "size", "plain msgs/s", "plain MB/s", "aes-gcm msgs/s", "aes-gcm MB/s");
+    for (std::size_t size : sizes) {
+        std::size_t count = std::max<std::size_t>(1000, megabytes * 1024 * 1024 / size);
+        count = std::min<std::size_t>(count, 4000000);
+        Result plain = run(size, count, false);
+        Result sealed = run(size, count, true);
+        std::printf("%10zu  %16.0f %12.1f  %16.0f %12.1f\n", size, plain.messagesPerSecond, plain.megabytesPerSecond,
+                    sealed.messagesPerSecond, sealed.megabytesPerSecond);
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "control/Json.h"
+#include "log/LogManager.h"
+#include "message/Message.h"
+#include "network/NetworkManager.h"
+#include <boost/asio.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace control {
+
+    // Control interface of a headless node: a Unix socket speaking line-delimited JSON.
+    // Each request is one JSON object on one line, {"cmd": "...", "id": ..., parameters},
+    // answered by one line {"id": ..., "ok": true, results} or {"id": ..., "ok": false,
+    // "error": "..."}, in request order. Clients that send {"cmd": "watch"} also receive
+    // {"event": "message", ...} lines for every received message.
+    //
+    // Commands: info, connect, peers, send, broadcast, gossip, subscribe, unsubscribe,
+    // subscriptions, send_file, transfers, inbox, delete, search, stats, metrics, watch and shutdown.
+    // Clients and requests are served on the thread that calls run().
+    class ControlServer {
+    public:
+        // Binds the control socket at path, replacing a stale socket file left by a node that
+        // is gone. Throws std::runtime_error if another node is listening there or binding fails.
+        ControlServer(network::NetworkManager& net, const std::string& path);
+
+        // Closes the clients and removes the socket file.
+        ~ControlServer();
+
+        ControlServer(const ControlServer&) = delete;
+        ControlServer& operator=(const ControlServer&) = delete;
+
+        // Returns the socket path used when none is given: p2p-<port>.sock in the working directory.
+        static std::string defaultPath(unsigned short port);
+
+        // Forwards a received message to the watching clients. Safe to call from any thread.
+        void onMessageReceived(const message::Message& msg);
+
+        // Serves clients until a shutdown request, SIGINT or SIGTERM.
+        void run();
+
+        // Makes run() return. Safe to call from any thread.
+        void stop();
+
+    private:
+        class Session;
+
+        // Handler of one command; returns the result members of the response.
+        using Command = Json (ControlServer::*)(const Json& request, Session& session);
+
+        // Accepts clients asynchronously.
+        void doAccept();
+
+        // Parses and executes one request line, returning the response line.
+        std::string handleLine(const std::string& line, Session& session);
+
+        Json info(const Json& request, Session& session);
+        Json connect(const Json& request, Session& session);
+        Json peers(const Json& request, Session& session);
+        Json send(const Json& request, Session& session);
+        Json broadcast(const Json& request, Session& session);
+        Json gossip(const Json& request, Session& session);
+        Json subscribe(const Json& request, Session& session);
+        Json unsubscribe(const Json& request, Session& session);
+        Json subscriptions(const Json& request, Session& session);
+        Json sendFile(const Json& request, Session& session);
+        Json transfers(const Json& request, Session& session);
+        Json inbox(const Json& request, Session& session);
+        Json remove(const Json& request, Session& session);
+        Json search(const Json& request, Session& session);
+        Json stats(const Json& request, Session& session);
+        Json metrics(const Json& request, Session& session);
+        Json watch(const Json& request, Session& session);
+        Json shutdown(const Json& request, Session& session);
+
+        // Returns the connected peers as JSON objects.
+        Json peerList() const;
+
+        // Builds a message to send from the request's topic and content and logs it as sent.
+        message::Message composeMessage(const Json& request);
+
+        // Reference to the NetworkManager the commands act on.
+        network::NetworkManager& net_;
+
+        // Reference to the LogManager singleton for inbox queries.
+        logging::LogManager& logger_ = logging::LogManager::instance();
+
+        // Path of the socket file, removed on destruction.
+        std::string path_;
+
+        // Serves the acceptor, the clients and the signal handler on the thread in run().
+        boost::asio::io_context ioContext_;
+        boost::asio::local::stream_protocol::acceptor acceptor_;
+        boost::asio::signal_set signals_;
+
+        // Clients that asked for message events; used on the run() thread only.
+        std::vector<std::weak_ptr<Session>> watchers_;
+    };
+
+}  // namespace control
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace control {
+
+    // JSON value for the control protocol: null, boolean, integer, floating-point number,
+    // string, array or object. Integers are kept apart from doubles so that nanosecond
+    // timestamps and byte counts survive a round trip exactly.
+    class Json {
+    public:
+        using Array = std::vector<Json>;
+        using Object = std::map<std::string, Json>;
+
+        // Constructs a null value.
+        Json() = default;
+
+        Json(std::nullptr_t) {}
+        Json(bool value) : value_(value) {}
+        Json(double value) : value_(value) {}
+        Json(const char* value) : value_(std::string(value)) {}
+        Json(std::string value) : value_(std::move(value)) {}
+        Json(std::string_view value) : value_(std::string(value)) {}
+        Json(Array value) : value_(std::move(value)) {}
+        Json(Object value) : value_(std::move(value)) {}
+
+        // Constructs an integer from any integral type but bool.
+        template <typename T, typename = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+        Json(T value) : value_(static_cast<std::int64_t>(value)) {}
+
+        bool isNull() const { return std::holds_alternative<std::nullptr_t>(value_); }
+        bool isBool() const { return std::holds_alternative<bool>(value_); }
+        bool isInteger() const { return std::holds_alternative<std::int64_t>(value_); }
+        bool isNumber() const { return isInteger() || std::holds_alternative<double>(value_); }
+        bool isString() const { return std::holds_alternative<std::string>(value_); }
+        bool isArray() const { return std::holds_alternative<Array>(value_); }
+        bool isObject() const { return std::holds_alternative<Object>(value_); }
+
+        // Typed accessors. Each throws std::runtime_error if the value has another type;
+        // asInteger() also accepts a double without a fractional part.
+        bool asBool() const;
+        std::int64_t asInteger() const;
+        double asDouble() const;
+        const std::string& asString() const;
+        const Array& asArray() const;
+        const Object& asObject() const;
+
+        // Returns the member named key, or nullptr if this is not an object or has no such member.
+        const Json* find(const std::string& key) const;
+
+        // Returns the member named key, turning a null value into an empty object first.
+        // Throws std::runtime_error if this is neither null nor an object.
+        Json& operator[](const std::string& key);
+
+        // Appends an element, turning a null value into an empty array first.
+        // Throws std::runtime_error if this is neither null nor an array.
+        void push(Json value);
+
+        // Parses a complete JSON text. Throws std::runtime_error if it is malformed,
+        // nested too deeply or followed by anything but whitespace.
+        static Json parse(std::string_view text);
+
+        // Serializes the value on a single line, with no insignificant whitespace.
+        std::string dump() const;
+
+        // Appends the serialized value to out.
+        void dump(std::string& out) const;
+
+    private:
+        std::variant<std::nullptr_t, bool, std::int64_t, double, std::string, Array, Object> value_;
+    };
+
+}  // namespace control
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "log/LogWriter.h"
+#include <cstdint>
+#include <future>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace logging {
+
+    // Append-only file of length-prefixed binary records with a companion tombstone file.
+    // Records are addressed by their byte offset in the file; deleting a record appends
+    // its offset to the tombstone file, and compaction later drops deleted records.
+    //
+    // The file is memory-mapped on load and located through an offset index persisted
+    // in path + ".idx", so loading touches neither the records nor their length prefixes.
+    // Records appended after loading are served from an in-memory tail until the next remap.
+    // All writes go through the shared LogWriter, off the caller's thread.
+    // Not thread-safe; callers serialize access.
+    class LogFile {
+    public:
+        // Constructs a log backed by path, with tombstones in path + ".del" and the index in path + ".idx".
+        LogFile(const std::string& path, LogWriter& writer);
+
+        // Unmaps the file and closes the descriptors after the writer has flushed them.
+        ~LogFile();
+
+        // Deleted copy constructor and assignment operator to prevent copying.
+        LogFile(const LogFile&) = delete;
+        LogFile& operator=(const LogFile&) = delete;
+
+        // Maps the file, loads the offset index and opens the files for appending.
+        // Rebuilds the index by scanning only if it is missing or behind the file.
+        void load();
+
+        // Returns the number of live records.
+        std::size_t size() const;
+
+        // Returns the live record at the given position.
+        // The view is valid until the log is next modified.
+        std::string_view record(std::size_t liveIndex) const;
+
+        // Returns the file offset of the live record at the given position.
+        std::uint64_t offset(std::size_t liveIndex) const;
+
+        // Returns the position of the first live record at or after offset; size() if none.
+        std::size_t positionAtOrAfter(std::uint64_t offset) const;
+
+        // Returns the position of the live record at offset, or nothing if none starts there.
+        std::optional<std::size_t> position(std::uint64_t offset) const;
+
+        // Returns the record starting at offset, live or deleted, or nothing if no record fits
+        // there. The view is valid until the log is next modified.
+        std::optional<std::string_view> recordAt(std::uint64_t offset) const;
+
+        // Returns the path of the record file.
+        const std::string& path() const;
+
+        // Appends one record to the end of the file.
+        // Returns the writer's durability future for the record (see LogWriter::submit).
+        // Throws std::system_error once a write to the log's files has failed: records past
+        // the failed one would not land at their offsets. A compaction, which rewrites the
+        // files from memory, makes the log writable again.
+        std::future<void> append(const std::string& record);
+
+        // Records the deletion of the live record at the given position.
+        void erase(std::size_t liveIndex);
+
+        // Returns true once deleted records make up enough of the file to be worth compacting.
+        bool needsCompaction() const;
+
+        // Rewrites the file and its index without deleted records and clears the tombstones.
+        // Safe against crashes at any step; on a write error the log is left as it was.
+        void compact();
+
+    private:
+        // Maps the record file read-only.
+        void map();
+
+        // Releases the mapping and the in-memory tail.
+        void unmap();
+
+        // Opens the record, index and tombstone files for appending.
+        void openForAppend();
+
+        // Waits for pending writes and closes all files.
+        void close();
+
+        // Folds the in-memory tail into the mapping once it grows large.
+        void remapIfTailLarge();
+
+        // Returns true once a write to the log's files has failed.
+        bool failed();
+
+        // Path of the record file.
+        std::string path_;
+
+        // Path of the offset index file.
+        std::string indexPath_;
+
+        // Path of the tombstone file.
+        std::string tombstonePath_;
+
+        // Background writer performing the appends.
+        LogWriter& writer_;
+
+        // Descriptor of the record file, opened for appending.
+        int recordsFd_ = -1;
+
+        // Descriptor of the index file, opened for appending.
+        int indexFd_ = -1;
+
+        // Descriptor of the tombstone file, opened for appending.
+        int tombstonesFd_ = -1;
+
+        // Read-only mapping of the record file as it was when last mapped.
+        const char* map_ = nullptr;
+
+        // Size of the mapping in bytes.
+        std::size_t mapSize_ = 0;
+
+        // Framed records appended since the file was last mapped, starting at offset mapSize_.
+        std::string tail_;
+
+        // File offsets of the live records, in order.
+        std::vector<std::uint64_t> liveOffsets_;
+
+        // Number of deleted records still present in the file.
+        std::size_t deadCount_ = 0;
+
+        // First error writing the files; cleared only by a successful compaction.
+        std::error_code failure_;
+    };
+
+}  // namespace logging
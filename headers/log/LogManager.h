@@ -1,6 +1,10 @@
 #pragma once
 
+#include "log/LogFile.h"
+#include "log/MessageIndex.h"
+#include "log/SearchIndex.h"
 #include "message/Message.h"
+#include "metrics/Registry.h"
 #include <functional>
 #include <mutex>
 #include <string>
@@ -8,25 +12,77 @@
 
 namespace logging {
 
+    // Refers to a stored message by log and ID, independent of its position in the log.
+    struct MessageHandle {
+        bool sent = false;
+        MessageId id = 0;
+    };
+
+    // One page of query results and the number of matches in total.
+    struct MessagePage {
+        std::size_t total = 0;
+        std::vector<MessageHandle> handles;
+    };
+
+    // Message matching a search, with its relevance score.
+    struct SearchHit {
+        MessageHandle handle;
+        double score;
+    };
+
+    // Search results, best first, and the number of matching messages in total.
+    struct SearchResults {
+        std::size_t total = 0;
+        std::vector<SearchHit> hits;
+    };
+
     class LogManager {
     public:
         // Returns the singleton instance of LogManager.
         static LogManager& instance();
 
         // Appends a message to the appropriate log (sent or received).
-        void appendMessage(const message::Message& msg);
+        // The record is written by a background thread; see setWriterOptions().
+        // Returns false if the log can no longer be written or, in PER_MESSAGE mode, the
+        // record could not be made durable.
+        bool appendMessage(const message::Message& msg);
+
+        // Appends several messages under one lock. In PER_MESSAGE mode, waits once for all of them.
+        // Returns false if any of them could not be stored, as appendMessage().
+        bool appendMessages(const std::vector<message::Message>& msgs);
+
+        // Sets the durability mode and group-commit thresholds of the log writer.
+        void setWriterOptions(const LogWriter::Options& options);
 
         // Deletes a message at the specified index from either sent or received log.
         void deleteMessage(size_t index, bool sent);
 
+        // Returns the number of stored sent or received messages.
+        std::size_t messageCount(bool sent);
+
+        // Decodes the message at the specified index from either sent or received log.
+        message::Message getMessage(size_t index, bool sent);
+
+        // Returns the page of messages in query.sent's log that match the query, in timestamp
+        // order. Only the indexes are read; the first query of each log builds its index.
+        MessagePage queryMessages(const MessageQuery& query);
+
+        // Decodes the message a handle refers to. Throws std::out_of_range if it was deleted.
+        message::Message getMessage(const MessageHandle& handle);
+
+        // Deletes the message a handle refers to. Returns false if it was already deleted.
+        bool deleteMessage(const MessageHandle& handle);
+
+        // Returns the limit sent or received messages whose topic or content best match the
+        // words of text. The first search of each log loads its index and indexes what is new.
+        SearchResults searchMessages(const std::string& text, std::size_t limit);
+
         // Retrieves all messages (sent and received).
         std::vector<message::Message> readAll();
 
-        // Returns a vector of strings representing sent messages.
-        std::vector<std::string> getSentStrings();
-
-        // Returns a vector of strings representing received messages.
-        std::vector<std::string> getReceivedStrings();
+        // Exports sent or received messages to path as '|'-separated text lines.
+        // Returns false if the file could not be written.
+        bool exportText(bool sent, const std::string& path);
 
     private:
         // Private constructor to enforce singleton pattern.
@@ -42,27 +98,52 @@ namespace logging {
         // Ensures the log directory exists.
         void ensureLogFolderExists();
 
-        // Saves sent messages to the log file.
-        void saveSentToFile();
+        // Imports a text log written by earlier versions into a binary log.
+        void importLegacyText(const std::string& path, LogFile& file);
 
-        // Saves received messages to the log file.
-        void saveReceivedToFile();
+        // Returns the index of the sent or received log, building it first if needed.
+        // Called with fileMutex_ held.
+        MessageIndex& indexFor(bool sent);
 
-        // Notifies the observer of a new message.
-        void notifyObserver(const message::Message& msg);
+        // Returns the full-text index of the sent or received log, opening it first if needed.
+        // Called with fileMutex_ held.
+        SearchIndex& searchFor(bool sent);
+
+        // Appends a record to the log and, once built, its index. Called with fileMutex_ held.
+        std::future<void> append(const std::string& record, bool sent);
 
-        // In-memory storage for sent messages.
-        std::vector<message::Message> sentMessages_;
+        // Deletes the record at position from the log and its index. Called with fileMutex_ held.
+        void erase(std::size_t position, bool sent);
 
-        // In-memory storage for received messages.
-        std::vector<message::Message> receivedMessages_;
+        // Decodes a stored record, substituting a placeholder if it is corrupt.
+        static message::Message decodeRecord(std::string_view record, bool sent);
+
+        // Notifies the observer of a new message.
+        void notifyObserver(const message::Message& msg);
 
         // Mutex for thread-safe file operations.
         std::mutex fileMutex_;
 
-        // File paths for sent and received message logs.
-        const std::string sentLogFile_ = "logs/messages_sent.log";
-        const std::string receivedLogFile_ = "logs/messages_received.log";
+        // Messages appended, and the time each append took including any wait for durability.
+        metrics::Counter& appended_ = metrics::Registry::instance().counter(
+            "p2p_log_appended_messages_total", "Messages appended to the sent and received logs");
+        metrics::Histogram& appendLatency_ = metrics::Registry::instance().histogram(
+            "p2p_log_append_seconds", "Time taken by each append to the logs, waiting for durability included");
+
+        // Background writer shared by both logs; declared first so it outlives them.
+        LogWriter writer_;
+
+        // Memory-mapped, append-only logs for sent and received messages.
+        LogFile sentLog_{"logs/messages_sent.dat", writer_};
+        LogFile receivedLog_{"logs/messages_received.dat", writer_};
+
+        // Peer, topic and time indexes over each log, built on the first query.
+        MessageIndex sentIndex_;
+        MessageIndex receivedIndex_;
+
+        // Persistent full-text indexes over each log, opened on the first search.
+        SearchIndex sentSearch_{sentLog_.path()};
+        SearchIndex receivedSearch_{receivedLog_.path()};
 
         // Callback for notifying UI of new messages.
         std::function<void(const message::Message&)> observer_;
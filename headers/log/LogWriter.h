@@ -0,0 +1,119 @@
+#pragma once
+
+#include "log/MpscQueue.h"
+#include "metrics/Registry.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+namespace logging {
+
+    // How long appended records may stay only in the page cache.
+    enum class Durability {
+        NONE,        // Never fsync; the OS flushes when it chooses.
+        BATCHED,     // fsync after flushInterval or flushBytes, whichever comes first.
+        PER_MESSAGE  // Every append waits until its record has been fsynced.
+    };
+
+    // Background thread that turns appended records into large sequential writes.
+    // Producers hand records over through a lock-free queue; the writer drains
+    // whatever has accumulated, writes it per file in one call and groups fsyncs.
+    class LogWriter {
+    public:
+        // Tuning for flushing and durability.
+        struct Options {
+            Durability durability = Durability::BATCHED;
+            std::chrono::milliseconds flushInterval{200};
+            std::size_t flushBytes = 1024 * 1024;
+        };
+
+        // Starts the writer thread.
+        LogWriter();
+
+        // Writes out everything still queued, syncs and stops the writer thread.
+        ~LogWriter();
+
+        // Deleted copy constructor and assignment operator to prevent copying.
+        LogWriter(const LogWriter&) = delete;
+        LogWriter& operator=(const LogWriter&) = delete;
+
+        // Replaces the flushing and durability options.
+        void setOptions(const Options& options);
+
+        // Returns the current durability mode.
+        Durability durability() const;
+
+        // Queues bytes to be appended to the file descriptor.
+        // In PER_MESSAGE mode, the returned future becomes ready once the bytes are on
+        // stable storage, or holds a std::system_error if they could not be written;
+        // in other modes it is invalid and there is nothing to wait for.
+        std::future<void> submit(int fd, std::string bytes);
+
+        // Returns the error that stopped writes to fd, or none. After a failed write or
+        // fsync, bytes queued for fd are dropped until release(fd).
+        std::error_code failure(int fd) const;
+
+        // Forgets the failure of fd. Call after drain(), before closing it.
+        void release(int fd);
+
+        // Blocks until everything submitted before the call has been written (and synced,
+        // unless durability is NONE). Must be called before closing a descriptor.
+        void drain();
+
+    private:
+        // Queued unit of work; a record with fd -1 only marks a drain point.
+        struct Record {
+            int fd = -1;
+            std::string bytes;
+            std::shared_ptr<std::promise<void>> done;
+        };
+
+        // Writer thread body.
+        void run();
+
+        // Pushes a record and wakes the writer if it is idle.
+        void enqueue(Record record);
+
+        // Records the first error of fd and reports it.
+        void fail(int fd, std::error_code error);
+
+        // Records waiting for the writer thread.
+        MpscQueue<Record> queue_;
+
+        // Mutex and condition used only to park and wake the idle writer.
+        std::mutex wakeMutex_;
+        std::condition_variable wakeCondition_;
+
+        // Set while the writer is (about to be) parked.
+        std::atomic<bool> sleeping_{false};
+
+        // Cleared to make the writer finish.
+        std::atomic<bool> running_{true};
+
+        // Current options, read by the writer thread on every pass.
+        std::atomic<Durability> durability_{Durability::BATCHED};
+        std::atomic<std::chrono::milliseconds::rep> flushIntervalMs_{200};
+        std::atomic<std::size_t> flushBytes_{1024 * 1024};
+
+        // First error of each failed descriptor; the flag is set while there is any.
+        mutable std::mutex failuresMutex_;
+        std::unordered_map<int, std::error_code> failures_;
+        std::atomic<bool> anyFailure_{false};
+
+        // Bytes written to the logs, and the time each fdatasync took.
+        metrics::Counter& writtenBytes_;
+        metrics::Histogram& fsyncLatency_;
+
+        // Writer thread.
+        std::thread thread_;
+    };
+
+}  // namespace logging
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "log/LogFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace logging {
+
+    // Identifies a stored message within its log. IDs are assigned in log order when the index
+    // is built and to every later append; they survive deletions and compaction of other
+    // records, but not a restart.
+    using MessageId = std::uint64_t;
+
+    // Selects messages of one log. Unset fields match everything.
+    struct MessageQuery {
+        bool sent = false;
+        std::optional<std::string> peer;   // Exact peer ID
+        std::optional<std::string> topic;  // Exact topic
+        std::int64_t fromNs = std::numeric_limits<std::int64_t>::min();  // Inclusive, epoch nanoseconds
+        std::int64_t toNs = std::numeric_limits<std::int64_t>::max();    // Exclusive, epoch nanoseconds
+        std::size_t offset = 0;                                          // Matches to skip
+        std::size_t limit = std::numeric_limits<std::size_t>::max();     // Matches to return at most
+    };
+
+    // Secondary indexes over one LogFile: every live message by timestamp, and the same keys per
+    // peer and per topic. Each list is kept sorted by (timestamp, id), so a range of one list is
+    // found by binary search and a page of it is read without touching the others; messages
+    // mostly arrive in time order, so keeping a list sorted is usually an append.
+    //
+    // Built on first use by one pass over the mapped records, then kept current by add() and
+    // remove(). Not thread-safe; callers serialize access together with the log's.
+    class MessageIndex {
+    public:
+        // Returns true once build() has run.
+        bool built() const;
+
+        // Indexes every live record of file, assigning IDs in log order.
+        void build(const LogFile& file);
+
+        // Indexes a record just appended to the end of the log. Does nothing until built.
+        void add(std::string_view record);
+
+        // Unindexes the live record at position, which holds record. Call before erasing it
+        // from the log. Does nothing until built.
+        void remove(std::size_t position, std::string_view record);
+
+        // Returns the log position of the live message id, or nothing if it was deleted.
+        std::optional<std::size_t> position(MessageId id) const;
+
+        // Returns the ID of the live message at position.
+        MessageId id(std::size_t position) const;
+
+        // Appends the IDs of a page of matching messages to out, in timestamp order, and returns
+        // the number of matches. query.sent is not consulted; each log has its own index.
+        std::size_t query(const MessageQuery& query, std::vector<MessageId>& out) const;
+
+    private:
+        // Timestamp and ID; the sort order of every list.
+        using Key = std::pair<std::int64_t, MessageId>;
+
+        // Fields a record is indexed under. A record that cannot be decoded is indexed under an
+        // empty peer and topic at time zero, so it is still listed.
+        struct Fields {
+            std::string_view peer;
+            std::string_view topic;
+            std::int64_t timestampNs = 0;
+        };
+
+        // Decodes the indexed fields of a record without copying its strings.
+        static Fields decodeFields(std::string_view record);
+
+        // Adds id to every list its fields belong to.
+        void insert(const Fields& fields, MessageId id);
+
+        // Inserts key into a sorted list, normally at the end.
+        static void insertSorted(std::vector<Key>& list, const Key& key);
+
+        // Removes key from a sorted list.
+        static void eraseSorted(std::vector<Key>& list, const Key& key);
+
+        // Returns the part of a sorted list between the query's bounds.
+        static std::pair<std::vector<Key>::const_iterator, std::vector<Key>::const_iterator>
+        range(const std::vector<Key>& list, const MessageQuery& query);
+
+        // Set once build() has run.
+        bool built_ = false;
+
+        // ID the next appended record gets.
+        MessageId nextId_ = 0;
+
+        // IDs of the live records in log order, which is ascending, so ids_[i] lives at position i.
+        std::vector<MessageId> ids_;
+
+        // Every live record, and the records of each peer and topic, by (timestamp, id).
+        // The maps compare with std::less<> so they are searched by string_view.
+        std::vector<Key> byTime_;
+        std::map<std::string, std::vector<Key>, std::less<>> byPeer_;
+        std::map<std::string, std::vector<Key>, std::less<>> byTopic_;
+    };
+
+}  // namespace logging
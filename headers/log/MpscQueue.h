@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace logging {
+
+    // Unbounded lock-free multi-producer, single-consumer queue.
+    // Producers link a new node with a single atomic exchange and never wait on each other.
+    // Only one thread may call pop(). T must be default constructible.
+    template <typename T>
+    class MpscQueue {
+    public:
+        // Constructs an empty queue holding only the stub node.
+        MpscQueue() : head_(new Node()), tail_(head_.load()) {}
+
+        // Frees all remaining nodes.
+        ~MpscQueue() {
+            T ignore;
+            while (pop(ignore)) {
+            }
+            delete tail_;
+        }
+
+        // Deleted copy constructor and assignment operator to prevent copying.
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+        // Appends a value. Safe to call from any number of threads.
+        void push(T value) {
+            Node* node = new Node(std::move(value));
+            Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_release);
+        }
+
+        // Removes the oldest value into out, returning false if the queue is empty.
+        // A push that has not finished linking its node may not be visible yet.
+        bool pop(T& out) {
+            Node* tail = tail_;
+            Node* next = tail->next.load(std::memory_order_acquire);
+            if (!next) {
+                return false;
+            }
+            out = std::move(next->value);
+            tail_ = next;
+            delete tail;
+            return true;
+        }
+
+        // Returns true if no linked value is waiting. Consumer only.
+        bool empty() const {
+            return tail_->next.load(std::memory_order_acquire) == nullptr;
+        }
+
+    private:
+        // Queue node; the node at tail_ is a stub whose value has already been consumed.
+        struct Node {
+            Node() = default;
+            explicit Node(T v) : value(std::move(v)) {}
+            T value{};
+            std::atomic<Node*> next{nullptr};
+        };
+
+        // Most recently pushed node, shared by producers.
+        std::atomic<Node*> head_;
+
+        // Stub node preceding the oldest value, owned by the consumer.
+        Node* tail_;
+    };
+
+}  // namespace logging
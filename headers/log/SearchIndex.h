@@ -0,0 +1,150 @@
+#pragma once
+
+#include "log/LogFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace logging {
+
+    // One ranked search result: the log offset of a record and its score.
+    struct SearchMatch {
+        std::uint64_t offset;
+        double score;
+    };
+
+    // Persistent full-text index over the topic and content of one LogFile's records.
+    //
+    // Text is split into lowercase terms at every ASCII character that is not a letter or digit;
+    // other bytes, such as UTF-8 letters, are kept. Each term maps to a postings list of
+    // (record offset, term frequency, record length), delta- and varint-encoded and sorted by
+    // offset. Records are ranked by BM25.
+    //
+    // Postings of new records are buffered in memory and written out as immutable,
+    // memory-mapped segment files (path + ".fts.<n>"), each covering a contiguous range of log
+    // offsets. Adjacent segments of similar size are merged, so there are few of them. On
+    // open, a segment is kept only if the record it ends at is still the same, which rejects
+    // segments made stale by compaction; records past the kept segments are indexed again.
+    // Deleted records stay in the postings until then and are filtered out of results.
+    //
+    // Not thread-safe; callers serialize access together with the log's.
+    class SearchIndex {
+    public:
+        // Constructs a closed index for the log at logPath.
+        explicit SearchIndex(const std::string& logPath);
+
+        // Writes out buffered postings.
+        ~SearchIndex();
+
+        // Deleted copy constructor and assignment operator to prevent copying.
+        SearchIndex(const SearchIndex&) = delete;
+        SearchIndex& operator=(const SearchIndex&) = delete;
+
+        // Returns true between open() and close() or discard().
+        bool isOpen() const;
+
+        // Maps the segments still valid for file, deletes the others and indexes the live
+        // records they do not cover.
+        void open(const LogFile& file);
+
+        // Writes out buffered postings and unmaps the segments.
+        void close();
+
+        // Drops buffered postings and unmaps the segments, for when the log is about to be
+        // rewritten and record offsets change.
+        void discard();
+
+        // Indexes a record appended at offset, past every record indexed so far. Does nothing
+        // until open.
+        void add(std::uint64_t offset, std::string_view record);
+
+        // Appends the best limit matches for the terms of text, best first, and returns the
+        // number of live records of file matching any term.
+        std::size_t search(std::string_view text, std::size_t limit, const LogFile& file,
+                           std::vector<SearchMatch>& out) const;
+
+    private:
+        // Occurrence of a term in a record.
+        struct Posting {
+            std::uint64_t offset;
+            std::uint32_t frequency;
+            std::uint32_t length;
+        };
+
+        // Reads the postings of one term in offset order.
+        class Cursor;
+
+        // Memory-mapped segment file and the fields of its header.
+        struct Segment {
+            ~Segment();
+
+            std::string path;
+            std::uint64_t sequence = 0;
+            const char* data = nullptr;
+            std::size_t size = 0;
+            std::uint64_t start = 0;        // First offset covered
+            std::uint64_t end = 0;          // First offset past the coverage
+            std::uint64_t lastOffset = 0;   // Offset of the last record indexed
+            std::uint64_t fingerprint = 0;  // Hash of that record
+            std::uint64_t documents = 0;
+            std::uint64_t totalLength = 0;
+            std::uint64_t termCount = 0;
+            std::uint64_t dictionaryOffset = 0;
+
+            // Returns the term of dictionary entry i.
+            std::string_view term(std::size_t i) const;
+
+            // Returns the encoded postings of dictionary entry i.
+            std::string_view postings(std::size_t i) const;
+
+            // Returns the number of records containing the term of dictionary entry i.
+            std::uint32_t documentFrequency(std::size_t i) const;
+
+            // Returns the offset of the last posting of dictionary entry i.
+            std::uint64_t lastPosting(std::size_t i) const;
+
+            // Returns the dictionary entry of term, or termCount if absent.
+            std::size_t find(std::string_view term) const;
+        };
+
+        // Maps and validates a segment file; returns nullptr if it is not one.
+        static std::unique_ptr<Segment> load(const std::string& path, std::uint64_t sequence);
+
+        // Writes the buffered postings as a new segment, then merges segments of similar size.
+        void flush();
+
+        // Replaces the last two segments with one covering both. Returns false if it could not.
+        bool mergeLast();
+
+        // Writes the bytes of a segment to a new file and maps it.
+        std::unique_ptr<Segment> writeSegment(const std::string& bytes);
+
+        // Path of the log, the prefix of the segment files.
+        std::string logPath_;
+
+        // Set by open(), cleared by close() and discard().
+        bool open_ = false;
+
+        // Segments in offset order, each starting where the previous one ends.
+        std::vector<std::unique_ptr<Segment>> segments_;
+
+        // Number the next segment file gets.
+        std::uint64_t nextSequence_ = 0;
+
+        // Postings of records added since the last segment, by term, in offset order.
+        std::unordered_map<std::string, std::vector<Posting>> buffer_;
+
+        // Offset range, size and totals of the buffered records.
+        std::uint64_t bufferStart_ = 0;
+        std::uint64_t bufferLastOffset_ = 0;
+        std::string bufferLastRecord_;
+        std::uint64_t bufferDocuments_ = 0;
+        std::uint64_t bufferLength_ = 0;
+        std::size_t bufferBytes_ = 0;
+    };
+
+}  // namespace logging
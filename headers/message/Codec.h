@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace message {
+
+    // Appends an unsigned LEB128 varint to out.
+    void putVarint(std::string& out, std::uint64_t value);
+
+    // Appends a fixed-width little-endian 64-bit integer to out.
+    void putFixed64(std::string& out, std::uint64_t value);
+
+    // Appends a varint length followed by the bytes of value.
+    void putBytes(std::string& out, std::string_view value);
+
+    // Sequential reader over an encoded buffer.
+    // Every accessor throws std::runtime_error when the buffer is too short or malformed.
+    class ByteReader {
+    public:
+        // Constructs a reader positioned at the start of data.
+        explicit ByteReader(std::string_view data);
+
+        // Reads one byte.
+        std::uint8_t readByte();
+
+        // Reads an unsigned LEB128 varint.
+        std::uint64_t readVarint();
+
+        // Reads a fixed-width little-endian 64-bit integer.
+        std::uint64_t readFixed64();
+
+        // Reads a varint length and returns a view of that many following bytes.
+        std::string_view readBytes();
+
+        // Returns a view of the next count bytes.
+        std::string_view readRaw(std::size_t count);
+
+        // Returns the number of bytes consumed so far.
+        std::size_t position() const;
+
+        // Returns the number of bytes left to read.
+        std::size_t remaining() const;
+
+    private:
+        // Buffer being read.
+        std::string_view data_;
+
+        // Offset of the next unread byte.
+        std::size_t pos_ = 0;
+    };
+
+}  // namespace message
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "storage/Hash.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace message {
+
+    // Version written in the first byte of every encoded manifest.
+    constexpr std::uint8_t MANIFEST_FORMAT_VERSION = 1;
+
+    // Largest chunk size a manifest may declare.
+    constexpr std::uint32_t MAX_CHUNK_SIZE = 8 * 1024 * 1024;
+
+    // Description of a shared file: its name, size and the SHA-256 of each fixed-size chunk.
+    // A file is identified by the digest of its encoded manifest, and each chunk by its own
+    // digest, so identical chunks are recognised across files and transfers.
+    class Manifest {
+    public:
+        // Constructs an empty manifest.
+        Manifest() = default;
+
+        // Constructs a manifest from its parts.
+        Manifest(std::string name, std::uint64_t size, std::uint32_t chunkSize, std::vector<storage::Digest> chunks);
+
+        // Returns the file name, without any directory.
+        const std::string& getName() const;
+
+        // Returns the file size in bytes.
+        std::uint64_t getSize() const;
+
+        // Returns the size of every chunk except possibly the last.
+        std::uint32_t getChunkSize() const;
+
+        // Returns the number of chunks.
+        std::size_t chunkCount() const;
+
+        // Returns the digest of the chunk at index.
+        const storage::Digest& chunkHash(std::size_t index) const;
+
+        // Returns the byte offset of the chunk at index.
+        std::uint64_t chunkOffset(std::size_t index) const;
+
+        // Returns the length of the chunk at index.
+        std::uint32_t chunkLength(std::size_t index) const;
+
+        // Returns the manifest's identity: the digest of its encoding.
+        storage::Digest id() const;
+
+        // Appends the binary encoding to out.
+        // Layout: version byte, varint-length name, varint size, varint chunk size,
+        // then the raw 32-byte digest of every chunk.
+        void encode(std::string& out) const;
+
+        // Decodes a manifest. Throws std::runtime_error if malformed or inconsistent.
+        static Manifest decode(std::string_view data);
+
+    private:
+        // File name.
+        std::string name_;
+
+        // File size in bytes.
+        std::uint64_t size_ = 0;
+
+        // Chunk size in bytes.
+        std::uint32_t chunkSize_ = 0;
+
+        // Digest of every chunk, in file order.
+        std::vector<storage::Digest> chunks_;
+    };
+
+}  // namespace message
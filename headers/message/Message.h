@@ -1,12 +1,29 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace message {
 
     enum class MessageType { SENT, RECEIVED };
 
+    // Version written in the first byte of every binary-encoded message.
+    constexpr std::uint8_t MESSAGE_FORMAT_VERSION = 1;
+
+    // Decoded message whose strings reference the encoded buffer.
+    // Valid only as long as that buffer is.
+    struct MessageView {
+        std::string_view peerID;
+        std::string_view topic;
+        std::string_view content;
+        MessageType type;
+        bool read;
+        std::int64_t timestampNs;
+    };
+
     class Message {
     public:
         // Constructs a Message with peer ID, topic, content, and type.
@@ -15,6 +32,9 @@ namespace message {
             const std::string& content,
             MessageType type);
 
+        // Constructs a Message by copying a decoded view, overriding its type.
+        Message(const MessageView& view, MessageType type);
+
         // Returns the peer ID associated with the message.
         const std::string& getPeerID() const;
 
@@ -36,11 +56,26 @@ namespace message {
         // Marks the message as read.
         void markRead();
 
-        // Encodes the message into a string for logging.
+        // Encodes the message in the binary format for logging and the wire.
+        // Layout: fixed header (version, type, flags, 8-byte epoch-nanosecond timestamp)
+        // followed by varint-length peer ID, topic and content.
         std::string encode() const;
 
-        // Decodes a string into a Message object.
-        static Message decode(const std::string& line);
+        // Appends the binary encoding to a caller-provided buffer.
+        void encode(std::string& out) const;
+
+        // Decodes a binary-encoded message into a Message object.
+        static Message decode(std::string_view data);
+
+        // Decodes a binary-encoded message into views over data, without copying strings.
+        // Returns the number of bytes consumed. Throws std::runtime_error if malformed.
+        static std::size_t decodeView(std::string_view data, MessageView& view);
+
+        // Encodes the message as a human-readable '|'-separated line, for export only.
+        std::string encodeText() const;
+
+        // Decodes a line produced by encodeText() or by the legacy text log.
+        static Message decodeText(std::string_view line);
 
         // Returns a string representation of the message for UI display.
         std::string toString() const;
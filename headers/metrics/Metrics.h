@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace metrics {
+
+    // Number of cells every counter and histogram is split into. Each thread updates the cell
+    // picked by threadStripe(), so threads rarely touch the same cache line and an update is one
+    // uncontended atomic add; reading sums the cells.
+    constexpr std::size_t STRIPES = 8;
+
+    // Returns the stripe of the calling thread, assigned round-robin on first use.
+    std::size_t threadStripe();
+
+    // Monotonic counter that any thread may increment.
+    class Counter {
+    public:
+        // Adds n to the counter.
+        void add(std::uint64_t n = 1) {
+            cells_[threadStripe()].value.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        // Returns the sum over all threads.
+        std::uint64_t value() const;
+
+    private:
+        struct alignas(64) Cell {
+            std::atomic<std::uint64_t> value{0};
+        };
+        std::array<Cell, STRIPES> cells_;
+    };
+
+    // Distribution of durations over fixed buckets that any thread may record into.
+    class Histogram {
+    public:
+        // Number of finite bucket bounds; one more bucket holds everything above the last.
+        static constexpr std::size_t BOUNDS = 22;
+
+        // Upper bounds of the buckets in nanoseconds, in 1-2-5 steps from 1 µs to 10 s.
+        static const std::array<std::uint64_t, BOUNDS> BOUNDS_NS;
+
+        // Consistent-enough copy of the buckets, count and sum.
+        struct Snapshot {
+            std::array<std::uint64_t, BOUNDS + 1> counts{};  // Per bucket, not cumulative
+            std::uint64_t count = 0;
+            std::uint64_t sumNs = 0;
+
+            // Estimates the duration below which a fraction q of the samples lie, in nanoseconds,
+            // interpolating within the bucket. Returns 0 if empty, and the last bound past it.
+            double quantile(double q) const;
+        };
+
+        // Records one duration.
+        void observe(std::chrono::nanoseconds duration);
+
+        // Returns the sums over all threads.
+        Snapshot snapshot() const;
+
+    private:
+        struct alignas(64) Stripe {
+            std::array<std::atomic<std::uint64_t>, BOUNDS + 1> counts{};
+            std::atomic<std::uint64_t> sumNs{0};
+        };
+        std::array<Stripe, STRIPES> stripes_;
+    };
+
+}  // namespace metrics
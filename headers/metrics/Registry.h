@@ -0,0 +1,91 @@
+#pragma once
+
+#include "metrics/Metrics.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace metrics {
+
+    // Label names and values of one sample.
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    // Builds the Prometheus text exposition format. Every metric family starts with family(),
+    // followed by all of its samples.
+    class TextWriter {
+    public:
+        // Starts a family with its help text and type: "counter", "gauge" or "histogram".
+        void family(const std::string& name, const std::string& help, const char* type);
+
+        // Writes one counter or gauge sample.
+        void sample(const std::string& name, const Labels& labels, double value);
+
+        // Writes the cumulative buckets, sum and count of a histogram, in seconds.
+        void histogram(const std::string& name, const Labels& labels, const Histogram::Snapshot& snapshot);
+
+        // Returns the text written so far.
+        const std::string& str() const;
+
+    private:
+        // Appends name{labels} followed by a space.
+        void writeSeries(const std::string& name, const Labels& labels);
+
+        std::string out_;
+    };
+
+    // Process-wide set of named counters and histograms, plus collectors that report metrics
+    // kept elsewhere, such as each peer's own counters.
+    class Registry {
+    public:
+        // Returns the singleton instance of Registry.
+        static Registry& instance();
+
+        // Returns the counter named name, creating it on first use. The reference stays valid
+        // for the life of the process. Safe to call from any thread.
+        Counter& counter(const std::string& name, const std::string& help);
+
+        // Returns the histogram named name, creating it on first use. The reference stays
+        // valid for the life of the process. Safe to call from any thread.
+        Histogram& histogram(const std::string& name, const std::string& help);
+
+        // Returns the counter or histogram named name, or nullptr if none was created.
+        const Counter* findCounter(const std::string& name) const;
+        const Histogram* findHistogram(const std::string& name) const;
+
+        // Registers a callback that writes further families on every export.
+        void addCollector(std::function<void(TextWriter&)> collector);
+
+        // Returns every metric in the Prometheus text exposition format.
+        std::string exportText() const;
+
+    private:
+        Registry() = default;
+
+        Registry(const Registry&) = delete;
+        Registry& operator=(const Registry&) = delete;
+
+        // Named metric; exactly one of counter and histogram is set.
+        struct Entry {
+            std::string name;
+            std::string help;
+            std::unique_ptr<Counter> counter;
+            std::unique_ptr<Histogram> histogram;
+        };
+
+        // Returns the entry named name, or nullptr. Called with mutex_ held.
+        const Entry* find(const std::string& name) const;
+
+        // Mutex guarding entries_ and collectors_; never taken when updating a metric.
+        mutable std::mutex mutex_;
+
+        // Metrics in registration order.
+        std::vector<Entry> entries_;
+
+        // Callbacks run by exportText() after the registered metrics.
+        std::vector<std::function<void(TextWriter&)>> collectors_;
+    };
+
+}  // namespace metrics
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace network {
+
+    // Bounded lock-free multi-producer, multi-consumer queue over a ring of cells.
+    // Each cell carries a sequence number telling producers and consumers whose turn it is,
+    // so a push or pop costs one compare-and-swap on the shared position and never waits.
+    // T must be default constructible and move assignable.
+    template <typename T>
+    class BoundedQueue {
+    public:
+        // Constructs an empty queue holding at least capacity values (rounded up to a power of two).
+        explicit BoundedQueue(std::size_t capacity) {
+            std::size_t size = 2;
+            while (size < capacity) {
+                size *= 2;
+            }
+            mask_ = size - 1;
+            cells_ = std::make_unique<Cell[]>(size);
+            for (std::size_t i = 0; i < size; ++i) {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        // Deleted copy constructor and assignment operator to prevent copying.
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        // Appends a value, returning false without consuming it if the queue is full.
+        bool tryPush(T& value) {
+            std::size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+            while (true) {
+                Cell& cell = cells_[pos & mask_];
+                std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+                if (diff == 0) {
+                    if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        cell.value = std::move(value);
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = enqueuePos_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Removes the oldest value into out, returning false if the queue is empty.
+        bool tryPop(T& out) {
+            std::size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+            while (true) {
+                Cell& cell = cells_[pos & mask_];
+                std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+                if (diff == 0) {
+                    if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        out = std::move(cell.value);
+                        cell.value = T();
+                        cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = dequeuePos_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Returns true if no value is waiting. Only a hint while other threads push or pop.
+        bool empty() const {
+            std::size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+            return cells_[pos & mask_].sequence.load(std::memory_order_acquire) != pos + 1;
+        }
+
+    private:
+        // Ring slot; its sequence equals the position a producer may fill next,
+        // or that position plus one once the value is ready for a consumer.
+        struct Cell {
+            std::atomic<std::size_t> sequence{0};
+            T value{};
+        };
+
+        // Ring of capacity cells.
+        std::unique_ptr<Cell[]> cells_;
+
+        // Capacity minus one, for wrapping positions.
+        std::size_t mask_ = 0;
+
+        // Next position to push to, on its own cache line.
+        alignas(64) std::atomic<std::size_t> enqueuePos_{0};
+
+        // Next position to pop from, on its own cache line.
+        alignas(64) std::atomic<std::size_t> dequeuePos_{0};
+    };
+
+}  // namespace network
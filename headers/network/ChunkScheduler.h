@@ -0,0 +1,115 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace network {
+
+    class Peer;
+
+    // Decides which chunks of one download to request from which source.
+    //
+    // Chunks are requested rarest-first: among the chunks a source can serve that nobody
+    // has been asked for, those held by the fewest sources go first, so scarce chunks spread
+    // before their holders leave. Each source gets a window of outstanding requests sized
+    // from its measured throughput, so fast sources receive more of the work. A request
+    // outstanding far longer than its source's throughput predicts is released for other
+    // sources and the slow source's window shrinks. A source that has delivered nothing for
+    // far longer than any source should take is reported as stalled. Once every missing chunk has been
+    // requested (endgame), the remaining ones are also requested from other idle sources
+    // and whichever copy arrives first is kept.
+    // Not thread-safe; callers serialize access.
+    class ChunkScheduler {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // Identifies a source; only compared, never dereferenced.
+        using Source = const Peer*;
+
+        // Constructs a scheduler for chunks of the given lengths, some of which may already be held.
+        ChunkScheduler(std::vector<std::uint32_t> lengths, std::vector<bool> have);
+
+        // Adds a source or replaces its availability. Requests to it for chunks it no longer
+        // reports are released.
+        void updateSource(Source source, const std::vector<bool>& available);
+
+        // Removes a source and releases its outstanding requests.
+        void removeSource(Source source);
+
+        // Returns true if the source is known.
+        bool hasSource(Source source) const;
+
+        // Returns the number of sources.
+        std::size_t sourceCount() const;
+
+        // Returns every source.
+        std::vector<Source> sources() const;
+
+        // Releases requests that are overdue for their source's throughput.
+        void releaseOverdue(Clock::time_point now);
+
+        // Returns the sources with requests outstanding that have delivered nothing since
+        // well past the hard limit on any request. Callers drop them.
+        std::vector<Source> stalled(Clock::time_point now) const;
+
+        // Picks chunks to request from source now and marks them outstanding.
+        std::vector<std::size_t> next(Source source, Clock::time_point now);
+
+        // Records that a chunk arrived from source and was verified. Returns false if it was already held.
+        bool completed(Source source, std::size_t index, Clock::time_point now);
+
+        // Records that a chunk from source failed verification; it is requested again.
+        void failed(Source source, std::size_t index);
+
+        // Returns true if the chunk is held.
+        bool has(std::size_t index) const;
+
+        // Returns the held chunks.
+        const std::vector<bool>& have() const;
+
+        // Returns true once every chunk is held.
+        bool done() const;
+
+        // Returns the source's measured throughput in bytes per second, or 0 before the first chunk.
+        double throughput(Source source) const;
+
+    private:
+        // Per-source state.
+        struct SourceState {
+            std::vector<bool> available;
+            std::map<std::size_t, Clock::time_point> outstanding;
+            double bytesPerSecond = 0;
+            Clock::time_point lastArrival{};
+            Clock::time_point waitingSince{};  // First request since the last arrival, if any
+            std::size_t window = 0;
+        };
+
+        // Drops an outstanding request from a source.
+        void release(SourceState& state, std::size_t index);
+
+        // Returns when a request to the source sent at sentAt is considered overdue.
+        Clock::time_point deadline(const SourceState& state, std::size_t index, Clock::time_point sentAt) const;
+
+        // Length of every chunk.
+        std::vector<std::uint32_t> lengths_;
+
+        // Chunks held.
+        std::vector<bool> have_;
+
+        // Number of chunks not yet held.
+        std::size_t remaining_ = 0;
+
+        // Number of sources holding each chunk.
+        std::vector<std::uint32_t> availability_;
+
+        // Number of sources each chunk is currently requested from.
+        std::vector<std::uint32_t> requested_;
+
+        // State of every source.
+        std::map<Source, SourceState> sources_;
+    };
+
+}  // namespace network
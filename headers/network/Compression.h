@@ -0,0 +1,69 @@
+#pragma once
+
+#include "network/Frame.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct z_stream_s;
+
+namespace network {
+
+    // Largest run of frames compressed together; a single larger frame is compressed alone.
+    // Receivers accept batches inflating to this size even if their frame limit is lower.
+    constexpr std::size_t MAX_COMPRESSED_RUN = 1024 * 1024;
+
+    // Runs smaller than this are sent as they are; deflate would save little and cost a call.
+    constexpr std::size_t MIN_COMPRESSED_RUN = 512;
+
+    // Deflate compression of runs of frames for one connection.
+    //
+    // A run of complete frames (headers included) is deflated into a single COMPRESSED frame
+    // whose payload is the varint length of the run followed by the raw deflate stream; the
+    // receiver inflates it and handles the inner frames as if they had arrived one by one.
+    // Compressing several frames together finds repeats across them that single small messages
+    // do not have. When a run does not shrink by at least an eighth, compression is skipped for
+    // a growing number of following runs, so incompressible traffic costs little CPU.
+    // Streams are created on first use and reused. Not thread-safe; used on the peer's executor.
+    class FrameCompressor {
+    public:
+        // Constructs a compressor without allocating any zlib state.
+        FrameCompressor();
+
+        // Frees the zlib streams.
+        ~FrameCompressor();
+
+        // Deleted copy constructor and assignment operator to prevent copying.
+        FrameCompressor(const FrameCompressor&) = delete;
+        FrameCompressor& operator=(const FrameCompressor&) = delete;
+
+        // Compresses a run of encoded frames totalling bytes into a COMPRESSED frame.
+        // Returns null if the run is too small, compression is backing off, or it did not pay.
+        SharedFrame compress(const std::vector<SharedFrame>& frames, std::size_t bytes);
+
+        // Inflates a COMPRESSED payload into out. Throws std::runtime_error if it is malformed
+        // or would inflate beyond maxSize bytes.
+        void decompress(std::string_view payload, std::size_t maxSize, std::string& out);
+
+    private:
+        // Releases a zlib stream with the matching end function.
+        struct DeflateEnd {
+            void operator()(z_stream_s* stream) const;
+        };
+        struct InflateEnd {
+            void operator()(z_stream_s* stream) const;
+        };
+
+        // Streams, created on first use.
+        std::unique_ptr<z_stream_s, DeflateEnd> deflater_;
+        std::unique_ptr<z_stream_s, InflateEnd> inflater_;
+
+        // Runs left to send uncompressed, and the number to skip after the next poor ratio.
+        std::size_t skip_ = 0;
+        std::size_t backoff_;
+    };
+
+}  // namespace network
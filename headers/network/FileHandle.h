@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace network {
+
+    // Owns an open file descriptor and closes it on destruction.
+    // Shared between a transfer and the write queue entries that send from it.
+    class FileHandle {
+    public:
+        // Takes ownership of fd; a negative fd means the open failed.
+        explicit FileHandle(int fd);
+
+        // Closes the descriptor.
+        ~FileHandle();
+
+        // Deleted copy constructor and assignment operator to prevent copying.
+        FileHandle(const FileHandle&) = delete;
+        FileHandle& operator=(const FileHandle&) = delete;
+
+        // Returns the descriptor.
+        int fd() const;
+
+        // Returns true if the descriptor is valid.
+        bool isOpen() const;
+
+        // Returns the file size in bytes, or 0 if unknown.
+        std::uint64_t size() const;
+
+    private:
+        // Owned file descriptor.
+        int fd_;
+    };
+
+}  // namespace network
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "message/Manifest.h"
+#include "network/ChunkScheduler.h"
+#include "network/FileHandle.h"
+#include "network/Frame.h"
+#include "network/Peer.h"
+#include "storage/ChunkStore.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace network {
+
+    // Description of a transfer, passed to the offer handler and used for display.
+    struct TransferInfo {
+        bool outgoing = false;
+        std::string peerID;
+        std::string name;
+        std::uint64_t size = 0;
+        std::uint64_t bytesDone = 0;
+        std::uint64_t bytesReused = 0;
+        std::string state;
+
+        // Returns a single-line summary for UI display.
+        std::string toString() const;
+    };
+
+    // Moves files between peers as content-addressed chunks over the peers' frame streams.
+    //
+    // Protocol: the sender offers a file by sending its manifest (FILE_MANIFEST). The receiver
+    // first fills in every chunk it can find locally through the chunk store — chunks of earlier
+    // downloads, of other files, or verified chunks of an interrupted attempt at this one — and
+    // then pulls only the missing chunks by index (CHUNK_REQUEST). Each CHUNK_DATA is checked
+    // against the manifest digest before it is written and indexed. The receiver reports
+    // completion (FILE_DONE); either side may decline or abort (FILE_CANCEL). Partial files are
+    // kept, so offering the same file again resumes it.
+    //
+    // A download is a swarm: the receiver asks every other connected peer which chunks of the
+    // file it holds (FILE_QUERY), and peers holding any — complete copies or downloads still in
+    // progress — answer with a bitfield (FILE_HAVE) and keep sending updates as they gain chunks.
+    // A ChunkScheduler per download spreads requests across all sources.
+    // Chunk data is sent with sendfile() from wherever the store has it and never enters the message log.
+    class FileTransferManager {
+    public:
+        // Constructs a manager saving accepted files into "downloads", with its chunk index in "chunks".
+        FileTransferManager();
+
+        // Indexes the file at path and offers it to the peer. Returns the file ID in hex.
+        // Throws std::runtime_error if the file cannot be read.
+        std::string offerFile(const std::shared_ptr<Peer>& peer, const std::string& path);
+
+        // Handles a file frame received from the peer.
+        void handleFrame(const std::shared_ptr<Peer>& peer, const FrameView& frame);
+
+        // Stops every transfer with a peer that has disconnected. Partial downloads are kept.
+        void peerDisconnected(const std::shared_ptr<Peer>& peer);
+
+        // Sets the directory incoming files are saved into.
+        void setDownloadDirectory(const std::string& directory);
+
+        // Registers a callback deciding whether to accept an offer. Accepts all offers if unset.
+        void setOfferHandler(std::function<bool(const TransferInfo&)> handler);
+
+        // Registers a callback returning the connected peers, which are asked for chunks of new downloads.
+        void setPeerSource(std::function<std::vector<std::shared_ptr<Peer>>()> source);
+
+        // Returns descriptions of active and recently finished transfers.
+        std::vector<std::string> listTransferInfo() const;
+
+        // Rechecks every download for overdue requests and stalled sources. Called periodically,
+        // so downloads whose sources have all gone quiet still move on or end.
+        void tick();
+
+    private:
+        // A file being served to a peer.
+        struct Upload {
+            std::string peerID;
+            std::string name;
+            std::uint64_t size = 0;
+            std::uint64_t bytesSent = 0;
+        };
+
+        // A file being downloaded from one or more peers.
+        struct Download {
+            std::string peerID;
+            std::string name;
+            message::Manifest manifest;
+            std::string partPath;
+            std::shared_ptr<FileHandle> file;
+            std::optional<ChunkScheduler> scheduler;
+            std::map<const Peer*, std::weak_ptr<Peer>> sources;
+            std::map<const Peer*, std::weak_ptr<Peer>> interested;
+            std::map<const Peer*, unsigned> failures;
+            std::uint64_t bytesDone = 0;
+            std::uint64_t bytesReused = 0;
+            std::size_t chunksSinceHave = 0;
+        };
+
+        // Key of an upload: the receiving peer and the file ID.
+        using UploadKey = std::pair<const Peer*, storage::Digest>;
+
+        // Frame handlers, called with mutex_ held.
+        void handleManifest(const std::shared_ptr<Peer>& peer, std::string_view payload);
+        void handleChunkRequest(const std::shared_ptr<Peer>& peer, std::string_view payload);
+        void handleChunkData(const std::shared_ptr<Peer>& peer, std::string_view payload);
+        void handleDone(const std::shared_ptr<Peer>& peer, std::string_view payload);
+        void handleCancel(const std::shared_ptr<Peer>& peer, std::string_view payload);
+        void handleQuery(const std::shared_ptr<Peer>& peer, std::string_view payload);
+        void handleHave(const std::shared_ptr<Peer>& peer, std::string_view payload);
+
+        // Returns which chunks are already available locally, copying them into the partial file if needed.
+        std::vector<bool> reuseLocalChunks(Download& download);
+
+        // Drops stalled sources, then asks every source for chunks until its request window is full.
+        // May finish the download, like removeSource().
+        void requestChunks(const storage::Digest& id, Download& download);
+
+        // Drops a source from a download; finishes the download with state if none remain.
+        // Returns false if the download was finished.
+        bool removeSource(const storage::Digest& id, Download& download, const Peer* source, const std::string& state);
+
+        // Sends the peer a bitfield of the chunks of a file held locally.
+        void sendHave(const std::shared_ptr<Peer>& peer, const storage::Digest& id, const std::vector<bool>& have);
+
+        // Sends one chunk from the store to the peer. Returns false if no local copy exists.
+        bool sendChunk(const std::shared_ptr<Peer>& peer, const storage::Digest& id,
+                       std::size_t index, const message::Manifest& manifest);
+
+        // Returns an open descriptor for a file served from, reusing recently opened ones.
+        std::shared_ptr<FileHandle> openShared(const std::string& path);
+
+        // Moves a transfer to the finished list with the given final state.
+        void finishUpload(const UploadKey& key, const std::string& state);
+        void finishDownload(const storage::Digest& id, const std::string& state);
+
+        // Records a finished transfer, keeping only the most recent ones.
+        void rememberFinished(TransferInfo info);
+
+        // Mutex guarding all transfer state.
+        mutable std::mutex mutex_;
+
+        // Index of every chunk held locally.
+        storage::ChunkStore store_;
+
+        // Manifests of files this node can serve, by file ID.
+        std::map<storage::Digest, message::Manifest> manifests_;
+
+        // Files being served, by receiving peer and file ID.
+        std::map<UploadKey, Upload> uploads_;
+
+        // Files being downloaded, by file ID.
+        std::map<storage::Digest, Download> downloads_;
+
+        // Recently finished transfers, newest last.
+        std::deque<TransferInfo> finished_;
+
+        // Recently opened files chunks are served from, by path.
+        std::unordered_map<std::string, std::shared_ptr<FileHandle>> openFiles_;
+
+        // Directory incoming files are saved into.
+        std::string downloadDirectory_ = "downloads";
+
+        // Callback deciding whether to accept an offer.
+        std::function<bool(const TransferInfo&)> offerHandler_;
+
+        // Callback returning the connected peers.
+        std::function<std::vector<std::shared_ptr<Peer>>()> peerSource_;
+    };
+
+}  // namespace network
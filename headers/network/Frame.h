@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace network {
+
+    // Kind of payload carried by a frame.
+    enum class FrameType : std::uint8_t {
+        MESSAGE = 1,        // Encoded message::Message
+        FILE_MANIFEST = 2,  // Encoded message::Manifest of a file offered to the peer
+        CHUNK_REQUEST = 3,  // Receiver asks for chunks of a file by index
+        CHUNK_DATA = 4,     // One chunk of file data
+        FILE_DONE = 5,      // Receiver holds every chunk of a file
+        FILE_CANCEL = 6,    // Either side declines or aborts a transfer
+        FILE_QUERY = 7,     // Asks which chunks of a file the peer holds
+        FILE_HAVE = 8,      // Bitfield of the chunks of a file the sender holds
+        HELLO = 9,          // Encoded network::Hello, the first frame on every connection
+        PING = 10,          // Keepalive probe sent to a peer that has been silent; empty payload
+        PONG = 11,          // Answer to PING; empty payload
+        GOSSIP = 12,        // Message ID, TTL and encoded message::Message, relayed beyond the receiver
+        SUBSCRIBE = 13,     // Encoded network::Subscribe, the topics the sender wants broadcasts for
+        COMPRESSED = 14,    // Deflated run of complete frames; see network::FrameCompressor
+        RECORD = 15         // Encrypted slice of the frame stream; see network::RecordCipher
+    };
+
+    // Frame header: 4-byte big-endian payload length followed by a 1-byte frame type.
+    constexpr std::size_t FRAME_HEADER_SIZE = 5;
+
+    // Default upper bound on a single frame's payload (16 MiB).
+    constexpr std::size_t DEFAULT_MAX_FRAME_SIZE = 16 * 1024 * 1024;
+
+    // A complete frame referencing bytes owned by a FrameBuffer.
+    struct FrameView {
+        FrameType type;
+        std::string_view payload;
+    };
+
+    // Immutable encoded frame (header and payload) shared by every queue that sends it.
+    using SharedFrame = std::shared_ptr<const std::string>;
+
+    // Writes a frame header for a payload of the given length into out.
+    void writeFrameHeader(char* out, FrameType type, std::uint32_t length);
+
+    // Encodes a payload into a new string holding the header followed by the payload.
+    std::string encodeFrame(FrameType type, std::string_view payload);
+
+    // Encodes a payload once into a frame that can be queued on any number of peers.
+    SharedFrame makeSharedFrame(FrameType type, std::string_view payload);
+
+    // Growable receive buffer that reassembles length-prefixed frames from a byte stream.
+    // Consumed space is reclaimed by sliding the unread tail to the front, so every frame
+    // handed out is contiguous and can be referenced without copying.
+    class FrameBuffer {
+    public:
+        // Constructs an empty buffer accepting frames up to maxFrameSize bytes of payload.
+        explicit FrameBuffer(std::size_t maxFrameSize = DEFAULT_MAX_FRAME_SIZE);
+
+        // Returns a writable region of at least minSize bytes for the next socket read.
+        // The region grows to fit a partially received frame. Invalidates frame views.
+        std::pair<char*, std::size_t> prepare(std::size_t minSize);
+
+        // Marks bytes written into the region returned by prepare() as readable.
+        void commit(std::size_t bytes);
+
+        // Extracts the next complete frame, returning false if more bytes are needed.
+        // The view stays valid until the next call to prepare() or nextFrame().
+        // Throws std::length_error if the pending frame exceeds the maximum frame size.
+        bool nextFrame(FrameView& frame);
+
+        // Sets the maximum accepted payload size.
+        void setMaxFrameSize(std::size_t maxFrameSize);
+
+        // Returns the number of buffered bytes not yet extracted as frames.
+        std::size_t pending() const;
+
+    private:
+        // Bytes still missing for the frame at the read position, or 0 if unknown.
+        std::size_t missingForCurrentFrame() const;
+
+        // Backing storage; readable bytes are [head_, tail_).
+        std::vector<char> storage_;
+
+        // Read position of the next unextracted frame.
+        std::size_t head_ = 0;
+
+        // Write position for the next socket read.
+        std::size_t tail_ = 0;
+
+        // Initial capacity, restored once an oversized frame has been drained.
+        std::size_t initialCapacity_;
+
+        // Maximum accepted payload size.
+        std::size_t maxFrameSize_;
+    };
+
+}  // namespace network
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "network/Frame.h"
+#include "network/SeenFilter.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string_view>
+#include <vector>
+
+namespace network {
+
+    class Peer;
+
+    // Epidemic broadcast of messages beyond the directly connected peers.
+    //
+    // Every gossiped message carries a random ID and a hop budget (TTL). A node that receives a
+    // message for the first time delivers it and relays it, with the TTL lowered by one, to a
+    // bounded random subset of its peers; copies arriving again over other paths are recognized
+    // by their ID in a time-windowed seen-set and dropped. With fan-out f, a message reaches
+    // most of a connected network within a number of hops logarithmic in its size, while each
+    // node sends at most f copies of it.
+    // Thread-safe.
+    class GossipRouter {
+    public:
+        // Fan-out and TTL applied to new and relayed messages.
+        struct Options {
+            std::size_t fanout = 4;
+            std::uint8_t ttl = 8;
+        };
+
+        // Constructs a router with an empty seen-set.
+        GossipRouter();
+
+        // Sets the fan-out and the TTL of messages sent from this node.
+        void setOptions(const Options& options);
+
+        // Returns the current options.
+        Options options() const;
+
+        // Builds the frame for a new message from this node and marks its ID as seen,
+        // so copies relayed back are not delivered again.
+        SharedFrame originate(std::string_view message);
+
+        // Checks a received gossip payload. Returns false for malformed payloads and IDs already
+        // seen. Otherwise sets message to the encoded message it carries and relay to the frame
+        // to pass on, or to null if its TTL is spent.
+        bool receive(std::string_view payload, std::string_view& message, SharedFrame& relay);
+
+        // Picks up to fan-out peers at random among those that speak gossip, skipping exclude.
+        std::vector<std::shared_ptr<Peer>> pickTargets(std::vector<std::shared_ptr<Peer>> peers, const Peer* exclude);
+
+    private:
+        // Payload header: message ID followed by a 1-byte TTL.
+        static constexpr std::size_t HEADER_SIZE = sizeof(MessageId) + 1;
+
+        // Guards every member below.
+        mutable std::mutex mutex_;
+
+        // IDs of recently delivered messages.
+        SeenFilter seen_;
+
+        // Source of message IDs and target choices.
+        std::mt19937_64 random_;
+
+        // Fan-out and TTL.
+        Options options_;
+    };
+
+}  // namespace network
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace network {
+
+    // Version of the peer protocol announced in the handshake. Peers speaking another version are disconnected.
+    constexpr std::uint8_t PROTOCOL_VERSION = 1;
+
+    // Capability bits announced in the handshake.
+    constexpr std::uint64_t CAPABILITY_FILE_TRANSFER = 1ULL << 0;  // Manifest, chunk request and chunk data frames
+    constexpr std::uint64_t CAPABILITY_SWARM = 1ULL << 1;          // Chunk availability queries between downloaders
+    constexpr std::uint64_t CAPABILITY_KEEPALIVE = 1ULL << 2;      // Answers PING, so silence means the link is dead
+    constexpr std::uint64_t CAPABILITY_GOSSIP = 1ULL << 3;         // Accepts and relays gossiped messages
+    constexpr std::uint64_t CAPABILITY_TOPICS = 1ULL << 4;         // Announces topic subscriptions
+    constexpr std::uint64_t CAPABILITY_COMPRESSION = 1ULL << 5;    // Accepts deflated runs of frames
+    constexpr std::uint64_t CAPABILITY_ENCRYPTION = 1ULL << 6;     // Sends a key share; later bytes go in records
+
+    // Capabilities this node announces.
+    constexpr std::uint64_t LOCAL_CAPABILITIES =
+        CAPABILITY_FILE_TRANSFER | CAPABILITY_SWARM | CAPABILITY_KEEPALIVE | CAPABILITY_GOSSIP |
+        CAPABILITY_TOPICS | CAPABILITY_COMPRESSION | CAPABILITY_ENCRYPTION;
+
+    // Identity exchanged once, as the first frame in each direction of a new connection.
+    struct Hello {
+        std::uint8_t version = PROTOCOL_VERSION;
+        std::string listeningAddress;
+        std::uint64_t capabilities = 0;
+
+        // X25519 public key, present when CAPABILITY_ENCRYPTION is announced.
+        std::string keyShare;
+
+        // Appends the binary encoding to out.
+        // Layout: version byte, varint-length listening address, varint capability bits,
+        // varint-length key share.
+        void encode(std::string& out) const;
+
+        // Decodes a handshake. Throws std::runtime_error if malformed.
+        // The version is returned as sent, so the caller can report a mismatch.
+        static Hello decode(std::string_view data);
+    };
+
+}  // namespace network
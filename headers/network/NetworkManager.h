@@ -1,11 +1,22 @@
 #pragma once
 
+#include "message/Message.h"
+#include "metrics/Registry.h"
+#include "network/FileTransfer.h"
+#include "network/Gossip.h"
+#include "network/Handshake.h"
 #include "network/Peer.h"
+#include "network/ReceivePipeline.h"
+#include "network/Subscriptions.h"
+#include "network/TimerWheel.h"
+#include <atomic>
 #include <boost/asio.hpp>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -15,30 +26,92 @@ namespace network {
     public:
         using tcp = boost::asio::ip::tcp;
 
+        // Map of peer IDs to their respective Peer objects.
+        using PeerMap = std::unordered_map<std::string, std::shared_ptr<Peer>>;
+
         // Returns the singleton instance of NetworkManager.
         static NetworkManager& instance();
 
         // Starts the server to listen for incoming connections on the specified port.
         void startServer(unsigned short port);
 
+        // Sets the number of threads serving network I/O. Must be called before startServer().
+        void setIoThreads(std::size_t count);
+
         // Connects to a peer at the given IP and port.
         void connectToPeer(const std::string& ip, unsigned short port);
 
         // Sends a message to a specific peer identified by peerID.
-        void sendMessage(const std::string& peerID, const std::string& message);
+        // Returns CONGESTED if the peer is falling behind, DROPPED if it is not connected or over its limit.
+        SendStatus sendMessage(const std::string& peerID, const std::string& message);
+
+        // Broadcasts a message to the connected peers subscribed to its topic.
+        // Peers that have not announced subscriptions receive every message.
+        // Returns the number of peers that are congested or dropped the message.
+        std::size_t broadcastMessage(const std::string& message);
+
+        // Gossips a message to the whole network: it is sent to a random subset of the connected
+        // peers, each of which relays it further until its TTL is spent.
+        // Returns the number of peers it was handed to.
+        std::size_t gossipMessage(const std::string& message);
+
+        // Sets how many peers each node relays a gossiped message to, and how many hops
+        // messages sent from this node may travel.
+        void setGossip(std::size_t fanout, std::uint8_t ttl);
+
+        // Subscribes this node to a topic pattern and announces the new set to every peer.
+        // Returns false if the pattern is invalid or already subscribed.
+        bool subscribeTopic(const std::string& pattern);
+
+        // Unsubscribes this node from a topic pattern and announces the new set to every peer.
+        // Returns false if the pattern was not subscribed.
+        bool unsubscribeTopic(const std::string& pattern);
+
+        // Returns the topic patterns this node is subscribed to.
+        std::vector<std::string> listSubscriptions() const;
+
+        // Sets how long a peer may stay silent before it is pinged, and before it is disconnected.
+        // Must be called before startServer().
+        void setKeepalive(std::chrono::seconds interval, std::chrono::seconds timeout);
+
+        // Sets whether traffic with peers that support it is encrypted (default: on).
+        // Must be called before startServer().
+        void setEncryption(bool enabled);
+
+        // Sets whether runs of messages to peers that accept it are sent compressed (default: on).
+        // Must be called before startServer().
+        void setCompression(bool enabled);
 
-        // Broadcasts a message to all connected peers.
-        void broadcastMessage(const std::string& message);
+        // Sets the outbound queue limits and overflow policy of each peer. Must be called before startServer().
+        void setSendLimits(const SendLimits& limits);
+
+        // Offers the file at path to a specific peer; it is sent once the peer accepts.
+        // Returns false if the peer is not connected. Throws std::runtime_error if the file cannot be opened.
+        bool sendFile(const std::string& peerID, const std::string& path);
+
+        // Returns descriptions of active and recently finished file transfers.
+        std::vector<std::string> listTransferInfo() const;
+
+        // Sets the maximum payload size accepted in a single frame from new peers.
+        // Must be called before peers connect to take effect for them.
+        void setMaxFrameSize(std::size_t maxFrameSize);
 
         // Retrieves the current listening address (IP:port) of the server.
         std::string getListeningAddress() const;
 
+        // Registers a callback for received messages, called on a receive worker thread
+        // after the message has been logged. Register before startServer().
+        void onMessageReceived(std::function<void(const message::Message&)> handler);
+
         // Registers a callback to handle peer disconnection events.
         void onPeerDisconnected(std::function<void(const std::string&)> handler);
 
         // Returns a list of connected peers' information.
         std::vector<std::string> listPeerInfo() const;
 
+        // Returns the connected peers, for callers that need their state as values rather than text.
+        std::vector<std::shared_ptr<const Peer>> listPeers() const;
+
         // Shuts down the network manager and closes all connections.
         void shutdown();
 
@@ -56,8 +129,52 @@ namespace network {
         // Accepts incoming connections asynchronously.
         void doAccept();
 
+        // Returns the currently registered peers without taking the lock.
+        std::vector<std::shared_ptr<Peer>> snapshotPeers() const;
+
+        // Returns the current peer table. The snapshot never changes and needs no lock.
+        std::shared_ptr<const PeerMap> loadPeers() const;
+
+        // Applies change to a copy of the peer table under the lock and publishes the copy
+        // if change returns true. Returns what change returned.
+        bool updatePeers(const std::function<bool(PeerMap&)>& change);
+
+        // Sends the handshake and sets up frame and disconnect handlers for a newly connected peer.
+        // Accepted peers are registered once their handshake names their listening address.
+        void attachPeer(const std::shared_ptr<Peer>& peer, bool accepted);
+
+        // Handles the first frame from a peer, which must be its handshake, and starts the
+        // session, encrypted with the key share sent to it if exchange is set and it sent one.
+        void handleHello(const std::shared_ptr<Peer>& peer, const FrameView& frame, bool accepted,
+                         const KeyExchange* exchange);
+
+        // Sends this node's subscriptions to a peer that announces its own.
+        void announceSubscriptions(const std::shared_ptr<Peer>& peer);
+
+        // Checks the peer for silence after delay. Safe to call from any thread.
+        void watchPeer(const std::shared_ptr<Peer>& peer, TimerWheel::Clock::duration delay);
+
+        // Pings a silent peer, disconnects one silent past the timeout, or checks again later.
+        // Runs on the keepalive strand.
+        void checkPeer(const std::weak_ptr<Peer>& weak);
+
+        // Advances the timer wheel once per tick. Runs on the keepalive strand.
+        void runKeepaliveTimer();
+
+        // Has the transfer manager recheck its downloads periodically. Runs on the keepalive strand.
+        void scheduleTransferCheck();
+
+        // Handles a batch of received frames on a receive worker thread.
+        void handleInbound(std::vector<InboundFrame>& batch);
+
+        // Decodes a gossiped message seen for the first time into received and relays it onwards.
+        void handleGossip(const InboundFrame& item, std::vector<message::Message>& received);
+
         // Removes a peer from the peers list upon disconnection.
-        void removePeer(const std::string& peerID);
+        void removePeer(const std::shared_ptr<Peer>& peer);
+
+        // Writes the peer count and every connected peer's counters, labelled by peer ID.
+        void collectPeerMetrics(metrics::TextWriter& out) const;
 
         // Boost.Asio I/O context for network operations.
         boost::asio::io_context ioContext_;
@@ -65,10 +182,12 @@ namespace network {
         // TCP acceptor for incoming connections.
         tcp::acceptor acceptor_;
 
-        // Map of peer IDs to their respective Peer objects.
-        std::unordered_map<std::string, std::shared_ptr<Peer>> peers_;
+        // Immutable snapshot of the peer table, replaced as a whole on every membership change.
+        // Read with std::atomic_load, so senders never wait for the lock.
+        std::shared_ptr<const PeerMap> peers_;
 
-        // Mutex to ensure thread-safe access to peers_.
+        // Mutex serializing changes to peers_ and guarding peerDisconnectHandler_, messageHandlers_
+        // and localTopics_.
         mutable std::mutex peersMutex_;
 
         // Stores the server's listening address (IP:port).
@@ -76,6 +195,54 @@ namespace network {
 
         // Callback function for peer disconnection events.
         std::function<void(const std::string&)> peerDisconnectHandler_;
+
+        // Callbacks for received messages.
+        std::vector<std::function<void(const message::Message&)>> messageHandlers_;
+
+        // Topic patterns this node is subscribed to; everything until changed.
+        std::vector<std::string> localTopics_{"#"};
+
+        // Topic patterns each peer is subscribed to.
+        SubscriptionIndex subscriptions_;
+
+        // Serializes the timer wheel; its single timer drives every peer's keepalive.
+        boost::asio::strand<boost::asio::io_context::executor_type> keepaliveStrand_;
+        boost::asio::steady_timer keepaliveTimer_;
+        TimerWheel wheel_;
+
+        // Silence after which a peer is pinged, and after which it is disconnected.
+        std::chrono::steady_clock::duration keepaliveInterval_ = std::chrono::seconds(15);
+        std::chrono::steady_clock::duration keepaliveTimeout_ = std::chrono::seconds(45);
+
+        // Outbound queue limits applied to every peer.
+        SendLimits sendLimits_;
+
+        // Whether messages to peers accepting compressed frames are compressed.
+        bool compression_ = true;
+
+        // Whether traffic is encrypted with peers that support it.
+        bool encryption_ = true;
+
+        // Maximum payload size accepted in a single incoming frame.
+        std::atomic<std::size_t> maxFrameSize_{DEFAULT_MAX_FRAME_SIZE};
+
+        // Received messages, direct or gossiped, and subscription announcements that failed to decode.
+        metrics::Counter& decodeFailures_;
+
+        // File transfers with connected peers.
+        FileTransferManager transfers_;
+
+        // Seen-set and fan-out of gossiped messages.
+        GossipRouter gossip_;
+
+        // Number of threads to run the I/O context on.
+        std::size_t ioThreadCount_;
+
+        // Threads running the I/O context.
+        std::vector<std::thread> ioThreads_;
+
+        // Worker threads handling received frames; declared last so it stops before the transfers go.
+        ReceivePipeline pipeline_;
     };
 
 }  // namespace network
\ No newline at end of file
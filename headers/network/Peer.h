@@ -1,23 +1,95 @@
 #pragma once
 
-#include <array>
+#include "metrics/Metrics.h"
+#include "network/Compression.h"
+#include "network/FileHandle.h"
+#include "network/Frame.h"
+#include "network/RecordLayer.h"
+#include <atomic>
 #include <boost/asio.hpp>
 #include <chrono>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace network {
 
-    class Peer {
+    // What happens to a message frame that would take a peer's outbound queue past its limit.
+    enum class OverflowPolicy {
+        DROP_OLDEST,  // Discard the oldest queued message frames to make room
+        DROP_NEWEST,  // Refuse the new frame
+        DISCONNECT    // Close the connection
+    };
+
+    // Outbound queue limits of a peer, in bytes of queued and in-flight frames.
+    // Only message frames are ever dropped; control and file frames are always queued,
+    // as their volume is already bounded by the file transfer windows.
+    struct SendLimits {
+        std::size_t lowWatermark = 4 * 1024 * 1024;      // Congestion clears at or below this
+        std::size_t highWatermark = 16 * 1024 * 1024;    // Congestion starts at or above this
+        std::size_t maxQueuedBytes = 64 * 1024 * 1024;   // The overflow policy applies beyond this
+        OverflowPolicy policy = OverflowPolicy::DISCONNECT;
+    };
+
+    // Outcome of queuing a frame on a peer.
+    enum class SendStatus {
+        QUEUED,     // Queued; the peer is keeping up
+        CONGESTED,  // Queued, but the peer's queue is over its high watermark; callers should slow down
+        DROPPED     // Not sent: the peer is disconnected or its queue is at its limit
+    };
+
+    // Traffic counters of a peer since it connected, for metrics export.
+    struct PeerCounters {
+        std::uint64_t bytesReceived = 0;     // Bytes read from the socket, framing and records included
+        std::uint64_t bytesSent = 0;         // Bytes written to the socket
+        std::uint64_t messagesReceived = 0;  // Direct and gossiped message frames received
+        std::uint64_t messagesSent = 0;      // Direct and gossiped message frames written
+        std::uint64_t messagesDropped = 0;   // Message frames discarded by the overflow policy
+        std::uint64_t compressedIn = 0;      // Bytes of frames sent compressed
+        std::uint64_t compressedOut = 0;     // Bytes those frames were sent as
+        std::uint64_t queuedBytes = 0;       // Bytes queued or being written
+        std::uint64_t queuedFrames = 0;      // Frames queued or being written
+    };
+
+    // All socket handlers of a peer run on the socket's executor, which is a strand
+    // when the io_context is served by several threads, so they never run concurrently.
+    // Public methods may be called from any thread.
+    class Peer : public std::enable_shared_from_this<Peer> {
     public:
         using tcp = boost::asio::ip::tcp;
 
         // Constructs a Peer with a socket and listening address as its ID.
         Peer(std::shared_ptr<tcp::socket> socket, const std::string& listeningAddress);
 
-        // Sends a message to this peer.
-        void sendMessage(const std::string& message);
+        // Queues a message for this peer. Safe to call from any thread.
+        // Messages are written in order, with at most one write in flight.
+        SendStatus sendMessage(const std::string& message);
+
+        // Queues an already encoded frame without copying it. Safe to call from any thread.
+        // Frames that reach the socket's executor before the handshake are dropped.
+        SendStatus sendFrame(SharedFrame frame);
+
+        // Queues the handshake frame, which must be the first frame sent. With awaitSession,
+        // frames queued after it are held back until startSession(). Safe to call from any thread.
+        SendStatus sendHello(SharedFrame frame, bool awaitSession);
+
+        // Queues a frame whose payload ends with length bytes of a file starting at offset.
+        // header holds the frame header and the leading part of the payload; the file bytes
+        // are sent with sendfile() straight from the page cache. Safe to call from any thread.
+        SendStatus sendFileSegment(SharedFrame header, std::shared_ptr<FileHandle> file,
+                                   std::uint64_t offset, std::size_t length);
+
+        // Sets the outbound queue limits. Must be called before the first send.
+        void setSendLimits(const SendLimits& limits);
+
+        // Returns the number of bytes queued or being written.
+        std::size_t queuedBytes() const;
+
+        // Returns true while the outbound queue is over its high watermark and not yet back to the low one.
+        bool isCongested() const;
 
         // Starts asynchronous message receiving.
         void startReceiving();
@@ -26,7 +98,7 @@ namespace network {
         std::string getAddress() const;
 
         // Returns the peer's unique identifier.
-        const std::string& getPeerID() const;
+        std::string getPeerID() const;
 
         // Sets the peer's unique identifier.
         void setPeerID(const std::string& id);
@@ -34,36 +106,242 @@ namespace network {
         // Checks if the peer is currently connected.
         bool isConnected() const;
 
+        // Records the capabilities from the peer's handshake and marks the handshake complete.
+        void completeHandshake(std::uint64_t capabilities);
+
+        // Returns true once the peer's handshake has been received.
+        bool handshakeComplete() const;
+
+        // Returns the capability bits the peer announced, or 0 before its handshake.
+        std::uint64_t capabilities() const;
+
+        // Starts compressing runs of message frames sent to this peer, which must accept
+        // COMPRESSED frames. Safe to call from any thread; applies from the next write.
+        void enableCompression();
+
+        // Starts the session after the peer's handshake. With keys, every later byte in both
+        // directions travels in encrypted records; without, in the clear. Releases the frames
+        // held back by sendHello(). Must run on the socket's executor, either in the message
+        // callback for the handshake frame or before receiving starts.
+        void startSession(SessionKeys keys);
+
+        // Returns true once traffic with the peer is encrypted.
+        bool isEncrypted() const;
+
+        // Returns the peer's traffic counters. Safe to call from any thread.
+        PeerCounters counters() const;
+
+        // Returns how long gather writes and file segments took to complete, from being issued
+        // to the socket accepting their last byte. Safe to call from any thread.
+        const metrics::Histogram& writeLatency() const;
+
+        // Closes the connection and triggers the disconnect handler. Safe to call from any thread;
+        // when called from one of the peer's handlers, no further frames are dispatched.
+        void close();
+
         // Returns the last time the peer was active.
         std::chrono::steady_clock::time_point lastActive() const;
 
-        // Registers a callback for handling incoming messages.
-        void onMessage(std::function<void(const std::string&)>&& handler);
+        // Registers a callback for handling incoming frames.
+        // The frame payload references the receive buffer and is only valid during the call.
+        // The callback returns false if it cannot take the frame yet; receiving then pauses
+        // until resumeReceiving(), which offers the same frame again.
+        void onMessage(std::function<bool(const FrameView&)>&& handler);
+
+        // Resumes receiving after the message callback refused a frame. Safe to call from any thread.
+        void resumeReceiving();
 
         // Registers a callback for handling disconnection events.
         void onDisconnect(std::function<void()>&& handler);
 
+        // Sets the maximum payload size accepted in a single incoming frame.
+        void setMaxFrameSize(std::size_t maxFrameSize);
+
         // Returns a string representation of the peer for UI display.
         std::string toString() const;
 
     private:
-        // Handles received messages and updates state based on error and bytes transferred.
+        // Issues the next asynchronous read into the frame buffer.
+        void readMore();
+
+        // Handles received bytes, dispatching every complete frame they finish.
         void handleReceive(const boost::system::error_code& error, std::size_t bytes_transferred);
 
+        // Offers buffered frames to the message callback until it refuses one or more bytes
+        // are needed, then reads more unless paused. Runs on the socket's executor.
+        void dispatchFrames();
+
+        // Extracts the next frame from the frame buffer, first opening received records into it
+        // when encrypted. Throws std::runtime_error if a record fails authentication.
+        bool nextPlainFrame(FrameView& frame);
+
+        // Extracts the next frame of the inflated batch, returning false once it is used up.
+        // Throws std::runtime_error if the batch holds a partial or nested compressed frame.
+        bool nextInflatedFrame(FrameView& frame);
+
+        // Appends the buffers for the in-flight entries, deflating runs of message frames
+        // together when compression is on. Runs on the socket's executor.
+        void gatherBuffers(std::vector<boost::asio::const_buffer>& buffers);
+
+        // Closes the socket and triggers the disconnect handler once.
+        // Runs on the socket's executor.
+        void closeWithError();
+
+        // Entry in the write queue: encoded bytes, or a range of a file sent with sendfile().
+        // bytes is what the entry adds to queuedBytes_; droppable marks direct and gossiped message
+        // frames, which are also the ones worth compressing.
+        struct Outbound {
+            SharedFrame frame;
+            std::shared_ptr<FileHandle> file;
+            std::uint64_t offset = 0;
+            std::size_t length = 0;
+            std::size_t bytes = 0;
+            bool droppable = false;
+        };
+
+        // Accounts for an entry about to be queued and applies the overflow policy.
+        // Returns DROPPED if the entry must not be queued. Safe to call from any thread.
+        SendStatus reserve(const Outbound& item);
+
+        // Removes an entry's bytes from the queue accounting, clearing congestion at the low watermark.
+        void release(const Outbound& item);
+
+        // Discards the oldest queued message frames until the queue is within its limit.
+        // Runs on the socket's executor.
+        void dropOldest();
+
+        // Appends an entry to the write queue and starts a write if none is in flight.
+        // Runs on the socket's executor.
+        void enqueue(Outbound item);
+
+        // Writes queued frames in a single gather write, or the file segment at the front.
+        void startWrite();
+
+        // Encrypts the gathered bytes into records in the send buffer and replaces the buffers
+        // with the sealed records. Runs on the socket's executor.
+        void sealBuffers(std::vector<boost::asio::const_buffer>& buffers);
+
+        // Reads the current file segment into records in the send buffer, encrypts them in
+        // place and writes them. Runs on the socket's executor.
+        void sealSegment();
+
+        // Sends as much of the current file segment as the socket accepts, then waits for writability.
+        void writeSegment();
+
+        // Handles completion of a write and starts the next one.
+        void handleWrite(const boost::system::error_code& error);
+
         // Socket for communication with this peer.
         std::shared_ptr<tcp::socket> socket_;
 
-        // Buffer for receiving messages.
-        std::array<char, 1024> buffer_;
+        // Reassembles incoming bytes, or opened records when encrypted, into length-prefixed frames.
+        FrameBuffer buffer_;
+
+        // Reassembles incoming records once encrypted; holds the bytes that followed the handshake.
+        FrameBuffer records_;
+
+        // Record ciphers for each direction, set by startSession(); used on the socket's executor.
+        std::unique_ptr<RecordCipher> sealer_;
+        std::unique_ptr<RecordCipher> opener_;
+
+        // Sealed records being written; reused so steady traffic allocates nothing.
+        std::vector<char> sendBuffer_;
+
+        // Set once the handshake is queued, or a session started without one; until then
+        // every other frame is refused. Used on the socket's executor.
+        bool helloQueued_ = false;
+
+        // Set while frames after the handshake wait for startSession().
+        bool awaitingSession_ = false;
+
+        // Set once records are in use, for toString().
+        std::atomic<bool> encrypted_{false};
+
+        // Remote endpoint (IP:port), captured at construction.
+        std::string remoteAddress_;
 
         // Unique identifier for the peer (IP:port).
         std::string peerID_;
 
-        // Timestamp of the last activity from this peer.
-        std::chrono::steady_clock::time_point lastActiveTime_;
+        // Mutex guarding peerID_, which is renamed while other threads read it.
+        mutable std::mutex idMutex_;
+
+        // Cleared once the connection has failed or been closed.
+        std::atomic<bool> connected_{true};
+
+        // Set once the peer's handshake has been received.
+        std::atomic<bool> handshakeComplete_{false};
+
+        // Capability bits announced in the peer's handshake.
+        std::atomic<std::uint64_t> capabilities_{0};
+
+        // Timestamp of the last activity from this peer, as steady_clock ticks.
+        std::atomic<std::chrono::steady_clock::rep> lastActiveTime_;
+
+        // Entries waiting for the current write to finish.
+        std::deque<Outbound> writeQueue_;
+
+        // Frames referenced by the gather write in flight, with their accounting.
+        std::vector<Outbound> inFlight_;
+
+        // Compressed frames written in place of runs of in-flight frames.
+        std::vector<SharedFrame> packed_;
+
+        // Set once the peer accepts compressed frames.
+        std::atomic<bool> compress_{false};
+
+        // Compression streams for both directions; used on the socket's executor only.
+        FrameCompressor compressor_;
+
+        // Bytes of frames sent compressed, and the bytes they were sent as.
+        std::atomic<std::uint64_t> compressedIn_{0};
+        std::atomic<std::uint64_t> compressedOut_{0};
+
+        // Frames of the last compressed batch received, and the offset of the next one.
+        std::string inflated_;
+        std::size_t inflatedPos_ = 0;
+
+        // Maximum accepted payload size, also bounding inflated batches.
+        std::size_t maxFrameSize_ = DEFAULT_MAX_FRAME_SIZE;
+
+        // File segment being sent; its offset and length advance as bytes go out.
+        Outbound segment_;
+
+        // True while a gather write or a file segment is in flight.
+        bool writing_ = false;
+
+        // When the write in flight was issued.
+        std::chrono::steady_clock::time_point writeStarted_;
+
+        // Durations of completed writes.
+        metrics::Histogram writeLatency_;
+
+        // Traffic in both directions; updated on the socket's executor, read by any thread.
+        std::atomic<std::uint64_t> bytesReceived_{0};
+        std::atomic<std::uint64_t> bytesSent_{0};
+        std::atomic<std::uint64_t> messagesReceived_{0};
+        std::atomic<std::uint64_t> messagesSent_{0};
+
+        // Outbound queue limits.
+        SendLimits limits_;
+
+        // Bytes and frames queued or being written; updated by senders and the write handlers.
+        std::atomic<std::size_t> queuedBytes_{0};
+        std::atomic<std::size_t> queuedFrames_{0};
+
+        // Message frames discarded by the overflow policy.
+        std::atomic<std::size_t> droppedFrames_{0};
+
+        // Set at the high watermark and cleared at the low one.
+        std::atomic<bool> congested_{false};
+
+        // True while the message callback has refused stalled_; no reads are issued meanwhile,
+        // so the frame's bytes stay in place in the receive buffer.
+        bool paused_ = false;
+        FrameView stalled_{};
 
-        // Callback for processing incoming messages.
-        std::function<void(const std::string&)> messageHandler_;
+        // Callback for processing incoming frames.
+        std::function<bool(const FrameView&)> messageHandler_;
 
         // Callback for handling disconnection events.
         std::function<void()> disconnectHandler_;
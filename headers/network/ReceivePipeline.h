@@ -0,0 +1,102 @@
+#pragma once
+
+#include "network/BoundedQueue.h"
+#include "network/Frame.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace network {
+
+    class Peer;
+
+    // A received frame copied out of the peer's receive buffer.
+    struct InboundFrame {
+        std::shared_ptr<Peer> peer;
+        FrameType type = FrameType::MESSAGE;
+        std::string payload;
+    };
+
+    // Moves handling of received frames off the I/O threads.
+    //
+    // I/O threads only copy each complete frame into a bounded lock-free queue; worker threads
+    // drain the queues in batches and hand each batch to the handler, which may decode, write
+    // to disk or print without holding up any socket. Every peer is pinned to one worker, so its
+    // frames are handled in the order they arrived. When a worker's queue is full, submit()
+    // refuses the frame and the peer is resumed once that worker has made room.
+    class ReceivePipeline {
+    public:
+        // Called on a worker thread with a batch of frames; may consume them.
+        using BatchHandler = std::function<void(std::vector<InboundFrame>&)>;
+
+        // Constructs a stopped pipeline whose workers each queue up to capacity frames.
+        explicit ReceivePipeline(std::size_t capacity = 4096);
+
+        // Stops the workers.
+        ~ReceivePipeline();
+
+        // Deleted copy constructor and assignment operator to prevent copying.
+        ReceivePipeline(const ReceivePipeline&) = delete;
+        ReceivePipeline& operator=(const ReceivePipeline&) = delete;
+
+        // Starts count worker threads calling handler. Must be called before the first submit().
+        void start(std::size_t count, BatchHandler handler);
+
+        // Copies a frame into the peer's worker queue. Never blocks. Returns false if the queue
+        // is full; the peer's resumeReceiving() is then called once there is room again.
+        bool submit(const std::shared_ptr<Peer>& peer, const FrameView& frame);
+
+        // Handles every frame still queued and stops the workers.
+        void stop();
+
+    private:
+        // A worker thread and the queue it drains.
+        struct Worker {
+            explicit Worker(std::size_t capacity) : queue(capacity) {}
+
+            BoundedQueue<InboundFrame> queue;
+
+            // Mutex and condition used only to park and wake the idle worker.
+            std::mutex wakeMutex;
+            std::condition_variable wakeCondition;
+
+            // Set while the worker is (about to be) parked.
+            std::atomic<bool> sleeping{false};
+
+            // Peers refused while the queue was full, resumed after the next batch.
+            std::mutex stalledMutex;
+            std::vector<std::weak_ptr<Peer>> stalled;
+            std::atomic<bool> hasStalled{false};
+
+            std::thread thread;
+        };
+
+        // Worker thread body.
+        void run(Worker& worker);
+
+        // Resumes the peers refused by a worker's full queue.
+        void resumeStalled(Worker& worker);
+
+        // Returns the worker a peer is pinned to.
+        Worker& workerFor(const Peer* peer);
+
+        // Frames each worker queues before refusing more.
+        std::size_t capacity_;
+
+        // Workers, fixed once started.
+        std::vector<std::unique_ptr<Worker>> workers_;
+
+        // Handler for batches of frames.
+        BatchHandler handler_;
+
+        // Cleared to make the workers finish.
+        std::atomic<bool> running_{false};
+    };
+
+}  // namespace network
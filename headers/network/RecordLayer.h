@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+struct evp_cipher_ctx_st;
+struct evp_pkey_st;
+
+namespace network {
+
+    // Plaintext carried by one record at most; large enough that the 21 bytes of header and
+    // tag per record, and the per-record cipher setup, vanish next to the data, and small enough
+    // that the receiver can start opening a batch while the rest of it is still arriving.
+    constexpr std::size_t MAX_RECORD_PLAINTEXT = 64 * 1024;
+
+    // Authentication tag appended to every record.
+    constexpr std::size_t RECORD_TAG_SIZE = 16;
+
+    // Size of the X25519 key share sent in the handshake.
+    constexpr std::size_t KEY_SHARE_SIZE = 32;
+
+    // AES-256-GCM for one direction of a connection.
+    //
+    // A record is a RECORD frame whose payload is the ciphertext followed by the tag; the frame
+    // header is authenticated as associated data. The key is expanded once per connection and
+    // each record only sets a new nonce: the 4-byte salt from the key derivation followed by a
+    // 64-bit record counter, so nonces never repeat and records cannot be replayed, dropped or
+    // reordered without failing authentication. AES-GCM runs on the AES and carry-less multiply
+    // instructions where the CPU has them.
+    // Not thread-safe; each direction is used on the peer's executor only.
+    class RecordCipher {
+    public:
+        // Constructs a cipher for sealing (encrypt true) or opening records with a 32-byte key
+        // and 4-byte nonce salt. Throws std::runtime_error if the cipher cannot be set up.
+        RecordCipher(bool encrypt, std::string_view key, std::string_view salt);
+
+        // Frees the cipher context.
+        ~RecordCipher();
+
+        // Deleted copy constructor and assignment operator to prevent copying.
+        RecordCipher(const RecordCipher&) = delete;
+        RecordCipher& operator=(const RecordCipher&) = delete;
+
+        // Encrypts length bytes at data in place and writes the tag to tag.
+        // header is the record's frame header. Throws std::runtime_error on failure.
+        void seal(const char* header, char* data, std::size_t length, char* tag);
+
+        // Seals a record from several pieces: beginSeal() with its header, sealUpdate() for each
+        // piece, encrypting length bytes from in to out (which may be the same), and finishSeal()
+        // to write the tag. Throw std::runtime_error on failure.
+        void beginSeal(const char* header);
+        void sealUpdate(const char* in, char* out, std::size_t length);
+        void finishSeal(char* tag);
+
+        // Decrypts a record payload (ciphertext and tag) into out, which must have room for
+        // the ciphertext. Returns false if the record fails authentication; out is then garbage.
+        bool open(const char* header, std::string_view payload, char* out);
+
+    private:
+        // Sets the nonce for the next record and advances the counter.
+        void nextNonce(unsigned char* nonce);
+
+        // Cipher context holding the expanded key.
+        evp_cipher_ctx_st* context_;
+
+        // Nonce salt and the number of records processed so far.
+        std::string salt_;
+        std::uint64_t counter_ = 0;
+
+        // Direction of the cipher.
+        bool encrypt_;
+    };
+
+    // Ciphers for both directions of a connection.
+    struct SessionKeys {
+        std::unique_ptr<RecordCipher> sealer;
+        std::unique_ptr<RecordCipher> opener;
+    };
+
+    // Ephemeral X25519 key pair for one connection.
+    //
+    // Each side sends its public key in the handshake; both derive the same shared secret and
+    // expand it with HKDF-SHA256 into a key and nonce salt per direction. The key share is not
+    // signed, so this keeps traffic from passive observers and detects tampering, but does not
+    // prove who is on the other end.
+    class KeyExchange {
+    public:
+        // Generates a fresh key pair. Throws std::runtime_error on failure.
+        KeyExchange();
+
+        // Frees the key pair.
+        ~KeyExchange();
+
+        // Deleted copy constructor and assignment operator to prevent copying.
+        KeyExchange(const KeyExchange&) = delete;
+        KeyExchange& operator=(const KeyExchange&) = delete;
+
+        // Returns the public key to send to the peer.
+        const std::string& publicKey() const;
+
+        // Derives the session ciphers from the peer's public key. Throws std::runtime_error if
+        // the key is malformed or equal to ours, as a connection to itself would reuse nonces.
+        SessionKeys derive(std::string_view peerPublicKey) const;
+
+    private:
+        // Private and public key.
+        evp_pkey_st* key_;
+        std::string publicKey_;
+    };
+
+}  // namespace network
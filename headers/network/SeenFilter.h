@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace network {
+
+    // Random 16-byte identifier of a gossiped message.
+    using MessageId = std::array<std::uint8_t, 16>;
+
+    // Compact, time-windowed set of recently seen message IDs.
+    //
+    // Two Bloom filters are kept: new IDs go into the current one, lookups check both, and once
+    // the current one has been filled for a whole window, or holds its capacity, the older one is
+    // cleared and the two swap roles. An ID is therefore remembered for between one and two
+    // windows, in fixed memory. Lookups may report an ID as seen that never was, at a rate set by
+    // the filter size; they never miss one inserted within the last window.
+    // Not thread-safe; callers serialize access.
+    class SeenFilter {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // Constructs filters of 2^bitsLog2 bits, rotated after window or capacity insertions.
+        SeenFilter(unsigned bitsLog2, std::size_t capacity, Clock::duration window);
+
+        // Inserts an ID. Returns false if it was (probably) already present.
+        bool insert(const MessageId& id, Clock::time_point now);
+
+        // Returns true if the ID is (probably) present.
+        bool contains(const MessageId& id) const;
+
+    private:
+        // Number of bit positions set per ID.
+        static constexpr unsigned HASHES = 7;
+
+        // Returns the bit positions of an ID, derived from its random bytes.
+        std::array<std::uint64_t, HASHES> positions(const MessageId& id) const;
+
+        // Returns true if every position is set in the filter.
+        static bool test(const std::vector<std::uint64_t>& filter, const std::array<std::uint64_t, HASHES>& bits);
+
+        // Clears the older filter and makes it current once the current one is full or old.
+        void rotateIfDue(Clock::time_point now);
+
+        // Current and previous filters, as bit arrays.
+        std::vector<std::uint64_t> current_;
+        std::vector<std::uint64_t> previous_;
+
+        // Number of bits per filter, minus one.
+        std::uint64_t mask_;
+
+        // IDs inserted into the current filter, and the limit before rotating.
+        std::size_t count_ = 0;
+        std::size_t capacity_;
+
+        // When the current filter was started, and how long it stays current.
+        Clock::time_point started_;
+        Clock::duration window_;
+    };
+
+}  // namespace network
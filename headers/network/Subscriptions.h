@@ -0,0 +1,108 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace network {
+
+    class Peer;
+
+    // Topics are split into segments at '/'. In a subscription pattern a '*' segment matches
+    // any one segment and a final '#' segment matches any number of remaining segments, none
+    // included: "news/#" matches "news" and "news/local/weather", "#" matches every topic.
+    constexpr char TOPIC_SEPARATOR = '/';
+
+    // Returns true if pattern is a valid subscription pattern ('#' only as the last segment).
+    bool isValidTopicPattern(std::string_view pattern);
+
+    // Returns true if topic matches pattern.
+    bool topicMatches(std::string_view pattern, std::string_view topic);
+
+    // A node's complete set of subscription patterns, announced to every peer when it connects
+    // and again whenever it changes. Each announcement replaces the previous one.
+    struct Subscribe {
+        std::vector<std::string> patterns;
+
+        // Appends the binary encoding to out.
+        // Layout: varint pattern count, then each pattern as varint length and bytes.
+        void encode(std::string& out) const;
+
+        // Decodes an announcement. Throws std::runtime_error if malformed.
+        // Invalid patterns are kept; the index ignores them.
+        static Subscribe decode(std::string_view data);
+    };
+
+    // Index of the topics each peer has subscribed to, as a trie over topic segments.
+    //
+    // The trie is rebuilt and published as an immutable snapshot whenever a peer announces or
+    // leaves, which is rare next to the number of broadcasts; a lookup walks one path per
+    // matching pattern shape without taking a lock. Peers are identified by address only and
+    // must be removed before they are destroyed.
+    // Thread-safe.
+    class SubscriptionIndex {
+    private:
+        struct Table;
+
+    public:
+        // Peers interested in one topic.
+        class Match {
+        public:
+            // Returns true if the peer subscribed to the topic, or never announced its
+            // subscriptions and so still receives everything.
+            bool wants(const Peer* peer) const;
+
+        private:
+            friend class SubscriptionIndex;
+
+            std::shared_ptr<const Table> table_;
+            std::unordered_set<const Peer*> peers_;
+        };
+
+        // Constructs an empty index.
+        SubscriptionIndex();
+
+        // Replaces the patterns of a peer. Invalid patterns are ignored.
+        void set(const Peer* peer, const std::vector<std::string>& patterns);
+
+        // Forgets a peer.
+        void remove(const Peer* peer);
+
+        // Looks up the peers interested in a topic.
+        Match match(std::string_view topic) const;
+
+    private:
+        // Trie level: children by literal segment, the '*' child, and the peers whose
+        // pattern ends here exactly or with '#'.
+        struct Node {
+            std::unordered_map<std::string, std::unique_ptr<Node>> children;
+            std::unique_ptr<Node> anySegment;
+            std::unordered_set<const Peer*> exact;
+            std::unordered_set<const Peer*> rest;
+        };
+
+        // Immutable snapshot: every peer's patterns and the trie built from them.
+        struct Table {
+            std::unordered_map<const Peer*, std::vector<std::string>> patterns;
+            Node root;
+        };
+
+        // Builds the trie for a table's patterns.
+        static void build(Table& table);
+
+        // Adds the peers under node matching segments from index i onwards to out.
+        static void collect(const Node& node, const std::vector<std::string_view>& segments, std::size_t i,
+                            std::unordered_set<const Peer*>& out);
+
+        // Current snapshot, read with std::atomic_load.
+        std::shared_ptr<const Table> table_;
+
+        // Serializes rebuilds.
+        std::mutex mutex_;
+    };
+
+}  // namespace network
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace network {
+
+    // Hierarchical timing wheel for large numbers of coarse timers.
+    //
+    // Level 0 has one slot per tick; each higher level has slots covering a whole turn of the
+    // level below. A timer is filed in the lowest level whose span reaches its deadline and is
+    // moved down a level each time the level below wraps around to its slot, so scheduling is
+    // O(1) and each tick only touches the slots that are due. Timers cannot be cancelled;
+    // callbacks check whether they still apply.
+    // Not thread-safe; callers serialize access.
+    class TimerWheel {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // Constructs an empty wheel advancing in steps of tick, starting at now.
+        TimerWheel(Clock::duration tick, Clock::time_point now);
+
+        // Runs callback once delay has passed, rounded up to whole ticks.
+        // Delays beyond the wheel's range are clamped to it.
+        void schedule(Clock::duration delay, std::function<void()> callback);
+
+        // Advances the wheel to now, running every callback that has come due.
+        // Callbacks may schedule further timers.
+        void advance(Clock::time_point now);
+
+        // Returns the number of pending timers.
+        std::size_t size() const;
+
+        // Returns the tick length.
+        Clock::duration tick() const;
+
+    private:
+        // Slots per level and the number of levels; 64^4 ticks are covered.
+        static constexpr unsigned SLOT_BITS = 6;
+        static constexpr std::size_t SLOTS = std::size_t{1} << SLOT_BITS;
+        static constexpr std::size_t LEVELS = 4;
+
+        // A pending timer.
+        struct Timer {
+            std::uint64_t deadline;
+            std::function<void()> callback;
+        };
+
+        // Files a timer in the slot its deadline falls into, relative to the current tick.
+        void insert(Timer timer);
+
+        // Moves to the next tick: cascades wrapped levels down, then runs level 0's due slot.
+        void step();
+
+        // Length of one tick.
+        Clock::duration tick_;
+
+        // Time of tick zero.
+        Clock::time_point start_;
+
+        // Ticks processed so far.
+        std::uint64_t current_ = 0;
+
+        // Number of pending timers.
+        std::size_t size_ = 0;
+
+        // Timers by level and slot.
+        std::array<std::array<std::vector<Timer>, SLOTS>, LEVELS> slots_;
+    };
+
+}  // namespace network
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "message/Manifest.h"
+#include "storage/Hash.h"
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace storage {
+
+    // Place on disk holding the bytes of a chunk.
+    struct ChunkLocation {
+        std::string path;
+        std::uint64_t offset = 0;
+        std::uint32_t length = 0;
+
+        bool operator==(const ChunkLocation& other) const {
+            return path == other.path && offset == other.offset && length == other.length;
+        }
+    };
+
+    // Content-addressed index of every chunk this node holds.
+    //
+    // Chunks are not copied into the store; the index maps each chunk digest to the
+    // files and offsets where that content lives (shared files, completed downloads and
+    // partial downloads). The index is persisted as an append-only text file,
+    // one "<hex digest> <offset> <length> <path>" line per location, and rewritten when
+    // locations are dropped or moved. Locations are verified by re-hashing before local
+    // reuse; stale ones (file changed or removed) are dropped when found.
+    // Thread-safe.
+    class ChunkStore {
+    public:
+        // Constructs a store whose index lives in directory and loads it.
+        explicit ChunkStore(const std::string& directory = "chunks");
+
+        // Deleted copy constructor and assignment operator to prevent copying.
+        ChunkStore(const ChunkStore&) = delete;
+        ChunkStore& operator=(const ChunkStore&) = delete;
+
+        // Hashes the file at path in chunks of chunkSize, indexes every chunk and returns its manifest.
+        // Throws std::runtime_error if the file cannot be read.
+        message::Manifest addFile(const std::string& path, std::uint32_t chunkSize);
+
+        // Records that the chunk with the given digest is stored at location.
+        void add(const Digest& digest, const ChunkLocation& location);
+
+        // Returns a location of the chunk, if any is known. The location is not verified.
+        std::optional<ChunkLocation> find(const Digest& digest) const;
+
+        // Returns true if location is a known location of the chunk.
+        bool contains(const Digest& digest, const ChunkLocation& location) const;
+
+        // Re-hashes the chunk at location. Drops the location and returns false on mismatch.
+        bool verify(const Digest& digest, const ChunkLocation& location);
+
+        // Reads the chunk from any known location into out, verifying its digest.
+        // Stale locations are dropped. Returns false if no location holds the chunk.
+        bool read(const Digest& digest, std::string& out);
+
+        // Moves every location in file from to file to, after a rename.
+        void relocate(const std::string& from, const std::string& to);
+
+        // Returns the number of distinct chunks indexed.
+        std::size_t size() const;
+
+    private:
+        // Reads the persisted index.
+        void load();
+
+        // Rewrites the persisted index from memory. Called with mutex_ held.
+        void rewrite();
+
+        // Appends one entry to the persisted index. Called with mutex_ held.
+        void appendEntry(const Digest& digest, const ChunkLocation& location);
+
+        // Drops a location. Called with mutex_ held.
+        void dropLocked(const Digest& digest, const ChunkLocation& location);
+
+        // Reads location into out and checks it hashes to digest.
+        static bool readVerified(const Digest& digest, const ChunkLocation& location, std::string& out);
+
+        // Path of the persisted index.
+        std::string indexPath_;
+
+        // Persisted index, open for appending.
+        std::ofstream indexFile_;
+
+        // Known locations of every chunk.
+        std::unordered_map<Digest, std::vector<ChunkLocation>, DigestHash> chunks_;
+
+        // Mutex guarding chunks_ and indexFile_.
+        mutable std::mutex mutex_;
+    };
+
+}  // namespace storage
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace storage {
+
+    // SHA-256 digest identifying a chunk or a manifest.
+    using Digest = std::array<std::uint8_t, 32>;
+
+    // Returns the SHA-256 digest of data.
+    Digest sha256(std::string_view data);
+
+    // Returns the lowercase hexadecimal form of a digest.
+    std::string toHex(const Digest& digest);
+
+    // Parses a digest from its hexadecimal form. Returns false if malformed.
+    bool fromHex(std::string_view hex, Digest& digest);
+
+    // Hash functor for using digests as unordered container keys.
+    // The digest is already uniformly distributed, so its leading bytes are used directly.
+    struct DigestHash {
+        std::size_t operator()(const Digest& digest) const {
+            std::size_t value;
+            std::memcpy(&value, digest.data(), sizeof(value));
+            return value;
+        }
+    };
+
+}  // namespace storage
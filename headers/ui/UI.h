@@ -35,14 +35,38 @@ namespace ui {
         // Handles the menu for broadcasting a message to all peers.
         void broadcastMessageMenu();
 
+        // Handles the menu for gossiping a message to the whole network.
+        void gossipMessageMenu();
+
+        // Handles the menu for offering a file to a specific peer.
+        void sendFileMenu();
+
+        // Displays active and recently finished file transfers.
+        void transfersMenu();
+
+        // Displays the subscribed topic patterns with options to add or remove one.
+        void subscriptionsMenu();
+
         // Displays the inbox with options to view sent or received messages.
         void inboxMenu();
 
-        // Displays the list of sent messages.
-        void viewSent();
+        // Displays per-peer traffic and node-wide counters, with an option to export them.
+        void statsMenu();
+
+        // Pages through sent or received messages, which can be filtered, opened and deleted.
+        void viewMessages(bool sent);
+
+        // Asks for the peer, topic and age to filter a message list by.
+        void filterMenu(logging::MessageQuery& query);
+
+        // Asks for words to search the messages for and lists the best matches.
+        void searchMenu();
+
+        // Displays a message and offers to delete it.
+        void openMessage(const logging::MessageHandle& handle);
 
-        // Displays the list of received messages.
-        void viewReceived();
+        // Exports the message logs in the text format.
+        void exportMenu();
 
         // Handles the menu for connecting to a peer.
         void connectPeerMenu();
@@ -0,0 +1,674 @@
+#include "control/ControlServer.h"
+#include "metrics/Registry.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <deque>
+#include <optional>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace control {
+
+    using stream_protocol = boost::asio::local::stream_protocol;
+
+    namespace {
+
+        // Longest request line accepted; a client sending more is answered with an error and closed.
+        constexpr std::size_t MAX_REQUEST_SIZE = 4 * 1024 * 1024;
+
+        // Output a client may leave unread. Past it, reading its requests pauses until it catches
+        // up, and a watcher is disconnected rather than have events pile up.
+        constexpr std::size_t MAX_PENDING_OUTPUT = 16 * 1024 * 1024;
+
+        // Messages returned by one inbox request unless the request asks for fewer.
+        constexpr std::int64_t DEFAULT_INBOX_LIMIT = 100;
+        constexpr std::int64_t MAX_INBOX_LIMIT = 10000;
+
+        // Matches returned by one search request unless the request asks for another number.
+        constexpr std::int64_t DEFAULT_SEARCH_LIMIT = 20;
+
+        // Returns the string parameter name of a request.
+        const std::string& stringParam(const Json& request, const char* name) {
+            const Json* value = request.find(name);
+            if (!value || !value->isString()) {
+                throw std::runtime_error(std::string("Missing string parameter '") + name + "'");
+            }
+            return value->asString();
+        }
+
+        // Returns the integer parameter name of a request, or fallback if it is absent.
+        std::int64_t integerParam(const Json& request, const char* name, std::int64_t fallback) {
+            const Json* value = request.find(name);
+            if (!value || value->isNull()) {
+                return fallback;
+            }
+            if (!value->isNumber()) {
+                throw std::runtime_error(std::string("Parameter '") + name + "' must be an integer");
+            }
+            return value->asInteger();
+        }
+
+        // Returns the string parameter name of a request, or nothing if it is absent.
+        std::optional<std::string> optionalStringParam(const Json& request, const char* name) {
+            const Json* value = request.find(name);
+            if (!value || value->isNull()) {
+                return std::nullopt;
+            }
+            if (!value->isString()) {
+                throw std::runtime_error(std::string("Parameter '") + name + "' must be a string");
+            }
+            return value->asString();
+        }
+
+        // Returns true for the sent log and false for the received one, named by the box parameter.
+        bool boxParam(const Json& request) {
+            const std::string& box = stringParam(request, "box");
+            if (box == "sent") {
+                return true;
+            }
+            if (box != "received") {
+                throw std::runtime_error("Parameter 'box' must be \"sent\" or \"received\"");
+            }
+            return false;
+        }
+
+        // Returns a message as a JSON object, with its timestamp in nanoseconds since the epoch.
+        Json messageJson(const message::Message& msg) {
+            Json out;
+            out["peer"] = msg.getPeerID();
+            out["topic"] = msg.getTopic();
+            out["content"] = msg.getContent();
+            out["timestamp"] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                msg.getTimestamp().time_since_epoch()).count();
+            return out;
+        }
+
+        const char* statusName(network::SendStatus status) {
+            switch (status) {
+                case network::SendStatus::QUEUED:
+                    return "queued";
+                case network::SendStatus::CONGESTED:
+                    return "congested";
+                case network::SendStatus::DROPPED:
+                    break;
+            }
+            return "dropped";
+        }
+
+    }  // namespace
+
+    // Connection of one control client. All of its handlers run on the run() thread.
+    class ControlServer::Session : public std::enable_shared_from_this<Session> {
+    public:
+        Session(ControlServer& server, stream_protocol::socket socket)
+            : server_(server), socket_(std::move(socket)) {}
+
+        // Starts reading requests.
+        void start() {
+            readLine();
+        }
+
+        // Queues a line for the client. Events are refused, and the client closed, once it
+        // has MAX_PENDING_OUTPUT unread; responses are always queued, as their volume is
+        // bounded by pausing reads.
+        void deliver(std::shared_ptr<const std::string> line, bool event) {
+            if (closed_) {
+                return;
+            }
+            if (event && pendingBytes_ >= MAX_PENDING_OUTPUT) {
+                close();
+                return;
+            }
+            pendingBytes_ += line->size();
+            output_.push_back(std::move(line));
+            if (!writing_) {
+                startWrite();
+            }
+        }
+
+        // Stops the server once the responses queued so far are written.
+        void stopServerWhenFlushed() {
+            stopWhenFlushed_ = true;
+        }
+
+        // Set while the client wants message events.
+        bool watching = false;
+
+    private:
+        // Reads up to the next newline, unless the client has too much unread output.
+        void readLine() {
+            if (closed_ || reading_ || closeWhenFlushed_ || pendingBytes_ >= MAX_PENDING_OUTPUT) {
+                return;
+            }
+            reading_ = true;
+            boost::asio::async_read_until(
+                socket_, boost::asio::dynamic_buffer(input_, MAX_REQUEST_SIZE), '\n',
+                [self = shared_from_this()](const boost::system::error_code& error, std::size_t length) {
+                    self->handleRead(error, length);
+                });
+        }
+
+        // Executes one request line and reads the next.
+        void handleRead(const boost::system::error_code& error, std::size_t length) {
+            reading_ = false;
+            if (closed_) {
+                return;
+            }
+            if (error == boost::asio::error::not_found) {
+                Json response;
+                response["ok"] = false;
+                response["error"] = "Request too long";
+                deliver(std::make_shared<const std::string>(response.dump() + "\n"), false);
+                closeWhenFlushed_ = true;
+                return;
+            }
+            if (error) {
+                close();
+                return;
+            }
+            std::string line = input_.substr(0, length - 1);
+            input_.erase(0, length);
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty()) {
+                deliver(std::make_shared<const std::string>(server_.handleLine(line, *this) + "\n"), false);
+            }
+            readLine();
+        }
+
+        // Writes every queued line in a single gather write.
+        void startWrite() {
+            writing_ = true;
+            std::vector<boost::asio::const_buffer> buffers;
+            buffers.reserve(output_.size());
+            for (auto& line : output_) {
+                buffers.push_back(boost::asio::buffer(*line));
+                inFlight_.push_back(std::move(line));
+            }
+            output_.clear();
+            boost::asio::async_write(
+                socket_, buffers, [self = shared_from_this()](const boost::system::error_code& error, std::size_t) {
+                    self->handleWrite(error);
+                });
+        }
+
+        // Releases the written lines, then writes the next ones, resumes reading, or finishes
+        // a pending close or server stop once everything is out.
+        void handleWrite(const boost::system::error_code& error) {
+            writing_ = false;
+            for (const auto& line : inFlight_) {
+                pendingBytes_ -= line->size();
+            }
+            inFlight_.clear();
+            if (error || closed_) {
+                close();
+                return;
+            }
+            if (!output_.empty()) {
+                startWrite();
+                return;
+            }
+            if (stopWhenFlushed_) {
+                server_.stop();
+            }
+            if (closeWhenFlushed_) {
+                close();
+                return;
+            }
+            readLine();
+        }
+
+        // Closes the socket; pending handlers then finish with an error and release the session.
+        void close() {
+            if (closed_) {
+                return;
+            }
+            closed_ = true;
+            watching = false;
+            boost::system::error_code ignored;
+            socket_.close(ignored);
+        }
+
+        ControlServer& server_;
+        stream_protocol::socket socket_;
+
+        // Bytes received but not yet executed.
+        std::string input_;
+
+        // Lines waiting for the current write, and the lines it is writing.
+        std::deque<std::shared_ptr<const std::string>> output_;
+        std::vector<std::shared_ptr<const std::string>> inFlight_;
+
+        // Bytes of queued and in-flight lines.
+        std::size_t pendingBytes_ = 0;
+
+        bool reading_ = false;
+        bool writing_ = false;
+        bool closed_ = false;
+        bool closeWhenFlushed_ = false;
+        bool stopWhenFlushed_ = false;
+    };
+
+    // Binds and listens, probing an existing socket file to tell a live node from a stale file.
+    ControlServer::ControlServer(network::NetworkManager& net, const std::string& path)
+        : net_(net), acceptor_(ioContext_), signals_(ioContext_, SIGINT, SIGTERM) {
+        stream_protocol::endpoint endpoint(path);
+        struct stat info;
+        if (::stat(path.c_str(), &info) == 0) {
+            if (!S_ISSOCK(info.st_mode)) {
+                throw std::runtime_error(path + " exists and is not a socket");
+            }
+            stream_protocol::socket probe(ioContext_);
+            boost::system::error_code ec;
+            probe.connect(endpoint, ec);
+            if (!ec) {
+                throw std::runtime_error("Another node is listening on " + path);
+            }
+            ::unlink(path.c_str());
+        }
+
+        boost::system::error_code ec;
+        acceptor_.open(endpoint.protocol(), ec);
+        if (!ec) {
+            acceptor_.bind(endpoint, ec);
+        }
+        if (ec) {
+            throw std::runtime_error("Failed to bind control socket " + path + ": " + ec.message());
+        }
+        path_ = path;
+
+        // The socket grants full control of the node, so only its owner may connect.
+        ::chmod(path.c_str(), S_IRUSR | S_IWUSR);
+        acceptor_.listen(boost::asio::socket_base::max_listen_connections, ec);
+        if (ec) {
+            throw std::runtime_error("Failed to listen on control socket " + path + ": " + ec.message());
+        }
+    }
+
+    // Closes the acceptor and removes the socket file; clients go with the io_context.
+    ControlServer::~ControlServer() {
+        boost::system::error_code ignored;
+        acceptor_.close(ignored);
+        ::unlink(path_.c_str());
+    }
+
+    // Returns the default socket path for a node listening on port.
+    std::string ControlServer::defaultPath(unsigned short port) {
+        return "p2p-" + std::to_string(port) + ".sock";
+    }
+
+    // Encodes the event on the calling worker thread, then hands it to the run() thread.
+    void ControlServer::onMessageReceived(const message::Message& msg) {
+        Json event = messageJson(msg);
+        event["event"] = "message";
+        auto line = std::make_shared<const std::string>(event.dump() + "\n");
+        boost::asio::post(ioContext_, [this, line]() {
+            auto gone = std::remove_if(watchers_.begin(), watchers_.end(), [&line](const auto& weak) {
+                auto session = weak.lock();
+                if (!session || !session->watching) {
+                    return true;
+                }
+                session->deliver(line, true);
+                return false;
+            });
+            watchers_.erase(gone, watchers_.end());
+        });
+    }
+
+    // Serves clients until stop().
+    void ControlServer::run() {
+        signals_.async_wait([this](const boost::system::error_code& error, int) {
+            if (!error) {
+                stop();
+            }
+        });
+        doAccept();
+        ioContext_.run();
+    }
+
+    // Makes run() return.
+    void ControlServer::stop() {
+        ioContext_.stop();
+    }
+
+    // Accepts clients asynchronously.
+    void ControlServer::doAccept() {
+        acceptor_.async_accept([this](const boost::system::error_code& error, stream_protocol::socket socket) {
+            if (error == boost::asio::error::operation_aborted) {
+                return;
+            }
+            if (!error) {
+                std::make_shared<Session>(*this, std::move(socket))->start();
+            }
+            doAccept();
+        });
+    }
+
+    // Dispatches a request to its command. Any exception becomes an error response,
+    // so a bad request never affects the client's other requests.
+    std::string ControlServer::handleLine(const std::string& line, Session& session) {
+        static const std::unordered_map<std::string, Command> commands = {
+            {"info", &ControlServer::info},
+            {"connect", &ControlServer::connect},
+            {"peers", &ControlServer::peers},
+            {"send", &ControlServer::send},
+            {"broadcast", &ControlServer::broadcast},
+            {"gossip", &ControlServer::gossip},
+            {"subscribe", &ControlServer::subscribe},
+            {"unsubscribe", &ControlServer::unsubscribe},
+            {"subscriptions", &ControlServer::subscriptions},
+            {"send_file", &ControlServer::sendFile},
+            {"transfers", &ControlServer::transfers},
+            {"inbox", &ControlServer::inbox},
+            {"delete", &ControlServer::remove},
+            {"search", &ControlServer::search},
+            {"stats", &ControlServer::stats},
+            {"metrics", &ControlServer::metrics},
+            {"watch", &ControlServer::watch},
+            {"shutdown", &ControlServer::shutdown},
+        };
+
+        Json response;
+        try {
+            Json request = Json::parse(line);
+            if (!request.isObject()) {
+                throw std::runtime_error("Request must be a JSON object");
+            }
+            if (const Json* id = request.find("id")) {
+                response["id"] = *id;
+            }
+            auto it = commands.find(stringParam(request, "cmd"));
+            if (it == commands.end()) {
+                throw std::runtime_error("Unknown command '" + request.find("cmd")->asString() + "'");
+            }
+            Json result = (this->*(it->second))(request, session);
+            if (result.isObject()) {
+                for (const auto& [key, value] : result.asObject()) {
+                    response[key] = value;
+                }
+            }
+            response["ok"] = true;
+        } catch (const std::exception& e) {
+            response["ok"] = false;
+            response["error"] = e.what();
+        }
+        return response.dump();
+    }
+
+    // Returns the node's address and a summary of its state.
+    Json ControlServer::info(const Json&, Session&) {
+        Json result;
+        result["address"] = net_.getListeningAddress();
+        result["peers"] = net_.listPeers().size();
+        result["subscriptions"] = Json(Json::Array());
+        for (const auto& topic : net_.listSubscriptions()) {
+            result["subscriptions"].push(topic);
+        }
+        return result;
+    }
+
+    // Starts connecting to "address" (ip:port, port 5555 if omitted). The connection completes
+    // asynchronously; poll peers to see it.
+    Json ControlServer::connect(const Json& request, Session&) {
+        const std::string& address = stringParam(request, "address");
+        auto pos = address.find(':');
+        std::string ip = address.substr(0, pos);
+        unsigned long port = 5555;
+        if (pos != std::string::npos) {
+            std::size_t used = 0;
+            try {
+                port = std::stoul(address.substr(pos + 1), &used);
+            } catch (const std::exception&) {
+                used = 0;
+            }
+            if (used == 0 || used != address.size() - pos - 1 || port == 0 || port > 65535) {
+                throw std::runtime_error("Invalid port number");
+            }
+        }
+        try {
+            net_.connectToPeer(ip, static_cast<unsigned short>(port));
+        } catch (const boost::system::system_error&) {
+            throw std::runtime_error("Invalid address " + ip);
+        }
+        return Json();
+    }
+
+    // Returns the connected peers.
+    Json ControlServer::peers(const Json&, Session&) {
+        Json result;
+        result["peers"] = peerList();
+        return result;
+    }
+
+    // Sends a message to "peer" and logs it, reporting whether it was queued.
+    Json ControlServer::send(const Json& request, Session&) {
+        const std::string& peer = stringParam(request, "peer");
+        message::Message msg = composeMessage(request);
+        Json result;
+        result["status"] = statusName(net_.sendMessage(peer, msg.encode()));
+        return result;
+    }
+
+    // Broadcasts a message to the subscribed peers and logs it.
+    Json ControlServer::broadcast(const Json& request, Session&) {
+        message::Message msg = composeMessage(request);
+        Json result;
+        result["backlogged"] = net_.broadcastMessage(msg.encode());
+        return result;
+    }
+
+    // Gossips a message to the network and logs it.
+    Json ControlServer::gossip(const Json& request, Session&) {
+        message::Message msg = composeMessage(request);
+        Json result;
+        result["sent"] = net_.gossipMessage(msg.encode());
+        return result;
+    }
+
+    // Subscribes to "pattern".
+    Json ControlServer::subscribe(const Json& request, Session&) {
+        const std::string& pattern = stringParam(request, "pattern");
+        if (!net_.subscribeTopic(pattern)) {
+            throw std::runtime_error(pattern + " is invalid or already subscribed");
+        }
+        return Json();
+    }
+
+    // Unsubscribes from "pattern".
+    Json ControlServer::unsubscribe(const Json& request, Session&) {
+        const std::string& pattern = stringParam(request, "pattern");
+        if (!net_.unsubscribeTopic(pattern)) {
+            throw std::runtime_error("Not subscribed to " + pattern);
+        }
+        return Json();
+    }
+
+    // Returns the subscribed topic patterns.
+    Json ControlServer::subscriptions(const Json&, Session&) {
+        Json result;
+        result["subscriptions"] = Json(Json::Array());
+        for (const auto& topic : net_.listSubscriptions()) {
+            result["subscriptions"].push(topic);
+        }
+        return result;
+    }
+
+    // Offers the file at "path" to "peer".
+    Json ControlServer::sendFile(const Json& request, Session&) {
+        const std::string& peer = stringParam(request, "peer");
+        if (!net_.sendFile(peer, stringParam(request, "path"))) {
+            throw std::runtime_error("Peer " + peer + " is not connected");
+        }
+        return Json();
+    }
+
+    // Returns descriptions of the file transfers.
+    Json ControlServer::transfers(const Json&, Session&) {
+        Json result;
+        result["transfers"] = Json(Json::Array());
+        for (const auto& transfer : net_.listTransferInfo()) {
+            result["transfers"].push(transfer);
+        }
+        return result;
+    }
+
+    // Returns up to "limit" messages of "box" matching the optional "peer", "topic", "from" and
+    // "to" (epoch nanoseconds, "to" exclusive) in timestamp order, skipping "offset" matches,
+    // with the number of matches. Each message carries the "message_id" that deletes it.
+    Json ControlServer::inbox(const Json& request, Session&) {
+        logging::MessageQuery query;
+        query.sent = boxParam(request);
+        query.peer = optionalStringParam(request, "peer");
+        query.topic = optionalStringParam(request, "topic");
+        query.fromNs = integerParam(request, "from", query.fromNs);
+        query.toNs = integerParam(request, "to", query.toNs);
+        std::int64_t offset = integerParam(request, "offset", 0);
+        std::int64_t limit = integerParam(request, "limit", DEFAULT_INBOX_LIMIT);
+        if (offset < 0 || limit < 0 || limit > MAX_INBOX_LIMIT) {
+            throw std::runtime_error("Parameters 'offset' and 'limit' are out of range");
+        }
+        query.offset = static_cast<std::size_t>(offset);
+        query.limit = static_cast<std::size_t>(limit);
+        auto page = logger_.queryMessages(query);
+        Json result;
+        result["total"] = page.total;
+        result["messages"] = Json(Json::Array());
+        for (const auto& handle : page.handles) {
+            try {
+                message::Message msg = logger_.getMessage(handle);
+                Json entry = messageJson(msg);
+                entry["message_id"] = handle.id;
+                entry["read"] = msg.isRead();
+                result["messages"].push(std::move(entry));
+            } catch (const std::out_of_range&) {
+                // Deleted by another client since the query.
+            }
+        }
+        return result;
+    }
+
+    // Deletes message "message_id" of "box".
+    Json ControlServer::remove(const Json& request, Session&) {
+        bool sent = boxParam(request);
+        std::int64_t id = integerParam(request, "message_id", -1);
+        if (id < 0 || !logger_.deleteMessage(logging::MessageHandle{sent, static_cast<logging::MessageId>(id)})) {
+            throw std::runtime_error("No message with that 'message_id'");
+        }
+        return Json();
+    }
+
+    // Returns up to "limit" sent and received messages best matching the words of "query",
+    // best first, each with its "box", "message_id" and "score", and the number of matches.
+    Json ControlServer::search(const Json& request, Session&) {
+        const std::string& text = stringParam(request, "query");
+        std::int64_t limit = integerParam(request, "limit", DEFAULT_SEARCH_LIMIT);
+        if (limit < 0 || limit > MAX_INBOX_LIMIT) {
+            throw std::runtime_error("Parameter 'limit' is out of range");
+        }
+        auto results = logger_.searchMessages(text, static_cast<std::size_t>(limit));
+        Json result;
+        result["total"] = results.total;
+        result["messages"] = Json(Json::Array());
+        for (const auto& hit : results.hits) {
+            try {
+                message::Message msg = logger_.getMessage(hit.handle);
+                Json entry = messageJson(msg);
+                entry["box"] = hit.handle.sent ? "sent" : "received";
+                entry["message_id"] = hit.handle.id;
+                entry["read"] = msg.isRead();
+                entry["score"] = hit.score;
+                result["messages"].push(std::move(entry));
+            } catch (const std::out_of_range&) {
+                // Deleted by another client since the search.
+            }
+        }
+        return result;
+    }
+
+    // Returns node-wide counters.
+    Json ControlServer::stats(const Json&, Session&) {
+        auto peers = net_.listPeers();
+        std::size_t congested = 0;
+        std::size_t encrypted = 0;
+        std::size_t queued = 0;
+        for (const auto& peer : peers) {
+            congested += peer->isCongested();
+            encrypted += peer->isEncrypted();
+            queued += peer->queuedBytes();
+        }
+        Json result;
+        result["address"] = net_.getListeningAddress();
+        result["peers"] = peers.size();
+        result["congested_peers"] = congested;
+        result["encrypted_peers"] = encrypted;
+        result["queued_bytes"] = queued;
+        result["sent"] = logger_.messageCount(true);
+        result["received"] = logger_.messageCount(false);
+        result["transfers"] = net_.listTransferInfo().size();
+        result["watchers"] = std::count_if(watchers_.begin(), watchers_.end(), [](const auto& weak) {
+            auto session = weak.lock();
+            return session && session->watching;
+        });
+        return result;
+    }
+
+    // Returns every metric in the Prometheus text format, for a scraper to serve or store.
+    Json ControlServer::metrics(const Json&, Session&) {
+        Json result;
+        result["text"] = metrics::Registry::instance().exportText();
+        return result;
+    }
+
+    // Turns message events for the client on, or off with "enabled": false.
+    Json ControlServer::watch(const Json& request, Session& session) {
+        const Json* enabled = request.find("enabled");
+        bool on = !enabled || enabled->isNull() || enabled->asBool();
+        if (on && !session.watching) {
+            watchers_.push_back(session.shared_from_this());
+        }
+        session.watching = on;
+        return Json();
+    }
+
+    // Stops the node once the response is written.
+    Json ControlServer::shutdown(const Json&, Session& session) {
+        session.stopServerWhenFlushed();
+        return Json();
+    }
+
+    // Returns the connected peers as JSON objects.
+    Json ControlServer::peerList() const {
+        Json list = Json(Json::Array());
+        auto now = std::chrono::steady_clock::now();
+        for (const auto& peer : net_.listPeers()) {
+            Json entry;
+            entry["id"] = peer->getPeerID();
+            entry["address"] = peer->getAddress();
+            entry["handshake"] = peer->handshakeComplete();
+            entry["capabilities"] = peer->capabilities();
+            entry["encrypted"] = peer->isEncrypted();
+            entry["congested"] = peer->isCongested();
+            entry["queued_bytes"] = peer->queuedBytes();
+            entry["idle_ms"] = std::chrono::duration_cast<std::chrono::milliseconds>(now - peer->lastActive()).count();
+            list.push(std::move(entry));
+        }
+        return list;
+    }
+
+    // Builds the message from "topic" and "content" and logs it, as the terminal UI does.
+    message::Message ControlServer::composeMessage(const Json& request) {
+        std::string topic = stringParam(request, "topic");
+        if (topic.empty()) {
+            topic = "(empty)"; // Placeholder for empty topics.
+        }
+        message::Message msg(net_.getListeningAddress(), topic, stringParam(request, "content"),
+                             message::MessageType::SENT);
+        logger_.appendMessage(msg);
+        return msg;
+    }
+
+}  // namespace control
@@ -0,0 +1,465 @@
+#include "control/Json.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace control {
+
+    namespace {
+
+        // Deepest nesting of arrays and objects accepted by the parser, bounding its recursion.
+        constexpr int MAX_DEPTH = 64;
+
+        // Recursive-descent parser over a complete JSON text.
+        class Parser {
+        public:
+            explicit Parser(std::string_view text) : text_(text) {}
+
+            Json parseDocument() {
+                Json value = parseValue(0);
+                skipWhitespace();
+                if (pos_ != text_.size()) {
+                    fail("unexpected trailing characters");
+                }
+                return value;
+            }
+
+        private:
+            [[noreturn]] void fail(const char* what) const {
+                throw std::runtime_error("Invalid JSON at offset " + std::to_string(pos_) + ": " + what);
+            }
+
+            void skipWhitespace() {
+                while (pos_ < text_.size() &&
+                       (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r')) {
+                    ++pos_;
+                }
+            }
+
+            char peek() {
+                skipWhitespace();
+                if (pos_ == text_.size()) {
+                    fail("unexpected end of input");
+                }
+                return text_[pos_];
+            }
+
+            void expect(std::string_view literal) {
+                if (text_.substr(pos_, literal.size()) != literal) {
+                    fail("unexpected character");
+                }
+                pos_ += literal.size();
+            }
+
+            Json parseValue(int depth) {
+                char c = peek();
+                switch (c) {
+                    case '{':
+                        return parseObject(depth + 1);
+                    case '[':
+                        return parseArray(depth + 1);
+                    case '"':
+                        return Json(parseString());
+                    case 't':
+                        expect("true");
+                        return Json(true);
+                    case 'f':
+                        expect("false");
+                        return Json(false);
+                    case 'n':
+                        expect("null");
+                        return Json();
+                    default:
+                        if (c == '-' || (c >= '0' && c <= '9')) {
+                            return parseNumber();
+                        }
+                        fail("unexpected character");
+                }
+            }
+
+            Json parseObject(int depth) {
+                if (depth > MAX_DEPTH) {
+                    fail("nested too deeply");
+                }
+                ++pos_;
+                Json::Object object;
+                if (peek() == '}') {
+                    ++pos_;
+                    return Json(std::move(object));
+                }
+                while (true) {
+                    if (peek() != '"') {
+                        fail("expected member name");
+                    }
+                    std::string key = parseString();
+                    if (peek() != ':') {
+                        fail("expected ':'");
+                    }
+                    ++pos_;
+                    object[std::move(key)] = parseValue(depth);
+                    char c = peek();
+                    ++pos_;
+                    if (c == '}') {
+                        return Json(std::move(object));
+                    }
+                    if (c != ',') {
+                        fail("expected ',' or '}'");
+                    }
+                }
+            }
+
+            Json parseArray(int depth) {
+                if (depth > MAX_DEPTH) {
+                    fail("nested too deeply");
+                }
+                ++pos_;
+                Json::Array array;
+                if (peek() == ']') {
+                    ++pos_;
+                    return Json(std::move(array));
+                }
+                while (true) {
+                    array.push_back(parseValue(depth));
+                    char c = peek();
+                    ++pos_;
+                    if (c == ']') {
+                        return Json(std::move(array));
+                    }
+                    if (c != ',') {
+                        fail("expected ',' or ']'");
+                    }
+                }
+            }
+
+            unsigned parseHex4() {
+                if (text_.size() - pos_ < 4) {
+                    fail("truncated escape");
+                }
+                unsigned value = 0;
+                for (int i = 0; i < 4; ++i) {
+                    char c = text_[pos_++];
+                    value <<= 4;
+                    if (c >= '0' && c <= '9') {
+                        value |= c - '0';
+                    } else if (c >= 'a' && c <= 'f') {
+                        value |= c - 'a' + 10;
+                    } else if (c >= 'A' && c <= 'F') {
+                        value |= c - 'A' + 10;
+                    } else {
+                        fail("invalid escape");
+                    }
+                }
+                return value;
+            }
+
+            static void appendUtf8(std::string& out, unsigned codePoint) {
+                if (codePoint < 0x80) {
+                    out += static_cast<char>(codePoint);
+                } else if (codePoint < 0x800) {
+                    out += static_cast<char>(0xC0 | (codePoint >> 6));
+                    out += static_cast<char>(0x80 | (codePoint & 0x3F));
+                } else if (codePoint < 0x10000) {
+                    out += static_cast<char>(0xE0 | (codePoint >> 12));
+                    out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (codePoint & 0x3F));
+                } else {
+                    out += static_cast<char>(0xF0 | (codePoint >> 18));
+                    out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                    out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (codePoint & 0x3F));
+                }
+            }
+
+            // Strings are taken byte for byte apart from escapes, so UTF-8 passes through unchanged.
+            std::string parseString() {
+                ++pos_;
+                std::string out;
+                while (true) {
+                    if (pos_ == text_.size()) {
+                        fail("unterminated string");
+                    }
+                    char c = text_[pos_++];
+                    if (c == '"') {
+                        return out;
+                    }
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        fail("control character in string");
+                    }
+                    if (c != '\\') {
+                        out += c;
+                        continue;
+                    }
+                    if (pos_ == text_.size()) {
+                        fail("unterminated string");
+                    }
+                    switch (text_[pos_++]) {
+                        case '"': out += '"'; break;
+                        case '\\': out += '\\'; break;
+                        case '/': out += '/'; break;
+                        case 'b': out += '\b'; break;
+                        case 'f': out += '\f'; break;
+                        case 'n': out += '\n'; break;
+                        case 'r': out += '\r'; break;
+                        case 't': out += '\t'; break;
+                        case 'u': {
+                            unsigned codePoint = parseHex4();
+                            if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+                                expect("\\u");
+                                unsigned low = parseHex4();
+                                if (low < 0xDC00 || low >= 0xE000) {
+                                    fail("invalid surrogate pair");
+                                }
+                                codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                            } else if (codePoint >= 0xDC00 && codePoint < 0xE000) {
+                                fail("invalid surrogate pair");
+                            }
+                            appendUtf8(out, codePoint);
+                            break;
+                        }
+                        default:
+                            fail("invalid escape");
+                    }
+                }
+            }
+
+            // Integers that fit in 64 bits stay exact; anything with a fraction or exponent,
+            // or out of range, becomes a double.
+            Json parseNumber() {
+                std::size_t start = pos_;
+                if (text_[pos_] == '-') {
+                    ++pos_;
+                }
+                std::size_t digits = pos_;
+                while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') {
+                    ++pos_;
+                }
+                if (pos_ == digits || (text_[digits] == '0' && pos_ - digits > 1)) {
+                    fail("invalid number");
+                }
+                bool integral = true;
+                if (pos_ < text_.size() && text_[pos_] == '.') {
+                    integral = false;
+                    std::size_t fraction = ++pos_;
+                    while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') {
+                        ++pos_;
+                    }
+                    if (pos_ == fraction) {
+                        fail("invalid number");
+                    }
+                }
+                if (pos_ < text_.size() && (text_[pos_] == 'e' || text_[pos_] == 'E')) {
+                    integral = false;
+                    ++pos_;
+                    if (pos_ < text_.size() && (text_[pos_] == '+' || text_[pos_] == '-')) {
+                        ++pos_;
+                    }
+                    std::size_t exponent = pos_;
+                    while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') {
+                        ++pos_;
+                    }
+                    if (pos_ == exponent) {
+                        fail("invalid number");
+                    }
+                }
+                std::string number(text_.substr(start, pos_ - start));
+                if (integral) {
+                    errno = 0;
+                    long long value = std::strtoll(number.c_str(), nullptr, 10);
+                    if (errno != ERANGE) {
+                        return Json(static_cast<std::int64_t>(value));
+                    }
+                }
+                return Json(std::strtod(number.c_str(), nullptr));
+            }
+
+            std::string_view text_;
+            std::size_t pos_ = 0;
+        };
+
+        void dumpString(std::string& out, const std::string& value) {
+            out += '"';
+            for (char c : value) {
+                switch (c) {
+                    case '"': out += "\\\""; break;
+                    case '\\': out += "\\\\"; break;
+                    case '\n': out += "\\n"; break;
+                    case '\r': out += "\\r"; break;
+                    case '\t': out += "\\t"; break;
+                    default:
+                        if (static_cast<unsigned char>(c) < 0x20) {
+                            char escape[8];
+                            std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+                            out += escape;
+                        } else {
+                            out += c;
+                        }
+                }
+            }
+            out += '"';
+        }
+
+        [[noreturn]] void wrongType(const char* expected) {
+            throw std::runtime_error(std::string("Expected a JSON ") + expected);
+        }
+
+    }  // namespace
+
+    bool Json::asBool() const {
+        if (!isBool()) {
+            wrongType("boolean");
+        }
+        return std::get<bool>(value_);
+    }
+
+    std::int64_t Json::asInteger() const {
+        if (isInteger()) {
+            return std::get<std::int64_t>(value_);
+        }
+        if (std::holds_alternative<double>(value_)) {
+            double value = std::get<double>(value_);
+            if (std::trunc(value) == value && std::fabs(value) < 9.2e18) {
+                return static_cast<std::int64_t>(value);
+            }
+        }
+        wrongType("integer");
+    }
+
+    double Json::asDouble() const {
+        if (isInteger()) {
+            return static_cast<double>(std::get<std::int64_t>(value_));
+        }
+        if (!std::holds_alternative<double>(value_)) {
+            wrongType("number");
+        }
+        return std::get<double>(value_);
+    }
+
+    const std::string& Json::asString() const {
+        if (!isString()) {
+            wrongType("string");
+        }
+        return std::get<std::string>(value_);
+    }
+
+    const Json::Array& Json::asArray() const {
+        if (!isArray()) {
+            wrongType("array");
+        }
+        return std::get<Array>(value_);
+    }
+
+    const Json::Object& Json::asObject() const {
+        if (!isObject()) {
+            wrongType("object");
+        }
+        return std::get<Object>(value_);
+    }
+
+    // Returns the member named key, if any.
+    const Json* Json::find(const std::string& key) const {
+        if (!isObject()) {
+            return nullptr;
+        }
+        const auto& object = std::get<Object>(value_);
+        auto it = object.find(key);
+        return it == object.end() ? nullptr : &it->second;
+    }
+
+    // Returns the member named key, creating the object and the member as needed.
+    Json& Json::operator[](const std::string& key) {
+        if (isNull()) {
+            value_ = Object();
+        }
+        if (!isObject()) {
+            wrongType("object");
+        }
+        return std::get<Object>(value_)[key];
+    }
+
+    // Appends an element, creating the array as needed.
+    void Json::push(Json value) {
+        if (isNull()) {
+            value_ = Array();
+        }
+        if (!isArray()) {
+            wrongType("array");
+        }
+        std::get<Array>(value_).push_back(std::move(value));
+    }
+
+    // Parses a complete JSON text.
+    Json Json::parse(std::string_view text) {
+        return Parser(text).parseDocument();
+    }
+
+    // Serializes the value on a single line.
+    std::string Json::dump() const {
+        std::string out;
+        dump(out);
+        return out;
+    }
+
+    // Appends the serialized value to out. Non-finite doubles, which JSON cannot express, become null.
+    void Json::dump(std::string& out) const {
+        switch (value_.index()) {
+            case 0:
+                out += "null";
+                break;
+            case 1:
+                out += std::get<bool>(value_) ? "true" : "false";
+                break;
+            case 2:
+                out += std::to_string(std::get<std::int64_t>(value_));
+                break;
+            case 3: {
+                double value = std::get<double>(value_);
+                if (!std::isfinite(value)) {
+                    out += "null";
+                    break;
+                }
+                // The shortest of 15 or 17 significant digits that reads back as the same value.
+                char number[32];
+                std::snprintf(number, sizeof(number), "%.15g", value);
+                if (std::strtod(number, nullptr) != value) {
+                    std::snprintf(number, sizeof(number), "%.17g", value);
+                }
+                out += number;
+                break;
+            }
+            case 4:
+                dumpString(out, std::get<std::string>(value_));
+                break;
+            case 5: {
+                out += '[';
+                bool first = true;
+                for (const auto& element : std::get<Array>(value_)) {
+                    if (!first) {
+                        out += ',';
+                    }
+                    first = false;
+                    element.dump(out);
+                }
+                out += ']';
+                break;
+            }
+            case 6: {
+                out += '{';
+                bool first = true;
+                for (const auto& [key, member] : std::get<Object>(value_)) {
+                    if (!first) {
+                        out += ',';
+                    }
+                    first = false;
+                    dumpString(out, key);
+                    out += ':';
+                    member.dump(out);
+                }
+                out += '}';
+                break;
+            }
+        }
+    }
+
+}  // namespace control
@@ -0,0 +1,456 @@
+#include "log/LogFile.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <unordered_set>
+
+namespace logging {
+
+    namespace {
+
+        // Minimum number of deleted records before a compaction is considered.
+        constexpr std::size_t COMPACTION_MIN_DEAD = 1024;
+
+        // Size of the little-endian length prefix in front of every record.
+        constexpr std::size_t RECORD_PREFIX_SIZE = 4;
+
+        // Size of one little-endian offset in the index file.
+        constexpr std::size_t INDEX_ENTRY_SIZE = 8;
+
+        // In-memory tail size beyond which appended records are remapped from disk.
+        constexpr std::size_t MAX_TAIL_BYTES = 64 * 1024 * 1024;
+
+        // Bytes gathered before each write while a file is rewritten.
+        constexpr std::size_t REWRITE_BUFFER_BYTES = 1024 * 1024;
+
+        // Reads the 4-byte little-endian record length at data.
+        std::uint32_t readRecordLength(const char* data) {
+            std::uint32_t length = 0;
+            for (std::size_t i = 0; i < RECORD_PREFIX_SIZE; ++i) {
+                length |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+            }
+            return length;
+        }
+
+        // Prefixes a record with its 4-byte little-endian length.
+        std::string frameRecord(const std::string& record) {
+            std::string framed;
+            framed.reserve(RECORD_PREFIX_SIZE + record.size());
+            auto length = static_cast<std::uint32_t>(record.size());
+            for (std::size_t i = 0; i < RECORD_PREFIX_SIZE; ++i) {
+                framed.push_back(static_cast<char>((length >> (8 * i)) & 0xFF));
+            }
+            framed += record;
+            return framed;
+        }
+
+        // Encodes a file offset as an index entry.
+        std::string encodeIndexEntry(std::uint64_t offset) {
+            std::string entry(INDEX_ENTRY_SIZE, '\0');
+            for (std::size_t i = 0; i < INDEX_ENTRY_SIZE; ++i) {
+                entry[i] = static_cast<char>((offset >> (8 * i)) & 0xFF);
+            }
+            return entry;
+        }
+
+        // Writes all bytes to fd, retrying on partial writes and interrupts. Returns false on error.
+        bool writeAll(int fd, const std::string& bytes) {
+            const char* data = bytes.data();
+            std::size_t left = bytes.size();
+            while (left > 0) {
+                ssize_t written = ::write(fd, data, left);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return false;
+                }
+                data += written;
+                left -= static_cast<std::size_t>(written);
+            }
+            return true;
+        }
+
+        // Flushes the directory holding path, so renames and removals in it are durable.
+        bool syncDirectory(const std::string& path) {
+            std::string directory = std::filesystem::path(path).parent_path().string();
+            int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd < 0) {
+                return false;
+            }
+            bool synced = ::fsync(fd) == 0;
+            ::close(fd);
+            return synced;
+        }
+
+        // Writes a complete index file for the given offsets and flushes it to disk.
+        // Returns false on error, leaving a partial file behind.
+        bool writeIndexFile(const std::string& path, const std::vector<std::uint64_t>& offsets) {
+            int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                return false;
+            }
+            bool written = true;
+            std::string buffer;
+            for (std::size_t i = 0; written && i < offsets.size(); ++i) {
+                buffer += encodeIndexEntry(offsets[i]);
+                if (buffer.size() >= REWRITE_BUFFER_BYTES || i + 1 == offsets.size()) {
+                    written = writeAll(fd, buffer);
+                    buffer.clear();
+                }
+            }
+            written = written && ::fdatasync(fd) == 0;
+            return ::close(fd) == 0 && written;
+        }
+
+    }  // namespace
+
+    // Constructs a log backed by path, with tombstones in path + ".del" and the index in path + ".idx".
+    LogFile::LogFile(const std::string& path, LogWriter& writer)
+        : path_(path), indexPath_(path + ".idx"), tombstonePath_(path + ".del"), writer_(writer) {}
+
+    // Unmaps the file and closes the descriptors after the writer has flushed them.
+    LogFile::~LogFile() {
+        close();
+        unmap();
+    }
+
+    // Maps the file and loads the persisted offset index.
+    // Only records past the end of the index (appended before a crash, or all of them
+    // if the index is missing) are scanned; a torn record at the end is cut off.
+    void LogFile::load() {
+        std::unordered_set<std::uint64_t> deleted;
+        {
+            std::ifstream tombstoneFile(tombstonePath_);
+            std::uint64_t offset;
+            while (tombstoneFile >> offset) {
+                deleted.insert(offset);
+            }
+        }
+
+        std::vector<std::uint64_t> offsets;
+        {
+            std::ifstream indexFile(indexPath_, std::ios::binary);
+            std::string raw((std::istreambuf_iterator<char>(indexFile)), std::istreambuf_iterator<char>());
+            offsets.reserve(raw.size() / INDEX_ENTRY_SIZE);
+            for (std::size_t pos = 0; pos + INDEX_ENTRY_SIZE <= raw.size(); pos += INDEX_ENTRY_SIZE) {
+                std::uint64_t offset = 0;
+                for (std::size_t i = 0; i < INDEX_ENTRY_SIZE; ++i) {
+                    offset |= static_cast<std::uint64_t>(static_cast<unsigned char>(raw[pos + i])) << (8 * i);
+                }
+                offsets.push_back(offset);
+            }
+        }
+
+        // Every record file starts with a record, so an index that does not start at offset
+        // zero belongs to another file, such as the one a compaction was replacing; rebuild it.
+        if (!offsets.empty() && offsets.front() != 0) {
+            offsets.clear();
+        }
+
+        map();
+
+        // Drop index entries for records that never fully reached the file.
+        auto fits = [this](std::uint64_t offset) {
+            return offset + RECORD_PREFIX_SIZE <= mapSize_ &&
+                   offset + RECORD_PREFIX_SIZE + readRecordLength(map_ + offset) <= mapSize_;
+        };
+        std::size_t indexed = offsets.size();
+        while (!offsets.empty() && !fits(offsets.back())) {
+            offsets.pop_back();
+        }
+
+        // Index any records the index does not cover yet.
+        std::uint64_t end = 0;
+        if (!offsets.empty()) {
+            end = offsets.back() + RECORD_PREFIX_SIZE + readRecordLength(map_ + offsets.back());
+        }
+        while (fits(end)) {
+            offsets.push_back(end);
+            end += RECORD_PREFIX_SIZE + readRecordLength(map_ + end);
+        }
+        if (end < mapSize_) {
+            unmap();
+            std::error_code ec;
+            std::filesystem::resize_file(path_, end, ec);
+            map();
+        }
+        if (offsets.size() != indexed && !writeIndexFile(indexPath_, offsets)) {
+            std::cerr << "Failed to rewrite index " << indexPath_ << ": " << std::strerror(errno) << "\n";
+        }
+
+        // Apply tombstones.
+        if (deleted.empty()) {
+            liveOffsets_ = std::move(offsets);
+            deadCount_ = 0;
+        } else {
+            liveOffsets_.clear();
+            liveOffsets_.reserve(offsets.size());
+            for (std::uint64_t offset : offsets) {
+                if (!deleted.count(offset)) {
+                    liveOffsets_.push_back(offset);
+                }
+            }
+            deadCount_ = offsets.size() - liveOffsets_.size();
+        }
+
+        openForAppend();
+        if (needsCompaction()) {
+            compact();
+        }
+    }
+
+    // Returns the number of live records.
+    std::size_t LogFile::size() const {
+        return liveOffsets_.size();
+    }
+
+    // Returns the live record at the given position, from the mapping or the in-memory tail.
+    std::string_view LogFile::record(std::size_t liveIndex) const {
+        std::uint64_t offset = liveOffsets_.at(liveIndex);
+        const char* framed = offset < mapSize_ ? map_ + offset : tail_.data() + (offset - mapSize_);
+        return std::string_view(framed + RECORD_PREFIX_SIZE, readRecordLength(framed));
+    }
+
+    // Returns the file offset of the live record at the given position.
+    std::uint64_t LogFile::offset(std::size_t liveIndex) const {
+        return liveOffsets_.at(liveIndex);
+    }
+
+    // Live offsets ascend, so this is a binary search.
+    std::size_t LogFile::positionAtOrAfter(std::uint64_t offset) const {
+        return std::lower_bound(liveOffsets_.begin(), liveOffsets_.end(), offset) - liveOffsets_.begin();
+    }
+
+    // Returns the position of the live record at offset, or nothing if none starts there.
+    std::optional<std::size_t> LogFile::position(std::uint64_t offset) const {
+        std::size_t position = positionAtOrAfter(offset);
+        if (position == liveOffsets_.size() || liveOffsets_[position] != offset) {
+            return std::nullopt;
+        }
+        return position;
+    }
+
+    // Records never straddle the mapping and the tail, so one bounds check covers either.
+    std::optional<std::string_view> LogFile::recordAt(std::uint64_t offset) const {
+        const char* data = map_;
+        std::uint64_t size = mapSize_;
+        if (offset >= mapSize_) {
+            data = tail_.data();
+            size = tail_.size();
+            offset -= mapSize_;
+        }
+        if (offset + RECORD_PREFIX_SIZE > size || offset + RECORD_PREFIX_SIZE + readRecordLength(data + offset) > size) {
+            return std::nullopt;
+        }
+        return std::string_view(data + offset + RECORD_PREFIX_SIZE, readRecordLength(data + offset));
+    }
+
+    // Returns the path of the record file.
+    const std::string& LogFile::path() const {
+        return path_;
+    }
+
+    // Hands one length-prefixed record and its index entry to the writer.
+    // Cost is independent of history size.
+    std::future<void> LogFile::append(const std::string& record) {
+        if (failed()) {
+            throw std::system_error(failure_, "Log file " + path_ + " is not writable");
+        }
+        std::string framed = frameRecord(record);
+        std::uint64_t offset = mapSize_ + tail_.size();
+        tail_ += framed;
+        liveOffsets_.push_back(offset);
+        auto durable = writer_.submit(recordsFd_, std::move(framed));
+        writer_.submit(indexFd_, encodeIndexEntry(offset));
+        remapIfTailLarge();
+        return durable;
+    }
+
+    // Records the deletion of the live record at the given position.
+    void LogFile::erase(std::size_t liveIndex) {
+        if (liveIndex >= liveOffsets_.size()) {
+            return;
+        }
+        writer_.submit(tombstonesFd_, std::to_string(liveOffsets_[liveIndex]) + "\n");
+        liveOffsets_.erase(liveOffsets_.begin() + liveIndex);
+        ++deadCount_;
+    }
+
+    // Returns true once deleted records outnumber live ones (past a minimum).
+    bool LogFile::needsCompaction() const {
+        return deadCount_ >= COMPACTION_MIN_DEAD && deadCount_ > liveOffsets_.size();
+    }
+
+    // Rewrites the live records and their index into temporary files, flushes both to disk and
+    // swaps them in. The order keeps the files consistent at every step a crash could stop at:
+    // the tombstones and the old index go first, so the old records still load by scanning
+    // (only with the deletions since the last compaction undone); the new index is installed
+    // only once the new records are in place. Until the records are swapped, any error leaves
+    // the log as it was.
+    void LogFile::compact() {
+        close();
+        std::string tempPath = path_ + ".tmp";
+        std::string tempIndexPath = indexPath_ + ".tmp";
+        std::error_code ec;
+        auto abandon = [&](const char* step) {
+            std::cerr << "Compaction of " << path_ << " abandoned, failed to " << step << ": "
+                      << (ec ? ec.message() : std::string(std::strerror(errno))) << "\n";
+            std::filesystem::remove(tempPath, ec);
+            std::filesystem::remove(tempIndexPath, ec);
+            openForAppend();
+        };
+
+        std::vector<std::uint64_t> newOffsets;
+        newOffsets.reserve(liveOffsets_.size());
+        int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            abandon("create the new records");
+            return;
+        }
+        bool written = true;
+        std::string buffer;
+        std::uint64_t offset = 0;
+        for (std::size_t i = 0; written && i < liveOffsets_.size(); ++i) {
+            std::string_view data = record(i);
+            buffer.append(data.data() - RECORD_PREFIX_SIZE, RECORD_PREFIX_SIZE + data.size());
+            newOffsets.push_back(offset);
+            offset += RECORD_PREFIX_SIZE + data.size();
+            if (buffer.size() >= REWRITE_BUFFER_BYTES || i + 1 == liveOffsets_.size()) {
+                written = writeAll(fd, buffer);
+                buffer.clear();
+            }
+        }
+        written = written && ::fdatasync(fd) == 0;
+        if (::close(fd) != 0 || !written) {
+            abandon("write the new records");
+            return;
+        }
+        if (!writeIndexFile(tempIndexPath, newOffsets)) {
+            abandon("write the new index");
+            return;
+        }
+
+        std::filesystem::remove(tombstonePath_, ec);
+        if (ec) {
+            abandon("remove the tombstones");
+            return;
+        }
+        std::filesystem::remove(indexPath_, ec);
+        if (ec || !syncDirectory(path_)) {
+            abandon("remove the old index");
+            return;
+        }
+        std::filesystem::rename(tempPath, path_, ec);
+        if (ec) {
+            abandon("replace the records");
+            return;
+        }
+        std::filesystem::rename(tempIndexPath, indexPath_, ec);
+        if (ec || !syncDirectory(path_)) {
+            // The records are already replaced; the next load rebuilds a missing index.
+            std::cerr << "Failed to install index " << indexPath_ << " after compaction\n";
+        }
+
+        unmap();
+        map();
+        liveOffsets_ = std::move(newOffsets);
+        deadCount_ = 0;
+        failure_.clear();
+        openForAppend();
+    }
+
+    // Maps the record file read-only; an empty or missing file leaves no mapping.
+    void LogFile::map() {
+        int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* addr = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (addr != MAP_FAILED) {
+                map_ = static_cast<const char*>(addr);
+                mapSize_ = static_cast<std::size_t>(info.st_size);
+            } else {
+                std::cerr << "Failed to map log file " << path_ << "\n";
+            }
+        }
+        ::close(fd);
+    }
+
+    // Releases the mapping and the in-memory tail.
+    void LogFile::unmap() {
+        if (map_) {
+            ::munmap(const_cast<char*>(map_), mapSize_);
+        }
+        map_ = nullptr;
+        mapSize_ = 0;
+        tail_.clear();
+    }
+
+    // Opens the record, index and tombstone files for appending.
+    void LogFile::openForAppend() {
+        recordsFd_ = ::open(path_.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+        indexFd_ = ::open(indexPath_.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+        tombstonesFd_ = ::open(tombstonePath_.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+        if (recordsFd_ < 0 || indexFd_ < 0 || tombstonesFd_ < 0) {
+            failure_ = std::error_code(errno, std::generic_category());
+            std::cerr << "Failed to open log file " << path_ << ": " << failure_.message() << "\n";
+        }
+    }
+
+    // Waits until the writer is done with the descriptors, then closes them.
+    void LogFile::close() {
+        if (recordsFd_ < 0 && indexFd_ < 0 && tombstonesFd_ < 0) {
+            return;
+        }
+        writer_.drain();
+        failed();
+        for (int* fd : {&recordsFd_, &indexFd_, &tombstonesFd_}) {
+            if (*fd >= 0) {
+                writer_.release(*fd);
+                ::close(*fd);
+                *fd = -1;
+            }
+        }
+    }
+
+    // Folds the in-memory tail into the mapping once it grows large,
+    // so a long-running session does not keep every appended record in memory.
+    // After a failed write the tail holds records the file lacks, so it is kept.
+    void LogFile::remapIfTailLarge() {
+        if (tail_.size() < MAX_TAIL_BYTES) {
+            return;
+        }
+        writer_.drain();
+        if (failed()) {
+            return;
+        }
+        unmap();
+        map();
+    }
+
+    // Latches the first write error the writer reports for any of the files.
+    bool LogFile::failed() {
+        if (!failure_) {
+            for (int fd : {recordsFd_, indexFd_, tombstonesFd_}) {
+                if (auto error = writer_.failure(fd)) {
+                    failure_ = error;
+                    break;
+                }
+            }
+        }
+        return static_cast<bool>(failure_);
+    }
+
+}  // namespace logging
@@ -1,8 +1,12 @@
 #include "log/LogManager.h"
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <system_error>
 
 namespace logging {
 
@@ -12,92 +16,192 @@ namespace logging {
         return instance;
     }
 
-    // Constructs LogManager and loads existing messages from log files.
-    // Ignores parsing errors to ensure startup robustness.
+    // Constructs LogManager and maps existing log files.
+    // Messages are decoded lazily on access, so startup cost does not depend on history size.
     LogManager::LogManager() {
         ensureLogFolderExists();
-        // Load sent messages.
-        std::ifstream sentFile(sentLogFile_);
-        std::string line;
-        while (std::getline(sentFile, line)) {
-            try {
-                sentMessages_.emplace_back(message::Message::decode(line));
-            } catch (...) {
-                // Ignore errors to handle malformed log entries.
+        sentLog_.load();
+        receivedLog_.load();
+        importLegacyText("logs/messages_sent.log", sentLog_);
+        importLegacyText("logs/messages_received.log", receivedLog_);
+    }
+
+    // Pending records are flushed as the logs and then the writer are destroyed.
+    LogManager::~LogManager() = default;
+
+    // Appends a message to the appropriate log (sent or received).
+    // Writes only the new record, so the cost does not grow with history size.
+    // The disk write happens on the writer thread; the caller only waits in PER_MESSAGE mode.
+    bool LogManager::appendMessage(const message::Message& msg) {
+        auto started = std::chrono::steady_clock::now();
+        std::string record = msg.encode();
+        std::future<void> durable;
+        try {
+            {
+                std::lock_guard<std::mutex> lock(fileMutex_);
+                durable = append(record, msg.getType() == message::MessageType::SENT);
+            }
+            // Wait outside the lock so concurrent appends share the same fsync.
+            if (durable.valid()) {
+                durable.get();
             }
+        } catch (const std::system_error&) {
+            // The writer has reported the error.
+            return false;
         }
-        // Load received messages.
-        std::ifstream recvFile(receivedLogFile_);
-        while (std::getline(recvFile, line)) {
+        appended_.add();
+        appendLatency_.observe(std::chrono::steady_clock::now() - started);
+        return true;
+    }
+
+    // Appends a batch of messages. The writer syncs each file's records in order, so waiting
+    // for the last record of each log covers the whole batch.
+    bool LogManager::appendMessages(const std::vector<message::Message>& msgs) {
+        auto started = std::chrono::steady_clock::now();
+        std::future<void> durable[2];
+        std::size_t stored = 0;
+        bool failed = false;
+        {
+            std::lock_guard<std::mutex> lock(fileMutex_);
+            for (const auto& msg : msgs) {
+                bool sent = msg.getType() == message::MessageType::SENT;
+                try {
+                    durable[sent] = append(msg.encode(), sent);
+                    ++stored;
+                } catch (const std::system_error&) {
+                    failed = true;
+                }
+            }
+        }
+        for (auto& future : durable) {
             try {
-                receivedMessages_.emplace_back(message::Message::decode(line));
-            } catch (...) {
-                // Ignore errors to handle malformed log entries.
+                if (future.valid()) {
+                    future.get();
+                }
+            } catch (const std::system_error&) {
+                failed = true;
             }
         }
+        appended_.add(stored);
+        appendLatency_.observe(std::chrono::steady_clock::now() - started);
+        return !failed;
     }
 
-    // Saves all messages to log files on destruction.
-    LogManager::~LogManager() {
-        saveSentToFile();
-        saveReceivedToFile();
+    // Sets the durability mode and group-commit thresholds of the log writer.
+    void LogManager::setWriterOptions(const LogWriter::Options& options) {
+        writer_.setOptions(options);
     }
 
-    // Appends a message to the appropriate log (sent or received) and saves to file.
-    // Saves both log files for simplicity, even if only one is modified.
-    void LogManager::appendMessage(const message::Message& msg) {
+    // Deletes a message at the specified index from either sent or received log.
+    // Records a tombstone; the file is compacted once deleted records dominate it.
+    void LogManager::deleteMessage(size_t index, bool sent) {
         std::lock_guard<std::mutex> lock(fileMutex_);
-        if (msg.getType() == message::MessageType::SENT) {
-            sentMessages_.push_back(msg);
-        } else {
-            receivedMessages_.push_back(msg);
+        if (index >= (sent ? sentLog_ : receivedLog_).size()) {
+            return;
         }
-        saveSentToFile();
-        saveReceivedToFile();
+        erase(index, sent);
     }
 
-    // Deletes a message at the specified index from either sent or received log.
-    // Updates the corresponding log file.
-    void LogManager::deleteMessage(size_t index, bool sent) {
+    // Returns the number of stored sent or received messages.
+    std::size_t LogManager::messageCount(bool sent) {
         std::lock_guard<std::mutex> lock(fileMutex_);
-        auto& vec = sent ? sentMessages_ : receivedMessages_;
-        if (index >= vec.size()) {
-            return;
+        return (sent ? sentLog_ : receivedLog_).size();
+    }
+
+    // Decodes the message at the specified index from either sent or received log.
+    // Throws std::out_of_range if the index is past the end.
+    message::Message LogManager::getMessage(size_t index, bool sent) {
+        std::lock_guard<std::mutex> lock(fileMutex_);
+        auto& file = sent ? sentLog_ : receivedLog_;
+        if (index >= file.size()) {
+            throw std::out_of_range("Message index out of range");
         }
-        vec.erase(vec.begin() + index);
-        if (sent) {
-            saveSentToFile();
-        } else {
-            saveReceivedToFile();
+        return decodeRecord(file.record(index), sent);
+    }
+
+    // Only the requested page is turned into handles; the total comes from the index ranges.
+    MessagePage LogManager::queryMessages(const MessageQuery& query) {
+        std::lock_guard<std::mutex> lock(fileMutex_);
+        std::vector<MessageId> ids;
+        MessagePage page;
+        page.total = indexFor(query.sent).query(query, ids);
+        page.handles.reserve(ids.size());
+        for (MessageId id : ids) {
+            page.handles.push_back(MessageHandle{query.sent, id});
         }
+        return page;
     }
 
-    // Retrieves all messages (sent and received) as a single vector.
-    std::vector<message::Message> LogManager::readAll() {
+    // Decodes the message a handle refers to.
+    // Throws std::out_of_range if it was deleted.
+    message::Message LogManager::getMessage(const MessageHandle& handle) {
         std::lock_guard<std::mutex> lock(fileMutex_);
-        std::vector<message::Message> all = sentMessages_;
-        all.insert(all.end(), receivedMessages_.begin(), receivedMessages_.end());
-        return all;
+        auto position = indexFor(handle.sent).position(handle.id);
+        if (!position) {
+            throw std::out_of_range("Message was deleted");
+        }
+        return decodeRecord((handle.sent ? sentLog_ : receivedLog_).record(*position), handle.sent);
+    }
+
+    // Deletes the message a handle refers to. Returns false if it was already deleted.
+    bool LogManager::deleteMessage(const MessageHandle& handle) {
+        std::lock_guard<std::mutex> lock(fileMutex_);
+        auto position = indexFor(handle.sent).position(handle.id);
+        if (!position) {
+            return false;
+        }
+        erase(*position, handle.sent);
+        return true;
+    }
+
+    // Both logs are searched and their results merged by score. Scores of the two logs come
+    // from separate statistics, which is close enough for ranking.
+    SearchResults LogManager::searchMessages(const std::string& text, std::size_t limit) {
+        std::lock_guard<std::mutex> lock(fileMutex_);
+        SearchResults results;
+        for (bool sent : {true, false}) {
+            auto& file = sent ? sentLog_ : receivedLog_;
+            std::vector<SearchMatch> matches;
+            results.total += searchFor(sent).search(text, limit, file, matches);
+            for (const auto& match : matches) {
+                if (auto position = file.position(match.offset)) {
+                    results.hits.push_back(SearchHit{MessageHandle{sent, indexFor(sent).id(*position)}, match.score});
+                }
+            }
+        }
+        std::stable_sort(results.hits.begin(), results.hits.end(),
+                         [](const SearchHit& a, const SearchHit& b) { return a.score > b.score; });
+        results.hits.resize(std::min(results.hits.size(), limit));
+        return results;
     }
 
-    // Returns a vector of strings representing sent messages.
-    std::vector<std::string> LogManager::getSentStrings() {
+    // Retrieves all messages (sent and received) as a single vector.
+    // Decodes the whole history; prefer messageCount() and getMessage() for large logs.
+    std::vector<message::Message> LogManager::readAll() {
         std::lock_guard<std::mutex> lock(fileMutex_);
-        std::vector<std::string> result;
-        for (auto& msg : sentMessages_) {
-            result.push_back(msg.toString());
+        std::vector<message::Message> all;
+        all.reserve(sentLog_.size() + receivedLog_.size());
+        for (std::size_t i = 0; i < sentLog_.size(); ++i) {
+            all.push_back(decodeRecord(sentLog_.record(i), true));
         }
-        return result;
+        for (std::size_t i = 0; i < receivedLog_.size(); ++i) {
+            all.push_back(decodeRecord(receivedLog_.record(i), false));
+        }
+        return all;
     }
 
-    // Returns a vector of strings representing received messages.
-    std::vector<std::string> LogManager::getReceivedStrings() {
+    // Writes sent or received messages to a file in the human-readable text format.
+    bool LogManager::exportText(bool sent, const std::string& path) {
         std::lock_guard<std::mutex> lock(fileMutex_);
-        std::vector<std::string> result;
-        for (auto& msg : receivedMessages_) {
-            result.push_back(msg.toString());
+        std::ofstream file(path, std::ios::trunc);
+        if (!file) {
+            return false;
         }
-        return result;
+        auto& log = sent ? sentLog_ : receivedLog_;
+        for (std::size_t i = 0; i < log.size(); ++i) {
+            file << decodeRecord(log.record(i), sent).encodeText() << "\n";
+        }
+        return static_cast<bool>(file);
     }
 
     // Ensures the log directory exists before file operations.
@@ -105,19 +209,73 @@ namespace logging {
         std::filesystem::create_directories("logs");
     }
 
-    // Saves sent messages to the log file, overwriting existing content.
-    void LogManager::saveSentToFile() {
-        std::ofstream file(sentLogFile_, std::ios::trunc);
-        for (auto& msg : sentMessages_) {
-            file << msg.encode() << "\n";
+    // Converts a text log from earlier versions into the binary log once.
+    // The text file is kept, renamed with an ".imported" suffix.
+    void LogManager::importLegacyText(const std::string& path, LogFile& file) {
+        if (!std::filesystem::exists(path)) {
+            return;
+        }
+        std::ifstream legacy(path);
+        std::string line;
+        while (std::getline(legacy, line)) {
+            try {
+                file.append(message::Message::decodeText(line).encode());
+            } catch (...) {
+                // Ignore errors to handle malformed log entries.
+            }
+        }
+        legacy.close();
+        std::error_code ec;
+        std::filesystem::rename(path, path + ".imported", ec);
+    }
+
+    // Returns the index of the sent or received log, building it first if needed.
+    MessageIndex& LogManager::indexFor(bool sent) {
+        auto& index = sent ? sentIndex_ : receivedIndex_;
+        if (!index.built()) {
+            index.build(sent ? sentLog_ : receivedLog_);
+        }
+        return index;
+    }
+
+    // Returns the full-text index of the sent or received log, opening it first if needed.
+    SearchIndex& LogManager::searchFor(bool sent) {
+        auto& search = sent ? sentSearch_ : receivedSearch_;
+        if (!search.isOpen()) {
+            search.open(sent ? sentLog_ : receivedLog_);
+        }
+        return search;
+    }
+
+    // Appends a record to the log and, once built or opened, its indexes.
+    std::future<void> LogManager::append(const std::string& record, bool sent) {
+        auto& file = sent ? sentLog_ : receivedLog_;
+        auto durable = file.append(record);
+        (sent ? sentIndex_ : receivedIndex_).add(record);
+        (sent ? sentSearch_ : receivedSearch_).add(file.offset(file.size() - 1), record);
+        return durable;
+    }
+
+    // Compaction keeps the live records in order, so the message index needs no rebuild. It
+    // moves records, though, so the search index is dropped and checked again on its next use.
+    void LogManager::erase(std::size_t position, bool sent) {
+        auto& file = sent ? sentLog_ : receivedLog_;
+        (sent ? sentIndex_ : receivedIndex_).remove(position, file.record(position));
+        file.erase(position);
+        if (file.needsCompaction()) {
+            (sent ? sentSearch_ : receivedSearch_).discard();
+            file.compact();
         }
     }
 
-    // Saves received messages to the log file, overwriting existing content.
-    void LogManager::saveReceivedToFile() {
-        std::ofstream file(receivedLogFile_, std::ios::trunc);
-        for (auto& msg : receivedMessages_) {
-            file << msg.encode() << "\n";
+    // Decodes a stored record.
+    // A corrupt record yields a placeholder instead of hiding the rest of the log.
+    message::Message LogManager::decodeRecord(std::string_view record, bool sent) {
+        try {
+            return message::Message::decode(record);
+        } catch (...) {
+            return message::Message("unknown", "(corrupt record)", "",
+                                    sent ? message::MessageType::SENT : message::MessageType::RECEIVED);
         }
     }
 
@@ -129,4 +287,4 @@ namespace logging {
         }
     }
 
-}  // namespace logging
\ No newline at end of file
+}  // namespace logging
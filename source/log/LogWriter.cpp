@@ -0,0 +1,243 @@
+#include "log/LogWriter.h"
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace logging {
+
+    namespace {
+
+        // Upper bound on bytes gathered before they are written out.
+        constexpr std::size_t MAX_BATCH_BYTES = 4 * 1024 * 1024;
+
+        // Writes all bytes to fd, retrying on partial writes and interrupts. On error, cuts off
+        // the part already written, so the file does not end in a torn record, and returns it.
+        std::error_code writeAll(int fd, const std::string& bytes) {
+            const char* data = bytes.data();
+            std::size_t left = bytes.size();
+            while (left > 0) {
+                ssize_t written = ::write(fd, data, left);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    std::error_code error(errno, std::generic_category());
+                    std::size_t done = bytes.size() - left;
+                    struct stat info;
+                    if (done > 0 && ::fstat(fd, &info) == 0) {
+                        ::ftruncate(fd, info.st_size - static_cast<off_t>(done));
+                    }
+                    return error;
+                }
+                data += written;
+                left -= static_cast<std::size_t>(written);
+            }
+            return {};
+        }
+
+    }  // namespace
+
+    // Starts the writer thread.
+    LogWriter::LogWriter()
+        : writtenBytes_(metrics::Registry::instance().counter("p2p_log_written_bytes_total",
+                                                              "Bytes written to the message logs")),
+          fsyncLatency_(metrics::Registry::instance().histogram("p2p_log_fsync_seconds",
+                                                                "Time taken by each fdatasync of a message log")),
+          thread_([this]() { run(); }) {}
+
+    // Writes out everything still queued, syncs and stops the writer thread.
+    LogWriter::~LogWriter() {
+        running_ = false;
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            wakeCondition_.notify_one();
+        }
+        thread_.join();
+    }
+
+    // Replaces the flushing and durability options.
+    void LogWriter::setOptions(const Options& options) {
+        flushIntervalMs_ = options.flushInterval.count();
+        flushBytes_ = options.flushBytes;
+        durability_ = options.durability;
+    }
+
+    // Returns the current durability mode.
+    Durability LogWriter::durability() const {
+        return durability_;
+    }
+
+    // Queues bytes for fd. In PER_MESSAGE mode, returns a future for the group commit
+    // that covers them, so callers can wait without holding their own locks.
+    std::future<void> LogWriter::submit(int fd, std::string bytes) {
+        Record record;
+        record.fd = fd;
+        record.bytes = std::move(bytes);
+        std::future<void> done;
+        if (durability_ == Durability::PER_MESSAGE) {
+            record.done = std::make_shared<std::promise<void>>();
+            done = record.done->get_future();
+        }
+        enqueue(std::move(record));
+        return done;
+    }
+
+    // The flag spares the common case the lock.
+    std::error_code LogWriter::failure(int fd) const {
+        if (!anyFailure_.load(std::memory_order_acquire)) {
+            return {};
+        }
+        std::lock_guard<std::mutex> lock(failuresMutex_);
+        auto it = failures_.find(fd);
+        return it != failures_.end() ? it->second : std::error_code();
+    }
+
+    // Forgets the failure of a descriptor about to be closed, as its number will be reused.
+    void LogWriter::release(int fd) {
+        std::lock_guard<std::mutex> lock(failuresMutex_);
+        failures_.erase(fd);
+        anyFailure_.store(!failures_.empty(), std::memory_order_release);
+    }
+
+    // Records the first error of fd; later bytes for it are dropped until release().
+    void LogWriter::fail(int fd, std::error_code error) {
+        std::lock_guard<std::mutex> lock(failuresMutex_);
+        if (failures_.emplace(fd, error).second) {
+            std::cerr << "Log write failed: " << error.message() << "\n";
+        }
+        anyFailure_.store(true, std::memory_order_release);
+    }
+
+    // Queues a marker and waits until the writer has passed it.
+    void LogWriter::drain() {
+        Record marker;
+        marker.done = std::make_shared<std::promise<void>>();
+        auto done = marker.done->get_future();
+        enqueue(std::move(marker));
+        done.wait();
+    }
+
+    // Pushes a record and wakes the writer if it is parked.
+    void LogWriter::enqueue(Record record) {
+        queue_.push(std::move(record));
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_) {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            wakeCondition_.notify_one();
+        }
+    }
+
+    // Writer loop: gather queued records per file, write each file's bytes in one call,
+    // then fsync according to the durability mode and release any waiting producers.
+    // A failed write or fsync stops all writes to that file, so nothing lands past a record
+    // that is missing; producers waiting on it get the error instead.
+    void LogWriter::run() {
+        std::vector<std::pair<int, std::string>> pending;
+        std::vector<std::pair<int, std::shared_ptr<std::promise<void>>>> waiters;
+        std::vector<int> dirty;
+        std::size_t unsyncedBytes = 0;
+        auto lastSync = std::chrono::steady_clock::now();
+
+        auto syncDirty = [&]() {
+            for (int fd : dirty) {
+                auto started = std::chrono::steady_clock::now();
+                if (::fdatasync(fd) != 0) {
+                    fail(fd, std::error_code(errno, std::generic_category()));
+                }
+                fsyncLatency_.observe(std::chrono::steady_clock::now() - started);
+            }
+            dirty.clear();
+            unsyncedBytes = 0;
+            lastSync = std::chrono::steady_clock::now();
+        };
+
+        while (true) {
+            // Gather everything that has accumulated, up to the batch limit.
+            bool gotAny = false;
+            std::size_t batchBytes = 0;
+            Record record;
+            while (batchBytes < MAX_BATCH_BYTES && queue_.pop(record)) {
+                gotAny = true;
+                if (record.fd >= 0) {
+                    batchBytes += record.bytes.size();
+                    auto it = std::find_if(pending.begin(), pending.end(),
+                                           [&](const auto& entry) { return entry.first == record.fd; });
+                    if (it == pending.end()) {
+                        pending.emplace_back(record.fd, std::move(record.bytes));
+                    } else {
+                        it->second += record.bytes;
+                    }
+                }
+                if (record.done) {
+                    waiters.emplace_back(record.fd, std::move(record.done));
+                }
+            }
+
+            // One sequential write per file.
+            for (auto& [fd, bytes] : pending) {
+                if (failure(fd)) {
+                    continue;
+                }
+                if (auto error = writeAll(fd, bytes)) {
+                    fail(fd, error);
+                    continue;
+                }
+                writtenBytes_.add(bytes.size());
+                unsyncedBytes += bytes.size();
+                if (std::find(dirty.begin(), dirty.end(), fd) == dirty.end()) {
+                    dirty.push_back(fd);
+                }
+            }
+            pending.clear();
+
+            // Group the fsync: one per file for every record gathered since the last one.
+            Durability mode = durability_;
+            auto interval = std::chrono::milliseconds(flushIntervalMs_.load());
+            if (!waiters.empty()) {
+                // Waiters need their records durable, or at least off descriptors about to close.
+                if (mode == Durability::NONE) {
+                    dirty.clear();
+                    unsyncedBytes = 0;
+                } else {
+                    syncDirty();
+                }
+                for (auto& [fd, waiter] : waiters) {
+                    if (auto error = failure(fd)) {
+                        waiter->set_exception(std::make_exception_ptr(std::system_error(error, "Log write failed")));
+                    } else {
+                        waiter->set_value();
+                    }
+                }
+                waiters.clear();
+            } else if (mode == Durability::BATCHED && !dirty.empty() &&
+                       (unsyncedBytes >= flushBytes_ || std::chrono::steady_clock::now() - lastSync >= interval)) {
+                syncDirty();
+            }
+
+            if (gotAny) {
+                continue;
+            }
+            if (!running_) {
+                break;
+            }
+
+            // Park until a producer wakes us or the flush interval elapses.
+            sleeping_ = true;
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex_);
+                wakeCondition_.wait_for(lock, interval, [this]() { return !queue_.empty() || !running_; });
+            }
+            sleeping_ = false;
+        }
+
+        if (durability_ != Durability::NONE) {
+            syncDirty();
+        }
+    }
+
+}  // namespace logging
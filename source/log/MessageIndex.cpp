@@ -0,0 +1,183 @@
+#include "log/MessageIndex.h"
+#include "message/Message.h"
+#include <algorithm>
+
+namespace logging {
+
+    // Returns true once build() has run.
+    bool MessageIndex::built() const {
+        return built_;
+    }
+
+    // Records are read in place from the mapping; only the keys are copied.
+    void MessageIndex::build(const LogFile& file) {
+        ids_.clear();
+        byTime_.clear();
+        byPeer_.clear();
+        byTopic_.clear();
+        ids_.reserve(file.size());
+        byTime_.reserve(file.size());
+        for (std::size_t i = 0; i < file.size(); ++i) {
+            ids_.push_back(i);
+            insert(decodeFields(file.record(i)), i);
+        }
+        nextId_ = file.size();
+        built_ = true;
+    }
+
+    // Indexes a record just appended to the end of the log.
+    void MessageIndex::add(std::string_view record) {
+        if (!built_) {
+            return;
+        }
+        MessageId id = nextId_++;
+        ids_.push_back(id);
+        insert(decodeFields(record), id);
+    }
+
+    // Unindexes the live record at position; a peer or topic left without records is dropped.
+    void MessageIndex::remove(std::size_t position, std::string_view record) {
+        if (!built_ || position >= ids_.size()) {
+            return;
+        }
+        Fields fields = decodeFields(record);
+        Key key{fields.timestampNs, ids_[position]};
+        ids_.erase(ids_.begin() + position);
+        eraseSorted(byTime_, key);
+        auto peer = byPeer_.find(fields.peer);
+        if (peer != byPeer_.end()) {
+            eraseSorted(peer->second, key);
+            if (peer->second.empty()) {
+                byPeer_.erase(peer);
+            }
+        }
+        auto topic = byTopic_.find(fields.topic);
+        if (topic != byTopic_.end()) {
+            eraseSorted(topic->second, key);
+            if (topic->second.empty()) {
+                byTopic_.erase(topic);
+            }
+        }
+    }
+
+    // IDs ascend in log order, so the position is found by binary search.
+    std::optional<std::size_t> MessageIndex::position(MessageId id) const {
+        auto it = std::lower_bound(ids_.begin(), ids_.end(), id);
+        if (it == ids_.end() || *it != id) {
+            return std::nullopt;
+        }
+        return static_cast<std::size_t>(it - ids_.begin());
+    }
+
+    // Returns the ID of the live message at position.
+    MessageId MessageIndex::id(std::size_t position) const {
+        return ids_.at(position);
+    }
+
+    // A single filter is a range of one list, so its total and page cost two binary searches.
+    // With both peer and topic, the shorter range is walked and each key looked up in the other.
+    std::size_t MessageIndex::query(const MessageQuery& query, std::vector<MessageId>& out) const {
+        static const std::vector<Key> none;
+        const std::vector<Key>* peerList = nullptr;
+        const std::vector<Key>* topicList = nullptr;
+        if (query.peer) {
+            auto it = byPeer_.find(*query.peer);
+            peerList = it != byPeer_.end() ? &it->second : &none;
+        }
+        if (query.topic) {
+            auto it = byTopic_.find(*query.topic);
+            topicList = it != byTopic_.end() ? &it->second : &none;
+        }
+
+        if (!peerList || !topicList) {
+            const std::vector<Key>& list = peerList ? *peerList : topicList ? *topicList : byTime_;
+            auto [begin, end] = range(list, query);
+            auto total = static_cast<std::size_t>(end - begin);
+            if (query.offset < total) {
+                auto first = begin + static_cast<std::ptrdiff_t>(query.offset);
+                auto count = std::min(query.limit, total - query.offset);
+                for (auto it = first; it != first + static_cast<std::ptrdiff_t>(count); ++it) {
+                    out.push_back(it->second);
+                }
+            }
+            return total;
+        }
+
+        auto peerRange = range(*peerList, query);
+        auto topicRange = range(*topicList, query);
+        if (peerRange.second - peerRange.first > topicRange.second - topicRange.first) {
+            std::swap(peerRange, topicRange);
+        }
+        std::size_t total = 0;
+        for (auto it = peerRange.first; it != peerRange.second; ++it) {
+            if (!std::binary_search(topicRange.first, topicRange.second, *it)) {
+                continue;
+            }
+            if (total >= query.offset && total - query.offset < query.limit) {
+                out.push_back(it->second);
+            }
+            ++total;
+        }
+        return total;
+    }
+
+    // Decodes the indexed fields of a record without copying its strings.
+    MessageIndex::Fields MessageIndex::decodeFields(std::string_view record) {
+        Fields fields;
+        try {
+            message::MessageView view;
+            message::Message::decodeView(record, view);
+            fields.peer = view.peerID;
+            fields.topic = view.topic;
+            fields.timestampNs = view.timestampNs;
+        } catch (...) {
+            // Indexed as empty, as LogManager lists it as a placeholder.
+        }
+        return fields;
+    }
+
+    // Adds id to every list its fields belong to.
+    void MessageIndex::insert(const Fields& fields, MessageId id) {
+        Key key{fields.timestampNs, id};
+        insertSorted(byTime_, key);
+        auto peer = byPeer_.find(fields.peer);
+        if (peer == byPeer_.end()) {
+            peer = byPeer_.emplace(std::string(fields.peer), std::vector<Key>()).first;
+        }
+        insertSorted(peer->second, key);
+        auto topic = byTopic_.find(fields.topic);
+        if (topic == byTopic_.end()) {
+            topic = byTopic_.emplace(std::string(fields.topic), std::vector<Key>()).first;
+        }
+        insertSorted(topic->second, key);
+    }
+
+    // Checks the end first, where an in-order key belongs.
+    void MessageIndex::insertSorted(std::vector<Key>& list, const Key& key) {
+        if (list.empty() || !(key < list.back())) {
+            list.push_back(key);
+            return;
+        }
+        list.insert(std::upper_bound(list.begin(), list.end(), key), key);
+    }
+
+    // Removes key from a sorted list.
+    void MessageIndex::eraseSorted(std::vector<Key>& list, const Key& key) {
+        auto it = std::lower_bound(list.begin(), list.end(), key);
+        if (it != list.end() && *it == key) {
+            list.erase(it);
+        }
+    }
+
+    // Keys at fromNs start at (fromNs, 0); keys before toNs end before (toNs, 0).
+    std::pair<std::vector<MessageIndex::Key>::const_iterator, std::vector<MessageIndex::Key>::const_iterator>
+    MessageIndex::range(const std::vector<Key>& list, const MessageQuery& query) {
+        if (query.fromNs >= query.toNs) {
+            return {list.end(), list.end()};
+        }
+        auto begin = std::lower_bound(list.begin(), list.end(), Key{query.fromNs, 0});
+        auto end = std::lower_bound(begin, list.end(), Key{query.toNs, 0});
+        return {begin, end};
+    }
+
+}  // namespace logging
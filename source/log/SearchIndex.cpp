@@ -0,0 +1,674 @@
+#include "log/SearchIndex.h"
+#include "message/Codec.h"
+#include "message/Message.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace logging {
+
+    namespace {
+
+        // Identifies a segment file and its format version.
+        constexpr char SEGMENT_MAGIC[8] = {'P', '2', 'P', 'F', 'T', 'S', '0', '1'};
+
+        // Magic followed by eight 64-bit header fields.
+        constexpr std::size_t HEADER_SIZE = 72;
+
+        // Dictionary entry: term, postings and last posting offsets, postings size, document
+        // frequency, term length and padding.
+        constexpr std::size_t ENTRY_SIZE = 40;
+
+        // Longer terms are not indexed; they are rarely searched for and mostly noise.
+        constexpr std::size_t MAX_TERM_LENGTH = 64;
+
+        // Buffered postings beyond which they are written out as a segment.
+        constexpr std::size_t MAX_BUFFER_BYTES = 32 * 1024 * 1024;
+
+        // Segments are not merged into one larger than this, which bounds the pause a merge causes.
+        constexpr std::size_t MAX_MERGE_BYTES = 256 * 1024 * 1024;
+
+        // BM25 term frequency saturation and length normalization.
+        constexpr double BM25_K1 = 1.2;
+        constexpr double BM25_B = 0.75;
+
+        // Reads a little-endian integer at data.
+        std::uint64_t loadFixed(const char* data, std::size_t bytes) {
+            std::uint64_t value = 0;
+            for (std::size_t i = 0; i < bytes; ++i) {
+                value |= static_cast<std::uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+            }
+            return value;
+        }
+
+        // Appends a little-endian 32-bit integer.
+        void putFixed32(std::string& out, std::uint32_t value) {
+            for (int i = 0; i < 4; ++i) {
+                out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+            }
+        }
+
+        // FNV-1a hash of a record, identifying it when segments are reopened.
+        std::uint64_t fingerprint(std::string_view record) {
+            std::uint64_t hash = 14695981039346656037ull;
+            for (char c : record) {
+                hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+            }
+            return hash;
+        }
+
+        // Calls emit with each lowercase term of text. ASCII letters and digits form terms with
+        // any non-ASCII bytes next to them; every other ASCII character separates terms.
+        template <typename Emit>
+        void tokenize(std::string_view text, std::string& term, Emit&& emit) {
+            term.clear();
+            for (char c : text) {
+                auto byte = static_cast<unsigned char>(c);
+                if (std::isalnum(byte) && byte < 0x80) {
+                    term.push_back(static_cast<char>(std::tolower(byte)));
+                    continue;
+                }
+                if (byte >= 0x80) {
+                    term.push_back(c);
+                    continue;
+                }
+                if (!term.empty() && term.size() <= MAX_TERM_LENGTH) {
+                    emit(term);
+                }
+                term.clear();
+            }
+            if (!term.empty() && term.size() <= MAX_TERM_LENGTH) {
+                emit(term);
+            }
+        }
+
+        // Header fields a segment is written with; the builder fills in the dictionary's.
+        struct Coverage {
+            std::uint64_t start;
+            std::uint64_t end;
+            std::uint64_t lastOffset;
+            std::uint64_t fingerprint;
+            std::uint64_t documents;
+            std::uint64_t totalLength;
+        };
+
+        // Lays out a segment: header, postings lists, term bytes and the dictionary.
+        class SegmentBuilder {
+        public:
+            SegmentBuilder() : bytes_(HEADER_SIZE, '\0') {}
+
+            // Adds a term and its encoded postings. Terms must be added in ascending order.
+            void addTerm(std::string_view term, std::string_view postings, std::uint32_t documents,
+                         std::uint64_t lastPosting) {
+                entries_.push_back(Entry{std::string(term), bytes_.size(), lastPosting,
+                                         static_cast<std::uint32_t>(postings.size()), documents});
+                bytes_.append(postings.data(), postings.size());
+            }
+
+            // Returns the bytes of the finished segment.
+            std::string finish(const Coverage& coverage) {
+                std::vector<std::uint64_t> termOffsets;
+                termOffsets.reserve(entries_.size());
+                for (const auto& entry : entries_) {
+                    termOffsets.push_back(bytes_.size());
+                    bytes_ += entry.term;
+                }
+                std::uint64_t dictionaryOffset = bytes_.size();
+                for (std::size_t i = 0; i < entries_.size(); ++i) {
+                    message::putFixed64(bytes_, termOffsets[i]);
+                    message::putFixed64(bytes_, entries_[i].postingsOffset);
+                    message::putFixed64(bytes_, entries_[i].lastPosting);
+                    putFixed32(bytes_, entries_[i].postingsBytes);
+                    putFixed32(bytes_, entries_[i].documents);
+                    putFixed32(bytes_, static_cast<std::uint32_t>(entries_[i].term.size()));
+                    putFixed32(bytes_, 0);
+                }
+                std::string header(SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+                for (std::uint64_t field : {coverage.start, coverage.end, coverage.lastOffset, coverage.fingerprint,
+                                            coverage.documents, coverage.totalLength,
+                                            static_cast<std::uint64_t>(entries_.size()), dictionaryOffset}) {
+                    message::putFixed64(header, field);
+                }
+                bytes_.replace(0, HEADER_SIZE, header);
+                return std::move(bytes_);
+            }
+
+        private:
+            struct Entry {
+                std::string term;
+                std::uint64_t postingsOffset;
+                std::uint64_t lastPosting;
+                std::uint32_t postingsBytes;
+                std::uint32_t documents;
+            };
+
+            std::string bytes_;
+            std::vector<Entry> entries_;
+        };
+
+    }  // namespace
+
+    // Walks the postings of one term across the segments, in offset order, then the buffer.
+    class SearchIndex::Cursor {
+    public:
+        // Inverse document frequency of the term.
+        double idf = 0;
+
+        // Adds the encoded postings of the term in the next segment.
+        void addEncoded(std::string_view postings) {
+            parts_.push_back(postings);
+        }
+
+        // Sets the buffered postings of the term, which follow every segment.
+        void setBuffered(const std::vector<Posting>* postings) {
+            buffered_ = postings;
+        }
+
+        // Moves to the next posting. Returns false once there are none left.
+        // A corrupt list is cut short rather than failing the search.
+        bool next() {
+            while (true) {
+                if (reader_ && reader_->remaining() > 0) {
+                    try {
+                        previous_ += reader_->readVarint();
+                        current_.offset = previous_;
+                        current_.frequency = static_cast<std::uint32_t>(reader_->readVarint());
+                        current_.length = static_cast<std::uint32_t>(reader_->readVarint());
+                        return true;
+                    } catch (const std::runtime_error&) {
+                        reader_.reset();
+                    }
+                    continue;
+                }
+                if (part_ < parts_.size()) {
+                    reader_.emplace(parts_[part_++]);
+                    previous_ = 0;
+                    continue;
+                }
+                if (buffered_ && bufferedIndex_ < buffered_->size()) {
+                    current_ = (*buffered_)[bufferedIndex_++];
+                    return true;
+                }
+                return false;
+            }
+        }
+
+        // Returns the posting next() moved to.
+        const Posting& current() const {
+            return current_;
+        }
+
+    private:
+        std::vector<std::string_view> parts_;
+        std::size_t part_ = 0;
+        std::optional<message::ByteReader> reader_;
+        std::uint64_t previous_ = 0;
+        const std::vector<Posting>* buffered_ = nullptr;
+        std::size_t bufferedIndex_ = 0;
+        Posting current_{};
+    };
+
+    // Constructs a closed index for the log at logPath.
+    SearchIndex::SearchIndex(const std::string& logPath) : logPath_(logPath) {}
+
+    // Writes out buffered postings.
+    SearchIndex::~SearchIndex() {
+        close();
+    }
+
+    // Returns true between open() and close() or discard().
+    bool SearchIndex::isOpen() const {
+        return open_;
+    }
+
+    // Segments are ordered by start, the larger first when two start together. One that lies
+    // within the coverage so far is left over from an interrupted merge and deleted. The first
+    // one that leaves a gap or ends at a record that has changed is deleted with all after it,
+    // and the records past the last kept segment are indexed into the buffer.
+    void SearchIndex::open(const LogFile& file) {
+        if (open_) {
+            return;
+        }
+        namespace fs = std::filesystem;
+        fs::path log(logPath_);
+        fs::path directory = log.parent_path().empty() ? fs::path(".") : log.parent_path();
+        std::string prefix = log.filename().string() + ".fts.";
+        std::vector<std::unique_ptr<Segment>> candidates;
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(directory, ec)) {
+            std::string name = entry.path().filename().string();
+            if (name.compare(0, prefix.size(), prefix) != 0) {
+                continue;
+            }
+            std::string suffix = name.substr(prefix.size());
+            bool numbered = !suffix.empty() && std::all_of(suffix.begin(), suffix.end(), [](char c) {
+                return std::isdigit(static_cast<unsigned char>(c));
+            });
+            if (!numbered) {
+                fs::remove(entry.path(), ec);
+                continue;
+            }
+            std::uint64_t sequence = std::stoull(suffix);
+            nextSequence_ = std::max(nextSequence_, sequence + 1);
+            if (auto segment = load(entry.path().string(), sequence)) {
+                candidates.push_back(std::move(segment));
+            } else {
+                fs::remove(entry.path(), ec);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+            return a->start != b->start ? a->start < b->start : a->end > b->end;
+        });
+
+        std::uint64_t covered = 0;
+        bool valid = true;
+        for (auto& segment : candidates) {
+            if (valid && !segments_.empty() && segment->end <= covered) {
+                fs::remove(segment->path, ec);
+                continue;
+            }
+            auto last = file.recordAt(segment->lastOffset);
+            if (valid && (segment->start != covered || !last || fingerprint(*last) != segment->fingerprint)) {
+                valid = false;
+            }
+            if (!valid) {
+                fs::remove(segment->path, ec);
+                continue;
+            }
+            covered = segment->end;
+            segments_.push_back(std::move(segment));
+        }
+
+        open_ = true;
+        bufferStart_ = covered;
+        for (std::size_t i = file.positionAtOrAfter(covered); i < file.size(); ++i) {
+            add(file.offset(i), file.record(i));
+        }
+    }
+
+    // Writes out buffered postings and unmaps the segments.
+    void SearchIndex::close() {
+        if (!open_) {
+            return;
+        }
+        flush();
+        discard();
+    }
+
+    // Drops buffered postings and unmaps the segments.
+    void SearchIndex::discard() {
+        segments_.clear();
+        buffer_.clear();
+        bufferDocuments_ = 0;
+        bufferLength_ = 0;
+        bufferBytes_ = 0;
+        open_ = false;
+    }
+
+    // Each distinct term of the topic and content gets one posting with its count.
+    // A record that cannot be decoded is skipped.
+    void SearchIndex::add(std::uint64_t offset, std::string_view record) {
+        if (!open_) {
+            return;
+        }
+        message::MessageView view;
+        try {
+            message::Message::decodeView(record, view);
+        } catch (const std::runtime_error&) {
+            return;
+        }
+        std::vector<std::string> terms;
+        std::string scratch;
+        auto collect = [&terms](const std::string& term) { terms.push_back(term); };
+        tokenize(view.topic, scratch, collect);
+        tokenize(view.content, scratch, collect);
+        std::sort(terms.begin(), terms.end());
+        auto length = static_cast<std::uint32_t>(terms.size());
+        for (std::size_t i = 0; i < terms.size();) {
+            std::size_t j = i;
+            while (j < terms.size() && terms[j] == terms[i]) {
+                ++j;
+            }
+            auto& postings = buffer_[terms[i]];
+            if (postings.empty()) {
+                bufferBytes_ += terms[i].size() + 64;
+            }
+            postings.push_back(Posting{offset, static_cast<std::uint32_t>(j - i), length});
+            bufferBytes_ += sizeof(Posting);
+            i = j;
+        }
+        ++bufferDocuments_;
+        bufferLength_ += length;
+        bufferLastOffset_ = offset;
+        bufferLastRecord_.assign(record.data(), record.size());
+        if (bufferBytes_ >= MAX_BUFFER_BYTES) {
+            flush();
+        }
+    }
+
+    // Document-at-a-time: the cursors of all query terms advance together in offset order, so
+    // every matching record is scored once and only the best limit are kept, in a heap.
+    std::size_t SearchIndex::search(std::string_view text, std::size_t limit, const LogFile& file,
+                                    std::vector<SearchMatch>& out) const {
+        std::vector<std::string> terms;
+        std::string scratch;
+        tokenize(text, scratch, [&terms](const std::string& term) { terms.push_back(term); });
+        std::sort(terms.begin(), terms.end());
+        terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+
+        double documents = static_cast<double>(bufferDocuments_);
+        double totalLength = static_cast<double>(bufferLength_);
+        for (const auto& segment : segments_) {
+            documents += static_cast<double>(segment->documents);
+            totalLength += static_cast<double>(segment->totalLength);
+        }
+        if (documents == 0) {
+            return 0;
+        }
+        double averageLength = std::max(1.0, totalLength / documents);
+
+        std::vector<Cursor> cursors;
+        for (const auto& term : terms) {
+            Cursor cursor;
+            double frequency = 0;
+            for (const auto& segment : segments_) {
+                std::size_t entry = segment->find(term);
+                if (entry < segment->termCount) {
+                    cursor.addEncoded(segment->postings(entry));
+                    frequency += segment->documentFrequency(entry);
+                }
+            }
+            auto buffered = buffer_.find(term);
+            if (buffered != buffer_.end()) {
+                cursor.setBuffered(&buffered->second);
+                frequency += static_cast<double>(buffered->second.size());
+            }
+            if (frequency == 0 || !cursor.next()) {
+                continue;
+            }
+            cursor.idf = std::log(1 + (documents - frequency + 0.5) / (frequency + 0.5));
+            cursors.push_back(std::move(cursor));
+        }
+
+        // The heap's top is the worst match kept; ties favour newer records.
+        auto better = [](const SearchMatch& a, const SearchMatch& b) {
+            return a.score != b.score ? a.score > b.score : a.offset > b.offset;
+        };
+        std::priority_queue<SearchMatch, std::vector<SearchMatch>, decltype(better)> best(better);
+        std::size_t total = 0;
+        while (!cursors.empty()) {
+            std::uint64_t offset = cursors.front().current().offset;
+            for (const auto& cursor : cursors) {
+                offset = std::min(offset, cursor.current().offset);
+            }
+            double score = 0;
+            for (std::size_t i = 0; i < cursors.size();) {
+                const Posting& posting = cursors[i].current();
+                if (posting.offset != offset) {
+                    ++i;
+                    continue;
+                }
+                double frequency = posting.frequency;
+                double norm = BM25_K1 * (1 - BM25_B + BM25_B * posting.length / averageLength);
+                score += cursors[i].idf * frequency * (BM25_K1 + 1) / (frequency + norm);
+                if (cursors[i].next()) {
+                    ++i;
+                } else {
+                    cursors.erase(cursors.begin() + static_cast<std::ptrdiff_t>(i));
+                }
+            }
+            if (!file.position(offset)) {
+                continue;
+            }
+            ++total;
+            if (limit == 0) {
+                continue;
+            }
+            best.push(SearchMatch{offset, score});
+            if (best.size() > limit) {
+                best.pop();
+            }
+        }
+
+        std::size_t first = out.size();
+        for (; !best.empty(); best.pop()) {
+            out.push_back(best.top());
+        }
+        std::reverse(out.begin() + static_cast<std::ptrdiff_t>(first), out.end());
+        return total;
+    }
+
+    // Unmaps the segment file.
+    SearchIndex::Segment::~Segment() {
+        if (data) {
+            ::munmap(const_cast<char*>(data), size);
+        }
+    }
+
+    // Returns the term of dictionary entry i.
+    std::string_view SearchIndex::Segment::term(std::size_t i) const {
+        const char* entry = data + dictionaryOffset + i * ENTRY_SIZE;
+        return std::string_view(data + loadFixed(entry, 8), loadFixed(entry + 32, 4));
+    }
+
+    // Returns the encoded postings of dictionary entry i.
+    std::string_view SearchIndex::Segment::postings(std::size_t i) const {
+        const char* entry = data + dictionaryOffset + i * ENTRY_SIZE;
+        return std::string_view(data + loadFixed(entry + 8, 8), loadFixed(entry + 24, 4));
+    }
+
+    // Returns the number of records containing the term of dictionary entry i.
+    std::uint32_t SearchIndex::Segment::documentFrequency(std::size_t i) const {
+        return static_cast<std::uint32_t>(loadFixed(data + dictionaryOffset + i * ENTRY_SIZE + 28, 4));
+    }
+
+    // Returns the offset of the last posting of dictionary entry i.
+    std::uint64_t SearchIndex::Segment::lastPosting(std::size_t i) const {
+        return loadFixed(data + dictionaryOffset + i * ENTRY_SIZE + 16, 8);
+    }
+
+    // Binary search over the sorted dictionary.
+    std::size_t SearchIndex::Segment::find(std::string_view wanted) const {
+        std::size_t low = 0;
+        std::size_t high = termCount;
+        while (low < high) {
+            std::size_t middle = low + (high - low) / 2;
+            if (term(middle) < wanted) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low < termCount && term(low) == wanted ? low : termCount;
+    }
+
+    // Every dictionary entry is checked to lie within the file, so lookups need no bounds checks.
+    std::unique_ptr<SearchIndex::Segment> SearchIndex::load(const std::string& path, std::uint64_t sequence) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return nullptr;
+        }
+        auto segment = std::make_unique<Segment>();
+        segment->path = path;
+        segment->sequence = sequence;
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) >= HEADER_SIZE) {
+            void* addr = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (addr != MAP_FAILED) {
+                segment->data = static_cast<const char*>(addr);
+                segment->size = static_cast<std::size_t>(info.st_size);
+            }
+        }
+        ::close(fd);
+        if (!segment->data || std::memcmp(segment->data, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0) {
+            return nullptr;
+        }
+        const char* header = segment->data + sizeof(SEGMENT_MAGIC);
+        segment->start = loadFixed(header, 8);
+        segment->end = loadFixed(header + 8, 8);
+        segment->lastOffset = loadFixed(header + 16, 8);
+        segment->fingerprint = loadFixed(header + 24, 8);
+        segment->documents = loadFixed(header + 32, 8);
+        segment->totalLength = loadFixed(header + 40, 8);
+        segment->termCount = loadFixed(header + 48, 8);
+        segment->dictionaryOffset = loadFixed(header + 56, 8);
+        if (segment->lastOffset < segment->start || segment->lastOffset >= segment->end ||
+            segment->dictionaryOffset < HEADER_SIZE || segment->dictionaryOffset > segment->size ||
+            segment->termCount != (segment->size - segment->dictionaryOffset) / ENTRY_SIZE) {
+            return nullptr;
+        }
+        for (std::size_t i = 0; i < segment->termCount; ++i) {
+            const char* entry = segment->data + segment->dictionaryOffset + i * ENTRY_SIZE;
+            std::uint64_t termEnd = loadFixed(entry, 8) + loadFixed(entry + 32, 4);
+            std::uint64_t postingsEnd = loadFixed(entry + 8, 8) + loadFixed(entry + 24, 4);
+            if (termEnd > segment->dictionaryOffset || postingsEnd > segment->dictionaryOffset) {
+                return nullptr;
+            }
+        }
+        return segment;
+    }
+
+    // Terms are written in sorted order so segments can be searched and merged by term.
+    void SearchIndex::flush() {
+        if (bufferDocuments_ == 0) {
+            return;
+        }
+        std::vector<const std::pair<const std::string, std::vector<Posting>>*> terms;
+        terms.reserve(buffer_.size());
+        for (const auto& entry : buffer_) {
+            terms.push_back(&entry);
+        }
+        std::sort(terms.begin(), terms.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+        SegmentBuilder builder;
+        std::string encoded;
+        for (const auto* entry : terms) {
+            encoded.clear();
+            std::uint64_t previous = 0;
+            for (const auto& posting : entry->second) {
+                message::putVarint(encoded, posting.offset - previous);
+                message::putVarint(encoded, posting.frequency);
+                message::putVarint(encoded, posting.length);
+                previous = posting.offset;
+            }
+            builder.addTerm(entry->first, encoded, static_cast<std::uint32_t>(entry->second.size()), previous);
+        }
+        Coverage coverage{bufferStart_,
+                          bufferLastOffset_ + 1,
+                          bufferLastOffset_,
+                          fingerprint(bufferLastRecord_),
+                          bufferDocuments_,
+                          bufferLength_};
+        auto segment = writeSegment(builder.finish(coverage));
+        if (!segment) {
+            return;
+        }
+        segments_.push_back(std::move(segment));
+        bufferStart_ = coverage.end;
+        buffer_.clear();
+        bufferDocuments_ = 0;
+        bufferLength_ = 0;
+        bufferBytes_ = 0;
+
+        // The newest segment is merged while it is at least half the size of the one before,
+        // like carries in a binary counter, so a record is rewritten a logarithmic number of times.
+        while (segments_.size() >= 2) {
+            const Segment& last = *segments_.back();
+            const Segment& previous = *segments_[segments_.size() - 2];
+            if (last.size * 2 < previous.size || last.size + previous.size > MAX_MERGE_BYTES || !mergeLast()) {
+                break;
+            }
+        }
+    }
+
+    // Postings lists are copied as they are; where both segments have a term, the later list's
+    // first offset is re-encoded relative to the earlier list's last one.
+    bool SearchIndex::mergeLast() {
+        const Segment& first = *segments_[segments_.size() - 2];
+        const Segment& second = *segments_.back();
+        SegmentBuilder builder;
+        std::string merged;
+        std::size_t i = 0;
+        std::size_t j = 0;
+        while (i < first.termCount || j < second.termCount) {
+            int order = i == first.termCount    ? 1
+                        : j == second.termCount ? -1
+                                                : first.term(i).compare(second.term(j));
+            if (order < 0) {
+                builder.addTerm(first.term(i), first.postings(i), first.documentFrequency(i), first.lastPosting(i));
+                ++i;
+                continue;
+            }
+            if (order > 0) {
+                builder.addTerm(second.term(j), second.postings(j), second.documentFrequency(j),
+                                second.lastPosting(j));
+                ++j;
+                continue;
+            }
+            std::string_view later = second.postings(j);
+            message::ByteReader reader(later);
+            std::uint64_t firstOffset = 0;
+            try {
+                firstOffset = reader.readVarint();
+            } catch (const std::runtime_error&) {
+                return false;
+            }
+            merged.assign(first.postings(i).data(), first.postings(i).size());
+            message::putVarint(merged, firstOffset - first.lastPosting(i));
+            merged.append(later.substr(reader.position()).data(), later.size() - reader.position());
+            builder.addTerm(first.term(i), merged, first.documentFrequency(i) + second.documentFrequency(j),
+                            second.lastPosting(j));
+            ++i;
+            ++j;
+        }
+        Coverage coverage{first.start,
+                          second.end,
+                          second.lastOffset,
+                          second.fingerprint,
+                          first.documents + second.documents,
+                          first.totalLength + second.totalLength};
+        auto segment = writeSegment(builder.finish(coverage));
+        if (!segment) {
+            return false;
+        }
+        std::error_code ec;
+        std::filesystem::remove(first.path, ec);
+        std::filesystem::remove(second.path, ec);
+        segments_.pop_back();
+        segments_.back() = std::move(segment);
+        return true;
+    }
+
+    // Written under a temporary name and renamed, so a segment file is either complete or absent.
+    std::unique_ptr<SearchIndex::Segment> SearchIndex::writeSegment(const std::string& bytes) {
+        std::uint64_t sequence = nextSequence_++;
+        std::string path = logPath_ + ".fts." + std::to_string(sequence);
+        std::string tempPath = logPath_ + ".fts.tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            if (!file.flush()) {
+                std::cerr << "Failed to write search index " << path << "\n";
+                return nullptr;
+            }
+        }
+        std::error_code ec;
+        std::filesystem::rename(tempPath, path, ec);
+        auto segment = ec ? nullptr : load(path, sequence);
+        if (!segment) {
+            std::cerr << "Failed to write search index " << path << "\n";
+        }
+        return segment;
+    }
+
+}  // namespace logging
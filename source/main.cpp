@@ -1,34 +1,117 @@
+#include "control/ControlServer.h"
+#include "log/LogManager.h"
 #include "network/NetworkManager.h"
 #include "ui/UI.h"
 #include <iostream>
+#include <optional>
 #include <string>
+#include <vector>
 
 // Entry point for the P2P messaging application.
-// Starts the server, runs the UI, and shuts down cleanly.
+// Starts the server, runs the UI or the control socket, and shuts down cleanly.
 int main(int argc, char* argv[]) {
     using namespace network;
 
+    // Take out --daemon[=socket-path], which may appear anywhere; the rest are positional.
+    bool daemon = false;
+    std::string controlPath;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--daemon") {
+            daemon = true;
+        } else if (arg.rfind("--daemon=", 0) == 0) {
+            daemon = true;
+            controlPath = arg.substr(9);
+        } else {
+            args.push_back(arg);
+        }
+    }
+
     // Parse port from command-line arguments, default to 5555.
     // Relies on std::stoi exceptions for validation.
     unsigned short port = 5555;
-    if (argc > 1) {
+    if (args.size() > 0) {
         try {
-            port = static_cast<unsigned short>(std::stoi(argv[1]));
+            port = static_cast<unsigned short>(std::stoi(args[0]));
         } catch (...) {
             std::cerr << "Invalid port number. Using default 5555.\n";
         }
     }
 
-    // Initialize and start the server.
+    // Parse optional I/O thread count, defaulting to one per core.
     NetworkManager& net = NetworkManager::instance();
+    if (args.size() > 1) {
+        try {
+            net.setIoThreads(static_cast<std::size_t>(std::stoul(args[1])));
+        } catch (...) {
+            std::cerr << "Invalid thread count. Using one per core.\n";
+        }
+    }
+
+    // Parse optional log durability mode: none, batched (default) or message.
+    if (args.size() > 2) {
+        const std::string& mode = args[2];
+        logging::LogWriter::Options options;
+        if (mode == "none") {
+            options.durability = logging::Durability::NONE;
+        } else if (mode == "message") {
+            options.durability = logging::Durability::PER_MESSAGE;
+        } else if (mode != "batched") {
+            std::cerr << "Unknown durability mode. Using batched.\n";
+        }
+        logging::LogManager::instance().setWriterOptions(options);
+    }
+
+    // Parse optional overflow policy for peers that stop reading: disconnect (default),
+    // drop-oldest or drop-newest.
+    if (args.size() > 3) {
+        const std::string& policy = args[3];
+        SendLimits limits;
+        if (policy == "drop-oldest") {
+            limits.policy = OverflowPolicy::DROP_OLDEST;
+        } else if (policy == "drop-newest") {
+            limits.policy = OverflowPolicy::DROP_NEWEST;
+        } else if (policy != "disconnect") {
+            std::cerr << "Unknown overflow policy. Using disconnect.\n";
+        }
+        net.setSendLimits(limits);
+    }
+
+    // Headless: serve the control socket instead of the terminal until told to stop.
+    if (daemon) {
+        if (controlPath.empty()) {
+            controlPath = control::ControlServer::defaultPath(port);
+        }
+        // The server outlives the try block, so the receive workers calling its message
+        // handler are stopped by net.shutdown() before it is destroyed, even after an error.
+        std::optional<control::ControlServer> server;
+        int status = 0;
+        try {
+            server.emplace(net, controlPath);
+            net.onMessageReceived([&server](const message::Message& msg) { server->onMessageReceived(msg); });
+            net.startServer(port);
+            std::cout << "Listening on " << net.getListeningAddress() << ", control socket " << controlPath
+                      << std::endl;
+            server->run();
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            status = 1;
+        }
+        net.shutdown();
+        return status;
+    }
+
+    // Initialize the UI, subscribe it to received messages and start the server.
+    ui::UI ui(net);
+    net.onMessageReceived([&ui](const message::Message& msg) { ui.onMessageReceived(msg); });
     net.startServer(port);
 
     // Run the terminal UI.
-    ui::UI ui(net);
     ui.run();
 
     // Clean up network resources.
     net.shutdown();
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,91 @@
+#include "message/Codec.h"
+#include <stdexcept>
+
+namespace message {
+
+    // Appends an unsigned LEB128 varint: 7 bits per byte, high bit set on all but the last.
+    void putVarint(std::string& out, std::uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    // Appends a fixed-width little-endian 64-bit integer.
+    void putFixed64(std::string& out, std::uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    // Appends a varint length followed by the bytes of value.
+    void putBytes(std::string& out, std::string_view value) {
+        putVarint(out, value.size());
+        out.append(value.data(), value.size());
+    }
+
+    // Constructs a reader positioned at the start of data.
+    ByteReader::ByteReader(std::string_view data) : data_(data) {}
+
+    // Reads one byte.
+    std::uint8_t ByteReader::readByte() {
+        if (pos_ >= data_.size()) {
+            throw std::runtime_error("Truncated input");
+        }
+        return static_cast<std::uint8_t>(data_[pos_++]);
+    }
+
+    // Reads an unsigned LEB128 varint of at most 10 bytes.
+    std::uint64_t ByteReader::readVarint() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            std::uint8_t byte = readByte();
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Malformed varint");
+    }
+
+    // Reads a fixed-width little-endian 64-bit integer.
+    std::uint64_t ByteReader::readFixed64() {
+        std::string_view raw = readRaw(8);
+        std::uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(raw[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    // Reads a varint length and returns a view of that many following bytes.
+    std::string_view ByteReader::readBytes() {
+        std::uint64_t length = readVarint();
+        if (length > remaining()) {
+            throw std::runtime_error("Truncated input");
+        }
+        return readRaw(static_cast<std::size_t>(length));
+    }
+
+    // Returns a view of the next count bytes.
+    std::string_view ByteReader::readRaw(std::size_t count) {
+        if (count > remaining()) {
+            throw std::runtime_error("Truncated input");
+        }
+        std::string_view view = data_.substr(pos_, count);
+        pos_ += count;
+        return view;
+    }
+
+    // Returns the number of bytes consumed so far.
+    std::size_t ByteReader::position() const {
+        return pos_;
+    }
+
+    // Returns the number of bytes left to read.
+    std::size_t ByteReader::remaining() const {
+        return data_.size() - pos_;
+    }
+
+}  // namespace message
@@ -0,0 +1,95 @@
+#include "message/Manifest.h"
+#include "message/Codec.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace message {
+
+    // Constructs a manifest from its parts.
+    Manifest::Manifest(std::string name, std::uint64_t size, std::uint32_t chunkSize, std::vector<storage::Digest> chunks)
+        : name_(std::move(name)), size_(size), chunkSize_(chunkSize), chunks_(std::move(chunks)) {}
+
+    // Returns the file name.
+    const std::string& Manifest::getName() const {
+        return name_;
+    }
+
+    // Returns the file size in bytes.
+    std::uint64_t Manifest::getSize() const {
+        return size_;
+    }
+
+    // Returns the chunk size in bytes.
+    std::uint32_t Manifest::getChunkSize() const {
+        return chunkSize_;
+    }
+
+    // Returns the number of chunks.
+    std::size_t Manifest::chunkCount() const {
+        return chunks_.size();
+    }
+
+    // Returns the digest of the chunk at index.
+    const storage::Digest& Manifest::chunkHash(std::size_t index) const {
+        return chunks_.at(index);
+    }
+
+    // Returns the byte offset of the chunk at index.
+    std::uint64_t Manifest::chunkOffset(std::size_t index) const {
+        return static_cast<std::uint64_t>(index) * chunkSize_;
+    }
+
+    // Returns the length of the chunk at index; only the last chunk may be short.
+    std::uint32_t Manifest::chunkLength(std::size_t index) const {
+        return static_cast<std::uint32_t>(std::min<std::uint64_t>(chunkSize_, size_ - chunkOffset(index)));
+    }
+
+    // Returns the digest of the encoded manifest.
+    storage::Digest Manifest::id() const {
+        std::string encoded;
+        encode(encoded);
+        return storage::sha256(encoded);
+    }
+
+    // Appends the binary encoding to out.
+    void Manifest::encode(std::string& out) const {
+        out.push_back(static_cast<char>(MANIFEST_FORMAT_VERSION));
+        putBytes(out, name_);
+        putVarint(out, size_);
+        putVarint(out, chunkSize_);
+        for (const auto& chunk : chunks_) {
+            out.append(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+        }
+    }
+
+    // Decodes a manifest and checks that the chunk list matches the size.
+    Manifest Manifest::decode(std::string_view data) {
+        ByteReader reader(data);
+        if (reader.readByte() != MANIFEST_FORMAT_VERSION) {
+            throw std::runtime_error("Unsupported manifest version");
+        }
+        Manifest manifest;
+        manifest.name_ = std::string(reader.readBytes());
+        manifest.size_ = reader.readVarint();
+        std::uint64_t chunkSize = reader.readVarint();
+        if (chunkSize == 0 || chunkSize > MAX_CHUNK_SIZE) {
+            throw std::runtime_error("Invalid manifest chunk size");
+        }
+        manifest.chunkSize_ = static_cast<std::uint32_t>(chunkSize);
+        // Rounded up without adding to the size, and checked against the payload before
+        // multiplying, so a peer-supplied size cannot wrap either.
+        std::uint64_t count = manifest.size_ / chunkSize + (manifest.size_ % chunkSize != 0);
+        if (count > reader.remaining() / sizeof(storage::Digest) ||
+            count * sizeof(storage::Digest) != reader.remaining()) {
+            throw std::runtime_error("Manifest chunk list does not match size");
+        }
+        manifest.chunks_.resize(static_cast<std::size_t>(count));
+        for (auto& chunk : manifest.chunks_) {
+            std::memcpy(chunk.data(), reader.readRaw(chunk.size()).data(), chunk.size());
+        }
+        return manifest;
+    }
+
+}  // namespace message
@@ -1,4 +1,5 @@
 #include "message/Message.h"
+#include "message/Codec.h"
 #include <iomanip>
 #include <sstream>
 #include <stdexcept>
@@ -6,6 +7,13 @@
 
 namespace message {
 
+    namespace {
+
+        // Version, type and flags bytes followed by the 8-byte timestamp.
+        constexpr std::size_t FIXED_HEADER_SIZE = 3 + 8;
+
+    }  // namespace
+
     // Constructs a Message with peer ID, topic, content, and type.
     // Initializes read_ as false (unused, reserved for future).
     Message::Message(const std::string& peerID,
@@ -19,6 +27,16 @@ namespace message {
           read_(false),
           timestamp_(std::chrono::system_clock::now()) {}
 
+    // Constructs a Message by copying a decoded view, overriding its type.
+    Message::Message(const MessageView& view, MessageType type)
+        : peerID_(view.peerID),
+          topic_(view.topic),
+          content_(view.content),
+          type_(type),
+          read_(view.read),
+          timestamp_(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+              std::chrono::nanoseconds(view.timestampNs))) {}
+
     // Returns the peer ID associated with the message.
     const std::string& Message::getPeerID() const {
         return peerID_;
@@ -54,8 +72,56 @@ namespace message {
         read_ = true;
     }
 
-    // Encodes the message into a single line for logging.
+    // Encodes the message in the binary format into a new string.
     std::string Message::encode() const {
+        std::string out;
+        encode(out);
+        return out;
+    }
+
+    // Appends the binary encoding to out.
+    // The timestamp is stored raw, so encoding needs no time formatting.
+    void Message::encode(std::string& out) const {
+        out.reserve(out.size() + FIXED_HEADER_SIZE + peerID_.size() + topic_.size() + content_.size() + 6);
+        out.push_back(static_cast<char>(MESSAGE_FORMAT_VERSION));
+        out.push_back(static_cast<char>(type_));
+        out.push_back(static_cast<char>(read_ ? 1 : 0));
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp_.time_since_epoch()).count();
+        putFixed64(out, static_cast<std::uint64_t>(ns));
+        putBytes(out, peerID_);
+        putBytes(out, topic_);
+        putBytes(out, content_);
+    }
+
+    // Decodes a binary-encoded message into a Message object.
+    Message Message::decode(std::string_view data) {
+        MessageView view;
+        decodeView(data, view);
+        return Message(view, view.type);
+    }
+
+    // Decodes a binary-encoded message into views over data.
+    // Rejects unknown versions and message types.
+    std::size_t Message::decodeView(std::string_view data, MessageView& view) {
+        ByteReader reader(data);
+        if (reader.readByte() != MESSAGE_FORMAT_VERSION) {
+            throw std::runtime_error("Unsupported message format version");
+        }
+        std::uint8_t type = reader.readByte();
+        if (type > static_cast<std::uint8_t>(MessageType::RECEIVED)) {
+            throw std::runtime_error("Unknown message type");
+        }
+        view.type = static_cast<MessageType>(type);
+        view.read = (reader.readByte() & 1) != 0;
+        view.timestampNs = static_cast<std::int64_t>(reader.readFixed64());
+        view.peerID = reader.readBytes();
+        view.topic = reader.readBytes();
+        view.content = reader.readBytes();
+        return reader.position();
+    }
+
+    // Encodes the message into a single '|'-separated line for text export.
+    std::string Message::encodeText() const {
         std::ostringstream oss;
         auto timeT = std::chrono::system_clock::to_time_t(timestamp_);
         oss << peerID_ << "|" << static_cast<int>(type_) << "|"
@@ -64,18 +130,21 @@ namespace message {
         return oss.str();
     }
 
-    // Decodes a string into a Message object.
+    // Decodes a text line into a Message object.
     // Assumes well-formed input with minimal validation.
-    Message Message::decode(const std::string& line) {
-        std::istringstream iss(line);
-        std::string part;
+    // Content is everything after the fifth separator, so it may itself contain '|'.
+    Message Message::decodeText(std::string_view line) {
         std::vector<std::string> tokens;
-        while (std::getline(iss, part, '|')) {
-            tokens.push_back(part);
-        }
-        if (tokens.size() < 6) {
-            throw std::runtime_error("Malformed message log line");
+        std::size_t start = 0;
+        while (tokens.size() < 5) {
+            std::size_t pos = line.find('|', start);
+            if (pos == std::string_view::npos) {
+                throw std::runtime_error("Malformed message log line");
+            }
+            tokens.emplace_back(line.substr(start, pos - start));
+            start = pos + 1;
         }
+        tokens.emplace_back(line.substr(start));
 
         MessageType type = static_cast<MessageType>(std::stoi(tokens[1]));
         bool read = (tokens[2] == "1" || tokens[2] == "true");
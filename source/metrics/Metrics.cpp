@@ -0,0 +1,72 @@
+#include "metrics/Metrics.h"
+#include <algorithm>
+
+namespace metrics {
+
+    // Threads take stripes in turn, so a handful of busy threads land on different ones.
+    std::size_t threadStripe() {
+        static std::atomic<std::size_t> next{0};
+        thread_local std::size_t stripe = next.fetch_add(1, std::memory_order_relaxed) % STRIPES;
+        return stripe;
+    }
+
+    // Sums the cells; concurrent adds may or may not be included.
+    std::uint64_t Counter::value() const {
+        std::uint64_t total = 0;
+        for (const auto& cell : cells_) {
+            total += cell.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    const std::array<std::uint64_t, Histogram::BOUNDS> Histogram::BOUNDS_NS = {
+        1000,        2000,        5000,         10000,       20000,       50000,
+        100000,      200000,      500000,       1000000,     2000000,     5000000,
+        10000000,    20000000,    50000000,     100000000,   200000000,   500000000,
+        1000000000,  2000000000,  5000000000,   10000000000,
+    };
+
+    // A duration falls into the first bucket whose bound is at least as large, as Prometheus'
+    // "le" buckets count it.
+    void Histogram::observe(std::chrono::nanoseconds duration) {
+        auto ns = static_cast<std::uint64_t>(std::max<std::chrono::nanoseconds::rep>(0, duration.count()));
+        std::size_t bucket = std::lower_bound(BOUNDS_NS.begin(), BOUNDS_NS.end(), ns) - BOUNDS_NS.begin();
+        Stripe& stripe = stripes_[threadStripe()];
+        stripe.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+        stripe.sumNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    // Sums the stripes; the count is derived from the buckets so the two always agree.
+    Histogram::Snapshot Histogram::snapshot() const {
+        Snapshot snapshot;
+        for (const auto& stripe : stripes_) {
+            for (std::size_t i = 0; i <= BOUNDS; ++i) {
+                snapshot.counts[i] += stripe.counts[i].load(std::memory_order_relaxed);
+            }
+            snapshot.sumNs += stripe.sumNs.load(std::memory_order_relaxed);
+        }
+        for (std::uint64_t count : snapshot.counts) {
+            snapshot.count += count;
+        }
+        return snapshot;
+    }
+
+    // Linear interpolation between the bucket's bounds, as Prometheus' histogram_quantile() does.
+    double Histogram::Snapshot::quantile(double q) const {
+        if (count == 0) {
+            return 0;
+        }
+        double rank = q * static_cast<double>(count);
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < BOUNDS; ++i) {
+            if (counts[i] > 0 && static_cast<double>(seen + counts[i]) >= rank) {
+                double low = i == 0 ? 0 : static_cast<double>(BOUNDS_NS[i - 1]);
+                double high = static_cast<double>(BOUNDS_NS[i]);
+                return low + (high - low) * (rank - static_cast<double>(seen)) / static_cast<double>(counts[i]);
+            }
+            seen += counts[i];
+        }
+        return static_cast<double>(BOUNDS_NS[BOUNDS - 1]);
+    }
+
+}  // namespace metrics
@@ -0,0 +1,207 @@
+#include "metrics/Registry.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace metrics {
+
+    namespace {
+
+        // Formats a sample value: integers exactly, anything else with enough digits to read back.
+        void appendNumber(std::string& out, double value) {
+            char number[32];
+            if (std::isinf(value)) {
+                out += value > 0 ? "+Inf" : "-Inf";
+                return;
+            }
+            if (value == std::floor(value) && std::fabs(value) < 1e15) {
+                std::snprintf(number, sizeof(number), "%.0f", value);
+            } else {
+                std::snprintf(number, sizeof(number), "%.15g", value);
+                if (std::strtod(number, nullptr) != value) {
+                    std::snprintf(number, sizeof(number), "%.17g", value);
+                }
+            }
+            out += number;
+        }
+
+        // Escapes a label value as the exposition format requires.
+        void appendLabelValue(std::string& out, const std::string& value) {
+            for (char c : value) {
+                if (c == '\\') {
+                    out += "\\\\";
+                } else if (c == '"') {
+                    out += "\\\"";
+                } else if (c == '\n') {
+                    out += "\\n";
+                } else {
+                    out += c;
+                }
+            }
+        }
+
+        // Escapes help text, which may contain quotes but not backslashes or newlines unescaped.
+        void appendHelp(std::string& out, const std::string& help) {
+            for (char c : help) {
+                if (c == '\\') {
+                    out += "\\\\";
+                } else if (c == '\n') {
+                    out += "\\n";
+                } else {
+                    out += c;
+                }
+            }
+        }
+
+    }  // namespace
+
+    // Writes the HELP and TYPE lines of a family.
+    void TextWriter::family(const std::string& name, const std::string& help, const char* type) {
+        out_ += "# HELP " + name + " ";
+        appendHelp(out_, help);
+        out_ += "\n# TYPE " + name + " " + type + "\n";
+    }
+
+    // Writes one sample line.
+    void TextWriter::sample(const std::string& name, const Labels& labels, double value) {
+        writeSeries(name, labels);
+        appendNumber(out_, value);
+        out_ += '\n';
+    }
+
+    // Buckets are cumulative in the exposition format, with bounds in seconds and a final +Inf.
+    void TextWriter::histogram(const std::string& name, const Labels& labels, const Histogram::Snapshot& snapshot) {
+        Labels bucketLabels = labels;
+        bucketLabels.emplace_back("le", "");
+        std::uint64_t cumulative = 0;
+        for (std::size_t i = 0; i <= Histogram::BOUNDS; ++i) {
+            cumulative += snapshot.counts[i];
+            std::string bound;
+            if (i < Histogram::BOUNDS) {
+                appendNumber(bound, static_cast<double>(Histogram::BOUNDS_NS[i]) / 1e9);
+            } else {
+                bound = "+Inf";
+            }
+            bucketLabels.back().second = bound;
+            writeSeries(name + "_bucket", bucketLabels);
+            appendNumber(out_, static_cast<double>(cumulative));
+            out_ += '\n';
+        }
+        sample(name + "_sum", labels, static_cast<double>(snapshot.sumNs) / 1e9);
+        sample(name + "_count", labels, static_cast<double>(snapshot.count));
+    }
+
+    // Returns the text written so far.
+    const std::string& TextWriter::str() const {
+        return out_;
+    }
+
+    // Appends name{label="value",...} and a space; no braces without labels.
+    void TextWriter::writeSeries(const std::string& name, const Labels& labels) {
+        out_ += name;
+        if (!labels.empty()) {
+            out_ += '{';
+            bool first = true;
+            for (const auto& [key, value] : labels) {
+                if (!first) {
+                    out_ += ',';
+                }
+                first = false;
+                out_ += key + "=\"";
+                appendLabelValue(out_, value);
+                out_ += '"';
+            }
+            out_ += '}';
+        }
+        out_ += ' ';
+    }
+
+    // Returns the singleton instance of Registry.
+    Registry& Registry::instance() {
+        static Registry instance;
+        return instance;
+    }
+
+    // Returns the existing counter or registers a new one.
+    // Throws std::logic_error if the name belongs to a histogram.
+    Counter& Registry::counter(const std::string& name, const std::string& help) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (const Entry* entry = find(name)) {
+            if (!entry->counter) {
+                throw std::logic_error("Metric " + name + " is not a counter");
+            }
+            return *entry->counter;
+        }
+        entries_.push_back(Entry{name, help, std::make_unique<Counter>(), nullptr});
+        return *entries_.back().counter;
+    }
+
+    // Returns the existing histogram or registers a new one.
+    // Throws std::logic_error if the name belongs to a counter.
+    Histogram& Registry::histogram(const std::string& name, const std::string& help) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (const Entry* entry = find(name)) {
+            if (!entry->histogram) {
+                throw std::logic_error("Metric " + name + " is not a histogram");
+            }
+            return *entry->histogram;
+        }
+        entries_.push_back(Entry{name, help, nullptr, std::make_unique<Histogram>()});
+        return *entries_.back().histogram;
+    }
+
+    // Looks up a counter by name.
+    const Counter* Registry::findCounter(const std::string& name) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const Entry* entry = find(name);
+        return entry ? entry->counter.get() : nullptr;
+    }
+
+    // Looks up a histogram by name.
+    const Histogram* Registry::findHistogram(const std::string& name) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const Entry* entry = find(name);
+        return entry ? entry->histogram.get() : nullptr;
+    }
+
+    // Registers a collector.
+    void Registry::addCollector(std::function<void(TextWriter&)> collector) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        collectors_.push_back(std::move(collector));
+    }
+
+    // Collectors run outside the lock, since they take the locks of the components they report on.
+    std::string Registry::exportText() const {
+        TextWriter out;
+        std::vector<std::function<void(TextWriter&)>> collectors;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& entry : entries_) {
+                if (entry.counter) {
+                    out.family(entry.name, entry.help, "counter");
+                    out.sample(entry.name, {}, static_cast<double>(entry.counter->value()));
+                } else {
+                    out.family(entry.name, entry.help, "histogram");
+                    out.histogram(entry.name, {}, entry.histogram->snapshot());
+                }
+            }
+            collectors = collectors_;
+        }
+        for (const auto& collector : collectors) {
+            collector(out);
+        }
+        return out.str();
+    }
+
+    // Linear search; there are a few dozen metrics at most.
+    const Registry::Entry* Registry::find(const std::string& name) const {
+        for (const auto& entry : entries_) {
+            if (entry.name == name) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+}  // namespace metrics
@@ -0,0 +1,302 @@
+#include "network/ChunkScheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+
+namespace network {
+
+    namespace {
+
+        // Requests outstanding per source before its throughput is known.
+        constexpr std::size_t INITIAL_WINDOW = 4;
+
+        // Bounds of a source's request window.
+        constexpr std::size_t MIN_WINDOW = 2;
+        constexpr std::size_t MAX_WINDOW = 32;
+
+        // Data a source's window should cover at its measured throughput.
+        constexpr double WINDOW_SECONDS = 1.0;
+
+        // Weight of the newest sample in a source's throughput estimate.
+        constexpr double THROUGHPUT_WEIGHT = 0.3;
+
+        // How many times longer than predicted a request may take before it is overdue.
+        constexpr double OVERDUE_FACTOR = 4.0;
+
+        // Lower bound on how long any request may take.
+        constexpr auto MIN_TIMEOUT = std::chrono::seconds(2);
+
+        // How long a request may take before the source's throughput is known.
+        constexpr auto INITIAL_TIMEOUT = std::chrono::seconds(10);
+
+        // How long a source may go without delivering any requested chunk before it is stalled.
+        constexpr auto STALL_TIMEOUT = std::chrono::seconds(30);
+
+        // Mixes a chunk index with a per-source seed, so that sources break rarity ties
+        // in different orders and start on different chunks.
+        std::uint64_t tieBreak(std::size_t index, ChunkScheduler::Source source) {
+            std::uint64_t x = static_cast<std::uint64_t>(index) ^ reinterpret_cast<std::uintptr_t>(source);
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdULL;
+            x ^= x >> 33;
+            return x;
+        }
+
+    }  // namespace
+
+    // Constructs a scheduler for chunks of the given lengths.
+    ChunkScheduler::ChunkScheduler(std::vector<std::uint32_t> lengths, std::vector<bool> have)
+        : lengths_(std::move(lengths)),
+          have_(std::move(have)),
+          availability_(lengths_.size(), 0),
+          requested_(lengths_.size(), 0) {
+        have_.resize(lengths_.size(), false);
+        remaining_ = static_cast<std::size_t>(std::count(have_.begin(), have_.end(), false));
+    }
+
+    // Adds a source or replaces its availability.
+    void ChunkScheduler::updateSource(Source source, const std::vector<bool>& available) {
+        if (available.size() != lengths_.size()) {
+            return;
+        }
+        auto [it, added] = sources_.try_emplace(source);
+        SourceState& state = it->second;
+        if (added) {
+            state.window = INITIAL_WINDOW;
+        } else {
+            for (std::size_t i = 0; i < lengths_.size(); ++i) {
+                availability_[i] -= state.available[i];
+            }
+            std::vector<std::size_t> withdrawn;
+            for (const auto& [index, sentAt] : state.outstanding) {
+                if (!available[index]) {
+                    withdrawn.push_back(index);
+                }
+            }
+            for (std::size_t index : withdrawn) {
+                release(state, index);
+            }
+        }
+        state.available = available;
+        for (std::size_t i = 0; i < lengths_.size(); ++i) {
+            availability_[i] += available[i];
+        }
+    }
+
+    // Removes a source and releases its outstanding requests.
+    void ChunkScheduler::removeSource(Source source) {
+        auto it = sources_.find(source);
+        if (it == sources_.end()) {
+            return;
+        }
+        for (const auto& [index, sentAt] : it->second.outstanding) {
+            --requested_[index];
+        }
+        for (std::size_t i = 0; i < lengths_.size(); ++i) {
+            availability_[i] -= it->second.available[i];
+        }
+        sources_.erase(it);
+    }
+
+    // Returns true if the source is known.
+    bool ChunkScheduler::hasSource(Source source) const {
+        return sources_.count(source) > 0;
+    }
+
+    // Returns the number of sources.
+    std::size_t ChunkScheduler::sourceCount() const {
+        return sources_.size();
+    }
+
+    // Returns every source, fastest first, so that fast sources pick up released work first.
+    std::vector<ChunkScheduler::Source> ChunkScheduler::sources() const {
+        std::vector<Source> result;
+        result.reserve(sources_.size());
+        for (const auto& [source, state] : sources_) {
+            result.push_back(source);
+        }
+        std::stable_sort(result.begin(), result.end(), [this](Source a, Source b) {
+            return sources_.at(a).bytesPerSecond > sources_.at(b).bytesPerSecond;
+        });
+        return result;
+    }
+
+    // Releases overdue requests for chunks another source could serve, halving the slow source's window.
+    // A chunk only one source holds stays with it, since nobody else could serve it sooner.
+    void ChunkScheduler::releaseOverdue(Clock::time_point now) {
+        for (auto& [source, state] : sources_) {
+            std::vector<std::size_t> overdue;
+            for (const auto& [index, sentAt] : state.outstanding) {
+                if (availability_[index] > 1 && now > deadline(state, index, sentAt)) {
+                    overdue.push_back(index);
+                }
+            }
+            for (std::size_t index : overdue) {
+                release(state, index);
+            }
+            if (!overdue.empty()) {
+                state.window = std::max(MIN_WINDOW, state.window / 2);
+            }
+        }
+    }
+
+    // Requests released as overdue are usually requested from the same source again, so
+    // stalling is measured from the first request the source has left unanswered, not from
+    // the age of any one request.
+    std::vector<ChunkScheduler::Source> ChunkScheduler::stalled(Clock::time_point now) const {
+        std::vector<Source> result;
+        for (const auto& [source, state] : sources_) {
+            if (!state.outstanding.empty() && state.waitingSince != Clock::time_point{} &&
+                now - state.waitingSince > STALL_TIMEOUT) {
+                result.push_back(source);
+            }
+        }
+        return result;
+    }
+
+    // Fills the source's window: rarest unrequested chunks first, then, in endgame,
+    // chunks already requested from other sources, least-requested first.
+    std::vector<std::size_t> ChunkScheduler::next(Source source, Clock::time_point now) {
+        std::vector<std::size_t> picked;
+        auto it = sources_.find(source);
+        if (it == sources_.end()) {
+            return picked;
+        }
+        SourceState& state = it->second;
+        if (state.outstanding.size() >= state.window) {
+            return picked;
+        }
+        std::size_t capacity = state.window - state.outstanding.size();
+
+        std::vector<std::size_t> candidates;
+        bool unrequestedLeft = false;
+        for (std::size_t i = 0; i < lengths_.size(); ++i) {
+            if (have_[i] || requested_[i] > 0) {
+                continue;
+            }
+            unrequestedLeft = true;
+            if (state.available[i]) {
+                candidates.push_back(i);
+            }
+        }
+        if (candidates.empty() && !unrequestedLeft) {
+            for (std::size_t i = 0; i < lengths_.size(); ++i) {
+                if (!have_[i] && state.available[i] && !state.outstanding.count(i)) {
+                    candidates.push_back(i);
+                }
+            }
+        }
+        // Unrequested chunks all have a request count of zero, so outside endgame this orders by rarity alone.
+        auto byRarity = [this, source](std::size_t a, std::size_t b) {
+            return std::make_tuple(requested_[a], availability_[a], tieBreak(a, source)) <
+                   std::make_tuple(requested_[b], availability_[b], tieBreak(b, source));
+        };
+
+        std::size_t count = std::min(capacity, candidates.size());
+        std::partial_sort(candidates.begin(), candidates.begin() + static_cast<std::ptrdiff_t>(count),
+                          candidates.end(), byRarity);
+        for (std::size_t i = 0; i < count; ++i) {
+            std::size_t index = candidates[i];
+            state.outstanding[index] = now;
+            ++requested_[index];
+            picked.push_back(index);
+        }
+        if (!picked.empty() && state.waitingSince == Clock::time_point{}) {
+            state.waitingSince = now;
+        }
+        return picked;
+    }
+
+    // Records an arrival: updates the source's throughput and window, and marks the chunk held,
+    // cancelling the duplicate requests made for it in endgame.
+    bool ChunkScheduler::completed(Source source, std::size_t index, Clock::time_point now) {
+        auto it = sources_.find(source);
+        if (it != sources_.end()) {
+            SourceState& state = it->second;
+            auto request = state.outstanding.find(index);
+            Clock::time_point start = state.lastArrival;
+            if (request != state.outstanding.end()) {
+                start = std::max(start, request->second);
+                release(state, index);
+            }
+            if (start != Clock::time_point{}) {
+                double seconds = std::max(1e-3, std::chrono::duration<double>(now - start).count());
+                double sample = lengths_[index] / seconds;
+                state.bytesPerSecond = state.bytesPerSecond == 0
+                                           ? sample
+                                           : THROUGHPUT_WEIGHT * sample + (1 - THROUGHPUT_WEIGHT) * state.bytesPerSecond;
+                auto window = static_cast<std::size_t>(
+                    std::ceil(state.bytesPerSecond * WINDOW_SECONDS / std::max<std::uint32_t>(1, lengths_[index])));
+                state.window = std::clamp(window, MIN_WINDOW, MAX_WINDOW);
+            }
+            state.lastArrival = now;
+            state.waitingSince = state.outstanding.empty() ? Clock::time_point{} : now;
+        }
+        if (have_[index]) {
+            return false;
+        }
+        have_[index] = true;
+        --remaining_;
+        for (auto& [other, state] : sources_) {
+            if (state.outstanding.count(index)) {
+                release(state, index);
+                if (state.outstanding.empty()) {
+                    // Nothing left to wait for; the source is not to blame.
+                    state.waitingSince = Clock::time_point{};
+                }
+            }
+        }
+        return true;
+    }
+
+    // Releases a chunk that failed verification so it is requested again.
+    void ChunkScheduler::failed(Source source, std::size_t index) {
+        auto it = sources_.find(source);
+        if (it != sources_.end() && it->second.outstanding.count(index)) {
+            release(it->second, index);
+        }
+    }
+
+    // Returns true if the chunk is held.
+    bool ChunkScheduler::has(std::size_t index) const {
+        return have_.at(index);
+    }
+
+    // Returns the held chunks.
+    const std::vector<bool>& ChunkScheduler::have() const {
+        return have_;
+    }
+
+    // Returns true once every chunk is held.
+    bool ChunkScheduler::done() const {
+        return remaining_ == 0;
+    }
+
+    // Returns the source's measured throughput in bytes per second.
+    double ChunkScheduler::throughput(Source source) const {
+        auto it = sources_.find(source);
+        return it == sources_.end() ? 0 : it->second.bytesPerSecond;
+    }
+
+    // Drops an outstanding request from a source.
+    void ChunkScheduler::release(SourceState& state, std::size_t index) {
+        if (state.outstanding.erase(index)) {
+            --requested_[index];
+        }
+    }
+
+    // A request is overdue once it has waited several times as long as the source needs
+    // to deliver everything outstanding to it at its measured throughput.
+    ChunkScheduler::Clock::time_point ChunkScheduler::deadline(const SourceState& state, std::size_t index,
+                                                               Clock::time_point sentAt) const {
+        if (state.bytesPerSecond == 0) {
+            return sentAt + INITIAL_TIMEOUT;
+        }
+        double queuedBytes = static_cast<double>(lengths_[index]) * std::max<std::size_t>(1, state.outstanding.size());
+        auto expected = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(OVERDUE_FACTOR * queuedBytes / state.bytesPerSecond));
+        return sentAt + std::max<Clock::duration>(MIN_TIMEOUT, expected);
+    }
+
+}  // namespace network
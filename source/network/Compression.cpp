@@ -0,0 +1,117 @@
+#include "network/Compression.h"
+#include "message/Codec.h"
+#include <algorithm>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace network {
+
+    namespace {
+
+        // Runs skipped after the first poor ratio; doubles on each further one, up to the maximum.
+        constexpr std::size_t MIN_BACKOFF_RUNS = 8;
+        constexpr std::size_t MAX_BACKOFF_RUNS = 256;
+
+        // Raw deflate (no zlib header or checksum; TCP already guards the bytes) at the fastest level.
+        constexpr int WINDOW_BITS = -15;
+        constexpr int LEVEL = Z_BEST_SPEED;
+
+    }  // namespace
+
+    // Ends a deflate stream.
+    void FrameCompressor::DeflateEnd::operator()(z_stream_s* stream) const {
+        deflateEnd(stream);
+        delete stream;
+    }
+
+    // Ends an inflate stream.
+    void FrameCompressor::InflateEnd::operator()(z_stream_s* stream) const {
+        inflateEnd(stream);
+        delete stream;
+    }
+
+    // Constructs a compressor without allocating any zlib state.
+    FrameCompressor::FrameCompressor() : backoff_(MIN_BACKOFF_RUNS) {}
+
+    // Frees the zlib streams.
+    FrameCompressor::~FrameCompressor() = default;
+
+    // The output buffer is sized for the acceptable result only; running out of it means the
+    // ratio was poor, and deflate stops there instead of finishing a useless stream.
+    SharedFrame FrameCompressor::compress(const std::vector<SharedFrame>& frames, std::size_t bytes) {
+        if (bytes < MIN_COMPRESSED_RUN) {
+            return nullptr;
+        }
+        if (skip_ > 0) {
+            --skip_;
+            return nullptr;
+        }
+        if (!deflater_) {
+            auto stream = std::make_unique<z_stream>();
+            if (deflateInit2(stream.get(), LEVEL, Z_DEFLATED, WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                throw std::runtime_error("Failed to initialize deflate");
+            }
+            deflater_.reset(stream.release());
+        } else {
+            deflateReset(deflater_.get());
+        }
+
+        std::string header;
+        message::putVarint(header, bytes);
+        std::size_t limit = bytes - bytes / 8;
+        auto out = std::make_shared<std::string>(FRAME_HEADER_SIZE + header.size() + limit, '\0');
+        std::copy(header.begin(), header.end(), out->begin() + FRAME_HEADER_SIZE);
+        z_stream& stream = *deflater_;
+        stream.next_out = reinterpret_cast<Bytef*>(out->data() + FRAME_HEADER_SIZE + header.size());
+        stream.avail_out = static_cast<uInt>(limit);
+        int result = Z_OK;
+        for (std::size_t i = 0; i < frames.size() && result == Z_OK; ++i) {
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(frames[i]->data()));
+            stream.avail_in = static_cast<uInt>(frames[i]->size());
+            result = deflate(&stream, i + 1 == frames.size() ? Z_FINISH : Z_NO_FLUSH);
+            if (result == Z_OK && stream.avail_out == 0) {
+                result = Z_BUF_ERROR;
+            }
+        }
+        if (result != Z_STREAM_END) {
+            skip_ = backoff_;
+            backoff_ = std::min(backoff_ * 2, MAX_BACKOFF_RUNS);
+            return nullptr;
+        }
+        backoff_ = MIN_BACKOFF_RUNS;
+        std::size_t payload = header.size() + (limit - stream.avail_out);
+        out->resize(FRAME_HEADER_SIZE + payload);
+        writeFrameHeader(out->data(), FrameType::COMPRESSED, static_cast<std::uint32_t>(payload));
+        return out;
+    }
+
+    // Inflates into out, which is sized from the announced length and must be filled exactly.
+    void FrameCompressor::decompress(std::string_view payload, std::size_t maxSize, std::string& out) {
+        message::ByteReader reader(payload);
+        std::uint64_t size = reader.readVarint();
+        if (size > maxSize) {
+            throw std::runtime_error("Compressed batch of " + std::to_string(size) + " bytes exceeds limit");
+        }
+        if (!inflater_) {
+            auto stream = std::make_unique<z_stream>();
+            if (inflateInit2(stream.get(), WINDOW_BITS) != Z_OK) {
+                throw std::runtime_error("Failed to initialize inflate");
+            }
+            inflater_.reset(stream.release());
+        } else {
+            inflateReset(inflater_.get());
+        }
+        std::string_view data = reader.readRaw(reader.remaining());
+        out.assign(size, '\0');
+        z_stream& stream = *inflater_;
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+        stream.next_out = reinterpret_cast<Bytef*>(out.data());
+        stream.avail_out = static_cast<uInt>(size);
+        int result = inflate(&stream, Z_FINISH);
+        if (result != Z_STREAM_END || stream.avail_out != 0 || stream.avail_in != 0) {
+            throw std::runtime_error("Malformed compressed batch");
+        }
+    }
+
+}  // namespace network
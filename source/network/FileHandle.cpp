@@ -0,0 +1,36 @@
+#include "network/FileHandle.h"
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace network {
+
+    // Takes ownership of fd.
+    FileHandle::FileHandle(int fd) : fd_(fd) {}
+
+    // Closes the descriptor if it is valid.
+    FileHandle::~FileHandle() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    // Returns the descriptor.
+    int FileHandle::fd() const {
+        return fd_;
+    }
+
+    // Returns true if the descriptor is valid.
+    bool FileHandle::isOpen() const {
+        return fd_ >= 0;
+    }
+
+    // Returns the file size in bytes, or 0 if unknown.
+    std::uint64_t FileHandle::size() const {
+        struct stat info;
+        if (fd_ < 0 || ::fstat(fd_, &info) != 0) {
+            return 0;
+        }
+        return static_cast<std::uint64_t>(info.st_size);
+    }
+
+}  // namespace network
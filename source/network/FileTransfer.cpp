@@ -0,0 +1,675 @@
+#include "network/FileTransfer.h"
+#include "message/Codec.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace network {
+
+    namespace {
+
+        // Size of every chunk except possibly the last.
+        constexpr std::uint32_t CHUNK_SIZE = 1024 * 1024;
+
+        // Chunks from one source failing verification before the source is dropped.
+        constexpr unsigned MAX_CHUNK_FAILURES = 3;
+
+        // Chunks a download gains between availability updates to interested peers.
+        constexpr std::size_t HAVE_INTERVAL = 16;
+
+        // Files kept open for serving chunks.
+        constexpr std::size_t MAX_OPEN_FILES = 64;
+
+        // Number of finished transfers kept for display.
+        constexpr std::size_t MAX_FINISHED = 32;
+
+        // Appends a file ID as raw bytes.
+        void putDigest(std::string& out, const storage::Digest& digest) {
+            out.append(reinterpret_cast<const char*>(digest.data()), digest.size());
+        }
+
+        // Reads a file ID written by putDigest().
+        storage::Digest readDigest(message::ByteReader& reader) {
+            storage::Digest digest;
+            std::memcpy(digest.data(), reader.readRaw(digest.size()).data(), digest.size());
+            return digest;
+        }
+
+        // Encodes a frame whose payload is just a file ID.
+        SharedFrame makeIdFrame(FrameType type, const storage::Digest& id) {
+            std::string payload;
+            putDigest(payload, id);
+            return makeSharedFrame(type, payload);
+        }
+
+        // Appends a chunk bitfield: varint chunk count, then one bit per chunk, lowest bit first.
+        void putBitfield(std::string& out, const std::vector<bool>& bits) {
+            message::putVarint(out, bits.size());
+            std::string packed((bits.size() + 7) / 8, '\0');
+            for (std::size_t i = 0; i < bits.size(); ++i) {
+                if (bits[i]) {
+                    packed[i / 8] = static_cast<char>(packed[i / 8] | (1 << (i % 8)));
+                }
+            }
+            out += packed;
+        }
+
+        // Reads a bitfield written by putBitfield(). The count is checked against the bytes left
+        // before it is rounded or allocated, so a peer cannot make either overflow.
+        std::vector<bool> readBitfield(message::ByteReader& reader) {
+            std::uint64_t count = reader.readVarint();
+            if (count > reader.remaining() * std::uint64_t{8}) {
+                throw std::runtime_error("Bitfield count exceeds payload");
+            }
+            std::string_view packed = reader.readRaw(static_cast<std::size_t>((count + 7) / 8));
+            std::vector<bool> bits(static_cast<std::size_t>(count));
+            for (std::size_t i = 0; i < bits.size(); ++i) {
+                bits[i] = (static_cast<unsigned char>(packed[i / 8]) >> (i % 8)) & 1;
+            }
+            return bits;
+        }
+
+        // Returns a path in directory for name that does not exist yet.
+        std::string uniquePath(const std::string& directory, const std::string& name) {
+            std::filesystem::path base = std::filesystem::path(directory) / name;
+            std::filesystem::path candidate = base;
+            for (int i = 1; std::filesystem::exists(candidate); ++i) {
+                candidate = base.parent_path() /
+                            (base.stem().string() + " (" + std::to_string(i) + ")" + base.extension().string());
+            }
+            return candidate.string();
+        }
+
+        // Writes all bytes at offset, retrying on partial writes.
+        bool writeAt(int fd, std::string_view data, std::uint64_t offset) {
+            while (!data.empty()) {
+                ssize_t written = ::pwrite(fd, data.data(), data.size(), static_cast<off_t>(offset));
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return false;
+                }
+                data.remove_prefix(static_cast<std::size_t>(written));
+                offset += static_cast<std::uint64_t>(written);
+            }
+            return true;
+        }
+
+    }  // namespace
+
+    // Returns a single-line summary of the transfer for UI display.
+    std::string TransferInfo::toString() const {
+        std::ostringstream oss;
+        oss << (outgoing ? "Sending " : "Receiving ") << name
+            << (outgoing ? " to " : " from ") << peerID
+            << " | " << bytesDone << "/" << size << " bytes";
+        if (bytesReused > 0) {
+            oss << " (" << bytesReused << " reused locally)";
+        }
+        oss << " | " << state;
+        return oss.str();
+    }
+
+    // Constructs a manager saving accepted files into "downloads", with its chunk index in "chunks".
+    FileTransferManager::FileTransferManager() = default;
+
+    // Hashes and indexes the file, then sends its manifest.
+    // Hashing happens before taking the lock, as it reads the whole file.
+    std::string FileTransferManager::offerFile(const std::shared_ptr<Peer>& peer, const std::string& path) {
+        message::Manifest manifest = store_.addFile(path, CHUNK_SIZE);
+        std::string payload;
+        manifest.encode(payload);
+        storage::Digest id = storage::sha256(payload);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Upload& upload = uploads_[UploadKey{peer.get(), id}];
+            upload.peerID = peer->getPeerID();
+            upload.name = manifest.getName();
+            upload.size = manifest.getSize();
+            manifests_[id] = std::move(manifest);
+        }
+        peer->sendFrame(makeSharedFrame(FrameType::FILE_MANIFEST, payload));
+        return storage::toHex(id);
+    }
+
+    // Dispatches a file frame. A malformed frame closes the connection, after the lock is
+    // released, as the disconnect handler takes it again.
+    void FileTransferManager::handleFrame(const std::shared_ptr<Peer>& peer, const FrameView& frame) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            try {
+                switch (frame.type) {
+                    case FrameType::FILE_MANIFEST:
+                        handleManifest(peer, frame.payload);
+                        break;
+                    case FrameType::CHUNK_REQUEST:
+                        handleChunkRequest(peer, frame.payload);
+                        break;
+                    case FrameType::CHUNK_DATA:
+                        handleChunkData(peer, frame.payload);
+                        break;
+                    case FrameType::FILE_DONE:
+                        handleDone(peer, frame.payload);
+                        break;
+                    case FrameType::FILE_CANCEL:
+                        handleCancel(peer, frame.payload);
+                        break;
+                    case FrameType::FILE_QUERY:
+                        handleQuery(peer, frame.payload);
+                        break;
+                    case FrameType::FILE_HAVE:
+                        handleHave(peer, frame.payload);
+                        break;
+                    default:
+                        break;
+                }
+                return;
+            } catch (const std::exception& e) {
+                std::cerr << "Malformed file frame from " << peer->getPeerID() << ": " << e.what() << "\n";
+            }
+        }
+        peer->close();
+    }
+
+    // Stops every upload to a peer that has disconnected and drops it as a download source.
+    void FileTransferManager::peerDisconnected(const std::shared_ptr<Peer>& peer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<UploadKey> uploadKeys;
+        for (const auto& [key, upload] : uploads_) {
+            if (key.first == peer.get()) {
+                uploadKeys.push_back(key);
+            }
+        }
+        for (const auto& key : uploadKeys) {
+            finishUpload(key, "failed (peer disconnected)");
+        }
+        std::vector<storage::Digest> downloadIds;
+        for (const auto& [id, download] : downloads_) {
+            downloadIds.push_back(id);
+        }
+        for (const auto& id : downloadIds) {
+            Download& download = downloads_.at(id);
+            download.interested.erase(peer.get());
+            if (download.sources.count(peer.get()) &&
+                removeSource(id, download, peer.get(), "interrupted (resumes when offered again)")) {
+                requestChunks(id, download);
+            }
+        }
+    }
+
+    // Sets the directory incoming files are saved into.
+    void FileTransferManager::setDownloadDirectory(const std::string& directory) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        downloadDirectory_ = directory;
+    }
+
+    // Registers a callback deciding whether to accept an offer.
+    void FileTransferManager::setOfferHandler(std::function<bool(const TransferInfo&)> handler) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        offerHandler_ = std::move(handler);
+    }
+
+    // Registers a callback returning the connected peers.
+    void FileTransferManager::setPeerSource(std::function<std::vector<std::shared_ptr<Peer>>()> source) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        peerSource_ = std::move(source);
+    }
+
+    // Returns descriptions of active and recently finished transfers.
+    std::vector<std::string> FileTransferManager::listTransferInfo() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::string> result;
+        for (const auto& [key, upload] : uploads_) {
+            TransferInfo info{true, upload.peerID, upload.name, upload.size, upload.bytesSent, 0, "in progress"};
+            result.push_back(info.toString());
+        }
+        for (const auto& [id, download] : downloads_) {
+            TransferInfo info{false, download.peerID, download.name, download.manifest.getSize(),
+                              download.bytesDone, download.bytesReused,
+                              "in progress (" + std::to_string(download.sources.size()) + " sources)"};
+            result.push_back(info.toString());
+        }
+        for (const auto& info : finished_) {
+            result.push_back(info.toString());
+        }
+        return result;
+    }
+
+    // Accepts or declines an offered manifest, reuses local chunks, then requests the rest from
+    // the offering peer and asks every other peer which chunks it can serve.
+    // The partial file is named after the file ID, so a repeated offer finds it again.
+    void FileTransferManager::handleManifest(const std::shared_ptr<Peer>& peer, std::string_view payload) {
+        message::Manifest manifest = message::Manifest::decode(payload);
+        storage::Digest id = storage::sha256(payload);
+        auto existing = downloads_.find(id);
+        if (existing != downloads_.end()) {
+            // Already downloading: the offering peer holds the whole file, so it becomes a source.
+            Download& download = existing->second;
+            download.sources[peer.get()] = peer;
+            download.scheduler->updateSource(peer.get(), std::vector<bool>(manifest.chunkCount(), true));
+            requestChunks(id, download);
+            return;
+        }
+
+        std::string name = std::filesystem::path(manifest.getName()).filename().string();
+        TransferInfo info{false, peer->getPeerID(), name, manifest.getSize(), 0, 0, "offered"};
+        if (name.empty() || name == "." || name == ".." || (offerHandler_ && !offerHandler_(info))) {
+            peer->sendFrame(makeIdFrame(FrameType::FILE_CANCEL, id));
+            return;
+        }
+
+        Download download;
+        download.peerID = info.peerID;
+        download.name = name;
+        std::error_code ec;
+        std::filesystem::create_directories(downloadDirectory_, ec);
+        download.partPath = (std::filesystem::path(downloadDirectory_) /
+                             (name + "." + storage::toHex(id).substr(0, 16) + ".part")).string();
+        download.file = std::make_shared<FileHandle>(
+            ::open(download.partPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644));
+        if (!download.file->isOpen() ||
+            ::ftruncate(download.file->fd(), static_cast<off_t>(manifest.getSize())) != 0) {
+            peer->sendFrame(makeIdFrame(FrameType::FILE_CANCEL, id));
+            return;
+        }
+        download.manifest = std::move(manifest);
+
+        std::vector<std::uint32_t> lengths(download.manifest.chunkCount());
+        for (std::size_t i = 0; i < lengths.size(); ++i) {
+            lengths[i] = download.manifest.chunkLength(i);
+        }
+        download.scheduler.emplace(std::move(lengths), reuseLocalChunks(download));
+        std::cout << "Receiving file " << name << " (" << download.manifest.getSize() << " bytes) from "
+                  << download.peerID << ", " << download.bytesDone << " bytes already present\n";
+
+        Download& stored = downloads_[id] = std::move(download);
+        stored.sources[peer.get()] = peer;
+        stored.scheduler->updateSource(peer.get(), std::vector<bool>(stored.manifest.chunkCount(), true));
+        if (stored.scheduler->done()) {
+            finishDownload(id, "complete");
+            return;
+        }
+        requestChunks(id, stored);
+
+        if (peerSource_) {
+            for (const auto& other : peerSource_()) {
+                if (other != peer) {
+                    other->sendFrame(makeIdFrame(FrameType::FILE_QUERY, id));
+                }
+            }
+        }
+    }
+
+    // Serves requested chunks of a file held completely or in part.
+    // If a partial holder is asked for chunks it lacks, it answers with its current bitfield instead.
+    void FileTransferManager::handleChunkRequest(const std::shared_ptr<Peer>& peer, std::string_view payload) {
+        message::ByteReader reader(payload);
+        storage::Digest id = readDigest(reader);
+        std::uint64_t count = reader.readVarint();
+        const message::Manifest* manifest = nullptr;
+        const ChunkScheduler* partial = nullptr;
+        if (auto it = manifests_.find(id); it != manifests_.end()) {
+            manifest = &it->second;
+        } else if (auto download = downloads_.find(id); download != downloads_.end()) {
+            manifest = &download->second.manifest;
+            partial = &*download->second.scheduler;
+        } else {
+            peer->sendFrame(makeIdFrame(FrameType::FILE_CANCEL, id));
+            return;
+        }
+        Upload& upload = uploads_[UploadKey{peer.get(), id}];
+        if (upload.peerID.empty()) {
+            upload.peerID = peer->getPeerID();
+            upload.name = manifest->getName();
+            upload.size = manifest->getSize();
+        }
+        bool lacking = false;
+        for (std::uint64_t i = 0; i < count; ++i) {
+            std::uint64_t index = reader.readVarint();
+            if (index >= manifest->chunkCount()) {
+                continue;
+            }
+            auto chunk = static_cast<std::size_t>(index);
+            if ((partial && !partial->has(chunk)) || !sendChunk(peer, id, chunk, *manifest)) {
+                lacking = true;
+                continue;
+            }
+            upload.bytesSent += manifest->chunkLength(chunk);
+        }
+        if (!lacking) {
+            return;
+        }
+        if (partial) {
+            sendHave(peer, id, partial->have());
+        } else {
+            peer->sendFrame(makeIdFrame(FrameType::FILE_CANCEL, id));
+            finishUpload(UploadKey{peer.get(), id}, "failed (file changed)");
+        }
+    }
+
+    // Verifies a chunk from any source of the download, writes and indexes it, and requests more.
+    void FileTransferManager::handleChunkData(const std::shared_ptr<Peer>& peer, std::string_view payload) {
+        message::ByteReader reader(payload);
+        storage::Digest id = readDigest(reader);
+        std::uint64_t index = reader.readVarint();
+        std::string_view data = reader.readRaw(reader.remaining());
+
+        auto it = downloads_.find(id);
+        if (it == downloads_.end() || !it->second.sources.count(peer.get()) ||
+            index >= it->second.manifest.chunkCount()) {
+            return;
+        }
+        Download& download = it->second;
+        ChunkScheduler& scheduler = *download.scheduler;
+        auto chunk = static_cast<std::size_t>(index);
+        auto now = ChunkScheduler::Clock::now();
+        const message::Manifest& manifest = download.manifest;
+        storage::ChunkLocation target{download.partPath, manifest.chunkOffset(chunk), manifest.chunkLength(chunk)};
+
+        if (scheduler.has(chunk)) {
+            // A duplicate from endgame; it still counts towards the source's throughput.
+            scheduler.completed(peer.get(), chunk, now);
+        } else if (data.size() != target.length || storage::sha256(data) != manifest.chunkHash(chunk)) {
+            scheduler.failed(peer.get(), chunk);
+            if (++download.failures[peer.get()] > MAX_CHUNK_FAILURES) {
+                peer->sendFrame(makeIdFrame(FrameType::FILE_CANCEL, id));
+                if (!removeSource(id, download, peer.get(), "failed (corrupt chunks)")) {
+                    return;
+                }
+            }
+        } else if (!writeAt(download.file->fd(), data, target.offset)) {
+            for (const auto& [source, weak] : download.sources) {
+                if (auto sourcePeer = weak.lock()) {
+                    sourcePeer->sendFrame(makeIdFrame(FrameType::FILE_CANCEL, id));
+                }
+            }
+            finishDownload(id, "failed (write error)");
+            return;
+        } else {
+            store_.add(manifest.chunkHash(chunk), target);
+            scheduler.completed(peer.get(), chunk, now);
+            download.bytesDone += target.length;
+            if (++download.chunksSinceHave >= HAVE_INTERVAL) {
+                download.chunksSinceHave = 0;
+                for (const auto& [interested, weak] : download.interested) {
+                    if (auto interestedPeer = weak.lock()) {
+                        sendHave(interestedPeer, id, scheduler.have());
+                    }
+                }
+            }
+        }
+
+        if (scheduler.done()) {
+            finishDownload(id, "complete");
+            return;
+        }
+        requestChunks(id, download);
+    }
+
+    // Marks an upload complete once the receiver holds every chunk.
+    void FileTransferManager::handleDone(const std::shared_ptr<Peer>& peer, std::string_view payload) {
+        message::ByteReader reader(payload);
+        storage::Digest id = readDigest(reader);
+        finishUpload(UploadKey{peer.get(), id}, "complete");
+    }
+
+    // Stops the upload the peer declined or aborted, and drops the peer as a source of the download.
+    void FileTransferManager::handleCancel(const std::shared_ptr<Peer>& peer, std::string_view payload) {
+        message::ByteReader reader(payload);
+        storage::Digest id = readDigest(reader);
+        finishUpload(UploadKey{peer.get(), id}, "cancelled by peer");
+        auto it = downloads_.find(id);
+        if (it != downloads_.end() && it->second.sources.count(peer.get()) &&
+            removeSource(id, it->second, peer.get(), "cancelled by peer")) {
+            requestChunks(id, it->second);
+        }
+    }
+
+    // Answers an availability query for a file held completely or in part.
+    // A peer asking about a file being downloaded here is downloading it too: it is sent
+    // updates as chunks arrive, and asked in turn for its own chunks unless already a source.
+    void FileTransferManager::handleQuery(const std::shared_ptr<Peer>& peer, std::string_view payload) {
+        message::ByteReader reader(payload);
+        storage::Digest id = readDigest(reader);
+        if (auto it = manifests_.find(id); it != manifests_.end()) {
+            sendHave(peer, id, std::vector<bool>(it->second.chunkCount(), true));
+            return;
+        }
+        auto it = downloads_.find(id);
+        if (it == downloads_.end()) {
+            return;
+        }
+        Download& download = it->second;
+        download.interested[peer.get()] = peer;
+        sendHave(peer, id, download.scheduler->have());
+        if (!download.sources.count(peer.get())) {
+            peer->sendFrame(makeIdFrame(FrameType::FILE_QUERY, id));
+        }
+    }
+
+    // Adds or updates a source of a download from its bitfield. An update for a download that
+    // just finished is ignored; one that does not cover exactly the file's chunks is malformed.
+    void FileTransferManager::handleHave(const std::shared_ptr<Peer>& peer, std::string_view payload) {
+        message::ByteReader reader(payload);
+        storage::Digest id = readDigest(reader);
+        auto it = downloads_.find(id);
+        if (it == downloads_.end()) {
+            return;
+        }
+        std::vector<bool> available = readBitfield(reader);
+        if (available.size() != it->second.manifest.chunkCount()) {
+            throw std::runtime_error("Bitfield does not match the file's chunk count");
+        }
+        Download& download = it->second;
+        download.sources[peer.get()] = peer;
+        download.scheduler->updateSource(peer.get(), available);
+        requestChunks(id, download);
+    }
+
+    // Checks each chunk of the manifest against the store. A chunk already verified in the
+    // partial file is kept; one held elsewhere is copied in; the rest are left to download.
+    std::vector<bool> FileTransferManager::reuseLocalChunks(Download& download) {
+        const message::Manifest& manifest = download.manifest;
+        std::vector<bool> have(manifest.chunkCount(), false);
+        std::string buffer;
+        for (std::size_t i = 0; i < manifest.chunkCount(); ++i) {
+            const storage::Digest& hash = manifest.chunkHash(i);
+            storage::ChunkLocation target{download.partPath, manifest.chunkOffset(i), manifest.chunkLength(i)};
+            if (store_.contains(hash, target) && store_.verify(hash, target)) {
+                have[i] = true;
+                download.bytesDone += target.length;
+            } else if (store_.read(hash, buffer) && writeAt(download.file->fd(), buffer, target.offset)) {
+                store_.add(hash, target);
+                have[i] = true;
+                download.bytesDone += target.length;
+                download.bytesReused += target.length;
+            }
+        }
+        return have;
+    }
+
+    // Drops and cancels stalled sources before releasing overdue requests, which would
+    // otherwise hide what they owe; then lets each source, fastest first, fill its window.
+    void FileTransferManager::requestChunks(const storage::Digest& id, Download& download) {
+        ChunkScheduler& scheduler = *download.scheduler;
+        auto now = ChunkScheduler::Clock::now();
+        for (ChunkScheduler::Source source : scheduler.stalled(now)) {
+            if (auto peer = download.sources.at(source).lock()) {
+                peer->sendFrame(makeIdFrame(FrameType::FILE_CANCEL, id));
+            }
+            if (!removeSource(id, download, source, "interrupted (sources stopped responding)")) {
+                return;
+            }
+        }
+        scheduler.releaseOverdue(now);
+        for (ChunkScheduler::Source source : scheduler.sources()) {
+            auto peer = download.sources.at(source).lock();
+            if (!peer) {
+                continue;
+            }
+            std::vector<std::size_t> batch = scheduler.next(source, now);
+            if (batch.empty()) {
+                continue;
+            }
+            std::string payload;
+            putDigest(payload, id);
+            message::putVarint(payload, batch.size());
+            for (std::size_t index : batch) {
+                message::putVarint(payload, index);
+            }
+            peer->sendFrame(makeSharedFrame(FrameType::CHUNK_REQUEST, payload));
+        }
+    }
+
+    // Downloads are collected first, as requesting chunks may finish them.
+    void FileTransferManager::tick() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<storage::Digest> downloadIds;
+        for (const auto& [id, download] : downloads_) {
+            downloadIds.push_back(id);
+        }
+        for (const auto& id : downloadIds) {
+            auto it = downloads_.find(id);
+            if (it != downloads_.end() && it->second.scheduler) {
+                requestChunks(id, it->second);
+            }
+        }
+    }
+
+    // Drops a source; a download left without sources is finished, keeping its partial file.
+    bool FileTransferManager::removeSource(const storage::Digest& id, Download& download, const Peer* source,
+                                           const std::string& state) {
+        download.sources.erase(source);
+        download.failures.erase(source);
+        download.scheduler->removeSource(source);
+        if (download.sources.empty()) {
+            finishDownload(id, state);
+            return false;
+        }
+        return true;
+    }
+
+    // Sends the peer a bitfield of the chunks of a file held locally.
+    void FileTransferManager::sendHave(const std::shared_ptr<Peer>& peer, const storage::Digest& id,
+                                       const std::vector<bool>& have) {
+        std::string payload;
+        putDigest(payload, id);
+        putBitfield(payload, have);
+        peer->sendFrame(makeSharedFrame(FrameType::FILE_HAVE, payload));
+    }
+
+    // Sends a chunk with sendfile() from its indexed location; if that location no longer holds
+    // enough bytes, falls back to a verified read from any other location.
+    bool FileTransferManager::sendChunk(const std::shared_ptr<Peer>& peer, const storage::Digest& id,
+                                        std::size_t index, const message::Manifest& manifest) {
+        std::string prefix;
+        putDigest(prefix, id);
+        message::putVarint(prefix, index);
+        std::uint32_t length = manifest.chunkLength(index);
+        std::string header(FRAME_HEADER_SIZE, '\0');
+        writeFrameHeader(header.data(), FrameType::CHUNK_DATA, static_cast<std::uint32_t>(prefix.size() + length));
+        header += prefix;
+
+        const storage::Digest& hash = manifest.chunkHash(index);
+        if (auto location = store_.find(hash)) {
+            auto file = openShared(location->path);
+            if (file && location->length == length && file->size() >= location->offset + length) {
+                peer->sendFileSegment(std::make_shared<const std::string>(std::move(header)), file,
+                                      location->offset, length);
+                return true;
+            }
+        }
+        std::string data;
+        if (!store_.read(hash, data)) {
+            return false;
+        }
+        header += data;
+        peer->sendFrame(std::make_shared<const std::string>(std::move(header)));
+        return true;
+    }
+
+    // Returns an open descriptor for path, keeping a bounded set open between requests.
+    std::shared_ptr<FileHandle> FileTransferManager::openShared(const std::string& path) {
+        auto it = openFiles_.find(path);
+        if (it != openFiles_.end()) {
+            return it->second;
+        }
+        auto file = std::make_shared<FileHandle>(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+        if (!file->isOpen()) {
+            return nullptr;
+        }
+        if (openFiles_.size() >= MAX_OPEN_FILES) {
+            openFiles_.clear();
+        }
+        openFiles_[path] = file;
+        return file;
+    }
+
+    // Moves an upload to the finished list.
+    void FileTransferManager::finishUpload(const UploadKey& key, const std::string& state) {
+        auto it = uploads_.find(key);
+        if (it == uploads_.end()) {
+            return;
+        }
+        const Upload& upload = it->second;
+        std::cout << "File transfer " << upload.name << " to " << upload.peerID << ": " << state << "\n";
+        rememberFinished(TransferInfo{true, upload.peerID, upload.name, upload.size, upload.bytesSent, 0, state});
+        uploads_.erase(it);
+    }
+
+    // Moves a download to the finished list. A complete file is renamed into place,
+    // its chunks re-indexed under the final name, and it becomes available to serve;
+    // its sources are told it is done and interested peers that it is complete.
+    // An unfinished partial file is kept so the next offer of the same file resumes it.
+    void FileTransferManager::finishDownload(const storage::Digest& id, const std::string& state) {
+        auto it = downloads_.find(id);
+        if (it == downloads_.end()) {
+            return;
+        }
+        Download& download = it->second;
+        download.file.reset();
+        const std::string& name = download.name;
+        if (state == "complete") {
+            std::string finalPath = uniquePath(downloadDirectory_, name);
+            std::error_code ec;
+            std::filesystem::rename(download.partPath, finalPath, ec);
+            if (!ec) {
+                store_.relocate(download.partPath, finalPath);
+            }
+            for (const auto& [source, weak] : download.sources) {
+                if (auto peer = weak.lock()) {
+                    peer->sendFrame(makeIdFrame(FrameType::FILE_DONE, id));
+                }
+            }
+            std::vector<bool> all(download.manifest.chunkCount(), true);
+            for (const auto& [interested, weak] : download.interested) {
+                if (auto peer = weak.lock()) {
+                    sendHave(peer, id, all);
+                }
+            }
+            manifests_[id] = download.manifest;
+            std::cout << "File received: " << finalPath << "\n";
+        } else {
+            std::cout << "File transfer " << name << " from " << download.peerID << ": " << state << "\n";
+        }
+        rememberFinished(TransferInfo{false, download.peerID, name, download.manifest.getSize(),
+                                      download.bytesDone, download.bytesReused, state});
+        downloads_.erase(it);
+    }
+
+    // Records a finished transfer, keeping only the most recent ones.
+    void FileTransferManager::rememberFinished(TransferInfo info) {
+        finished_.push_back(std::move(info));
+        while (finished_.size() > MAX_FINISHED) {
+            finished_.pop_front();
+        }
+    }
+
+}  // namespace network
@@ -0,0 +1,124 @@
+#include "network/Frame.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace network {
+
+    namespace {
+
+        // Initial receive capacity; also the minimum size of a single socket read.
+        constexpr std::size_t INITIAL_CAPACITY = 64 * 1024;
+
+        // Reads a 4-byte big-endian length.
+        std::uint32_t readLength(const char* in) {
+            auto b = reinterpret_cast<const unsigned char*>(in);
+            return (static_cast<std::uint32_t>(b[0]) << 24) | (static_cast<std::uint32_t>(b[1]) << 16) |
+                   (static_cast<std::uint32_t>(b[2]) << 8) | static_cast<std::uint32_t>(b[3]);
+        }
+
+    }  // namespace
+
+    // Writes the big-endian payload length and the frame type.
+    void writeFrameHeader(char* out, FrameType type, std::uint32_t length) {
+        out[0] = static_cast<char>((length >> 24) & 0xFF);
+        out[1] = static_cast<char>((length >> 16) & 0xFF);
+        out[2] = static_cast<char>((length >> 8) & 0xFF);
+        out[3] = static_cast<char>(length & 0xFF);
+        out[4] = static_cast<char>(type);
+    }
+
+    // Encodes a payload into a new string holding the header followed by the payload.
+    std::string encodeFrame(FrameType type, std::string_view payload) {
+        std::string frame(FRAME_HEADER_SIZE + payload.size(), '\0');
+        writeFrameHeader(frame.data(), type, static_cast<std::uint32_t>(payload.size()));
+        std::memcpy(frame.data() + FRAME_HEADER_SIZE, payload.data(), payload.size());
+        return frame;
+    }
+
+    // Encodes a payload once into an immutable, reference-counted frame.
+    SharedFrame makeSharedFrame(FrameType type, std::string_view payload) {
+        return std::make_shared<const std::string>(encodeFrame(type, payload));
+    }
+
+    // Constructs an empty buffer with the initial capacity preallocated.
+    FrameBuffer::FrameBuffer(std::size_t maxFrameSize)
+        : storage_(INITIAL_CAPACITY),
+          initialCapacity_(INITIAL_CAPACITY),
+          maxFrameSize_(maxFrameSize) {}
+
+    // Returns a writable region for the next read.
+    // Reuses consumed space first and only grows when a large frame needs it.
+    std::pair<char*, std::size_t> FrameBuffer::prepare(std::size_t minSize) {
+        std::size_t needed = std::max(minSize, missingForCurrentFrame());
+        if (storage_.size() - tail_ < needed) {
+            // Slide the unread tail (usually a partial frame) to the front.
+            std::size_t unread = tail_ - head_;
+            if (head_ > 0) {
+                std::memmove(storage_.data(), storage_.data() + head_, unread);
+                head_ = 0;
+                tail_ = unread;
+            }
+            if (storage_.size() - tail_ < needed) {
+                storage_.resize(std::max(storage_.size() * 2, tail_ + needed));
+            }
+        }
+        return {storage_.data() + tail_, storage_.size() - tail_};
+    }
+
+    // Marks bytes written into the prepared region as readable.
+    void FrameBuffer::commit(std::size_t bytes) {
+        tail_ += bytes;
+    }
+
+    // Extracts the next complete frame without copying its payload.
+    // Resets to the initial capacity once drained after an oversized frame.
+    bool FrameBuffer::nextFrame(FrameView& frame) {
+        std::size_t unread = tail_ - head_;
+        if (unread < FRAME_HEADER_SIZE) {
+            if (unread == 0) {
+                head_ = tail_ = 0;
+                if (storage_.size() > initialCapacity_ * 4) {
+                    storage_.resize(initialCapacity_);
+                    storage_.shrink_to_fit();
+                }
+            }
+            return false;
+        }
+        const char* header = storage_.data() + head_;
+        std::size_t length = readLength(header);
+        if (length > maxFrameSize_) {
+            throw std::length_error("Frame of " + std::to_string(length) + " bytes exceeds limit");
+        }
+        if (unread < FRAME_HEADER_SIZE + length) {
+            return false;
+        }
+        frame.type = static_cast<FrameType>(header[4]);
+        frame.payload = std::string_view(header + FRAME_HEADER_SIZE, length);
+        head_ += FRAME_HEADER_SIZE + length;
+        return true;
+    }
+
+    // Sets the maximum accepted payload size.
+    void FrameBuffer::setMaxFrameSize(std::size_t maxFrameSize) {
+        maxFrameSize_ = maxFrameSize;
+    }
+
+    // Returns the number of buffered bytes not yet extracted as frames.
+    std::size_t FrameBuffer::pending() const {
+        return tail_ - head_;
+    }
+
+    // Returns the bytes still missing for the frame at the read position.
+    // Lets prepare() size a single read to cover a large payload in full.
+    std::size_t FrameBuffer::missingForCurrentFrame() const {
+        std::size_t unread = tail_ - head_;
+        if (unread < FRAME_HEADER_SIZE) {
+            return 0;
+        }
+        std::size_t length = std::min<std::size_t>(readLength(storage_.data() + head_), maxFrameSize_);
+        std::size_t total = FRAME_HEADER_SIZE + length;
+        return total > unread ? total - unread : 0;
+    }
+
+}  // namespace network
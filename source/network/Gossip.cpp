@@ -0,0 +1,99 @@
+#include "network/Gossip.h"
+#include "network/Handshake.h"
+#include "network/Peer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+
+namespace network {
+
+    namespace {
+
+        // Seen-set sizing: 2^23 bits (1 MiB) per filter keeps false positives, which would
+        // drop an unseen message at this node, below one in ten million at full capacity.
+        constexpr unsigned SEEN_BITS_LOG2 = 23;
+        constexpr std::size_t SEEN_CAPACITY = 100000;
+
+        // How long an ID stays in the current filter; it is remembered for one to two windows.
+        constexpr auto SEEN_WINDOW = std::chrono::minutes(2);
+
+    }  // namespace
+
+    // Seeds the ID generator from the system's random source.
+    GossipRouter::GossipRouter()
+        : seen_(SEEN_BITS_LOG2, SEEN_CAPACITY, SEEN_WINDOW), random_(std::random_device{}()) {}
+
+    // Sets the fan-out and TTL; a TTL of zero would never leave this node, so it is raised to one.
+    void GossipRouter::setOptions(const Options& options) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        options_ = options;
+        options_.ttl = std::max<std::uint8_t>(1, options_.ttl);
+    }
+
+    // Returns the current options.
+    GossipRouter::Options GossipRouter::options() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return options_;
+    }
+
+    // Layout: 16-byte message ID, 1-byte TTL, encoded message.
+    SharedFrame GossipRouter::originate(std::string_view message) {
+        std::string payload(HEADER_SIZE, '\0');
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            MessageId id;
+            do {
+                for (std::size_t i = 0; i < id.size(); i += sizeof(std::uint64_t)) {
+                    std::uint64_t bits = random_();
+                    std::memcpy(id.data() + i, &bits, sizeof(bits));
+                }
+            } while (!seen_.insert(id, SeenFilter::Clock::now()));
+            std::memcpy(payload.data(), id.data(), id.size());
+            payload[id.size()] = static_cast<char>(options_.ttl);
+        }
+        payload.append(message);
+        return makeSharedFrame(FrameType::GOSSIP, payload);
+    }
+
+    // The relayed frame is the received payload with its TTL lowered, so the ID stays the same
+    // on every hop and nodes reached over several paths deliver the message once.
+    bool GossipRouter::receive(std::string_view payload, std::string_view& message, SharedFrame& relay) {
+        if (payload.size() <= HEADER_SIZE) {
+            return false;
+        }
+        MessageId id;
+        std::memcpy(id.data(), payload.data(), id.size());
+        auto ttl = static_cast<std::uint8_t>(payload[id.size()]);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!seen_.insert(id, SeenFilter::Clock::now())) {
+                return false;
+            }
+        }
+        message = payload.substr(HEADER_SIZE);
+        relay.reset();
+        if (ttl > 1) {
+            std::string forwarded(payload);
+            forwarded[id.size()] = static_cast<char>(ttl - 1);
+            relay = makeSharedFrame(FrameType::GOSSIP, forwarded);
+        }
+        return true;
+    }
+
+    // Samples without replacement, so no peer gets the same message twice from this node.
+    std::vector<std::shared_ptr<Peer>> GossipRouter::pickTargets(std::vector<std::shared_ptr<Peer>> peers,
+                                                                 const Peer* exclude) {
+        peers.erase(std::remove_if(peers.begin(), peers.end(),
+                                   [exclude](const std::shared_ptr<Peer>& peer) {
+                                       return peer.get() == exclude || !peer->isConnected() ||
+                                              !(peer->capabilities() & CAPABILITY_GOSSIP);
+                                   }),
+                    peers.end());
+        std::vector<std::shared_ptr<Peer>> targets;
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::sample(peers.begin(), peers.end(), std::back_inserter(targets), options_.fanout, random_);
+        return targets;
+    }
+
+}  // namespace network
@@ -0,0 +1,28 @@
+#include "network/Handshake.h"
+#include "message/Codec.h"
+
+namespace network {
+
+    // Appends the binary encoding to out.
+    void Hello::encode(std::string& out) const {
+        out.push_back(static_cast<char>(version));
+        message::putBytes(out, listeningAddress);
+        message::putVarint(out, capabilities);
+        message::putBytes(out, keyShare);
+    }
+
+    // Decodes a handshake; fields appended by later versions are ignored, and the key share
+    // is optional since earlier versions do not send it.
+    Hello Hello::decode(std::string_view data) {
+        message::ByteReader reader(data);
+        Hello hello;
+        hello.version = reader.readByte();
+        hello.listeningAddress = std::string(reader.readBytes());
+        hello.capabilities = reader.readVarint();
+        if (reader.remaining() > 0) {
+            hello.keyShare = std::string(reader.readBytes());
+        }
+        return hello;
+    }
+
+}  // namespace network
@@ -1,11 +1,23 @@
 #include "network/NetworkManager.h"
 #include "log/LogManager.h"
 #include "message/Message.h"
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 #include <thread>
 
 namespace network {
 
+    namespace {
+
+        // Resolution of the keepalive timer wheel.
+        constexpr auto KEEPALIVE_TICK = std::chrono::milliseconds(250);
+
+        // How often downloads are rechecked for overdue requests and stalled sources.
+        constexpr auto TRANSFER_CHECK_INTERVAL = std::chrono::seconds(1);
+
+    }  // namespace
+
     // Returns the singleton instance of NetworkManager.
     NetworkManager& NetworkManager::instance() {
         static NetworkManager instance;
@@ -13,7 +25,20 @@ namespace network {
     }
 
     // Constructs NetworkManager with initialized acceptor and I/O context.
-    NetworkManager::NetworkManager() : acceptor_(ioContext_) {}
+    // Defaults to one I/O thread per hardware core. File transfers may query every connected peer.
+    NetworkManager::NetworkManager()
+        : acceptor_(ioContext_),
+          peers_(std::make_shared<const PeerMap>()),
+          keepaliveStrand_(boost::asio::make_strand(ioContext_)),
+          keepaliveTimer_(keepaliveStrand_),
+          wheel_(KEEPALIVE_TICK, TimerWheel::Clock::now()),
+          decodeFailures_(metrics::Registry::instance().counter(
+              "p2p_decode_failures_total", "Received messages and announcements that failed to decode")),
+          ioThreadCount_(std::max(1u, std::thread::hardware_concurrency())) {
+        transfers_.setPeerSource([this]() { return snapshotPeers(); });
+        metrics::Registry::instance().addCollector(
+            [this](metrics::TextWriter& out) { collectPeerMetrics(out); });
+    }
 
     // Cleans up by shutting down all connections.
     NetworkManager::~NetworkManager() {
@@ -54,23 +79,33 @@ namespace network {
             ownAddress_ = "unknown:" + std::to_string(port);
         }
 
-        // Start accepting connections and run I/O context in a detached thread.
+        // Start the receive workers, then accept connections and run the I/O context on the
+        // thread pool. Each peer's socket is bound to its own strand, so its handlers stay serialized.
+        pipeline_.start(ioThreadCount_, [this](std::vector<InboundFrame>& batch) { handleInbound(batch); });
+        boost::asio::post(keepaliveStrand_, [this]() {
+            runKeepaliveTimer();
+            scheduleTransferCheck();
+        });
         doAccept();
-        std::thread([this]() { ioContext_.run(); }).detach();
+        for (std::size_t i = 0; i < ioThreadCount_; ++i) {
+            ioThreads_.emplace_back([this]() { ioContext_.run(); });
+        }
+    }
+
+    // Sets the number of threads running the I/O context.
+    void NetworkManager::setIoThreads(std::size_t count) {
+        ioThreadCount_ = std::max<std::size_t>(1, count);
     }
 
     // Connects to a peer at the given IP and port.
     // Skips if already connected to the peer.
     void NetworkManager::connectToPeer(const std::string& ip, unsigned short port) {
         std::string peerAddr = ip + ":" + std::to_string(port);
-        {
-            std::lock_guard<std::mutex> lock(peersMutex_);
-            if (peers_.count(peerAddr)) {
-                return;
-            }
+        if (loadPeers()->count(peerAddr)) {
+            return;
         }
 
-        auto socket = std::make_shared<tcp::socket>(ioContext_);
+        auto socket = std::make_shared<tcp::socket>(boost::asio::make_strand(ioContext_));
         tcp::endpoint endpoint(boost::asio::ip::address::from_string(ip), port);
 
         socket->async_connect(endpoint, [this, socket, peerAddr](const boost::system::error_code& ec) {
@@ -79,65 +114,157 @@ namespace network {
                 return;
             }
 
-            // Create and register peer.
+            // Create the peer and queue its handshake before registering it, so no frame sent
+            // through the peer table can reach the socket ahead of the HELLO.
             auto peer = std::make_shared<Peer>(socket, peerAddr);
-            {
-                std::lock_guard<std::mutex> lock(peersMutex_);
-                peers_[peerAddr] = peer;
-            }
-
-            // Set up message handler.
-            peer->onMessage([this, peer](const std::string& msg) {
-                try {
-                    message::Message m = message::Message::decode(msg);
-                    // Override type to RECEIVED for all incoming messages.
-                    // This ensures consistency regardless of sender's encoding.
-                    m = message::Message(m.getPeerID(), m.getTopic(), m.getContent(), message::MessageType::RECEIVED);
-
-                    // Update peerID if the sender's listening address differs.
-                    {
-                        std::lock_guard<std::mutex> lock(peersMutex_);
-                        if (m.getPeerID() != peer->getPeerID()) {
-                            peers_.erase(peer->getPeerID());
-                            peers_[m.getPeerID()] = peer;
-                            peer->setPeerID(m.getPeerID());
-                        }
-                    }
-                    logging::LogManager::instance().appendMessage(m);
-                    std::cout << "Received from " << m.getPeerID()
-                              << " | Topic: " << m.getTopic()
-                              << " | Content: " << m.getContent() << "\n";
-                } catch (...) {
-                    // Ignore parsing errors to prevent crashes from malformed messages.
-                }
+            attachPeer(peer, false);
+            updatePeers([&](PeerMap& peers) {
+                peers[peerAddr] = peer;
+                return true;
             });
-
-            // Set up disconnect handler.
-            peer->onDisconnect([this, peer]() {
-                removePeer(peer->getPeerID());
-                std::cout << "Peer disconnected\n";
-            });
-
             peer->startReceiving();
             std::cout << "Connected to peer: " << peerAddr << "\n";
         });
     }
 
     // Sends a message to a specific peer identified by peerID.
-    void NetworkManager::sendMessage(const std::string& peerID, const std::string& message) {
-        std::lock_guard<std::mutex> lock(peersMutex_);
-        auto it = peers_.find(peerID);
-        if (it != peers_.end()) {
-            it->second->sendMessage(message);
+    // The peer is looked up in the current snapshot without locking.
+    SendStatus NetworkManager::sendMessage(const std::string& peerID, const std::string& message) {
+        auto peers = loadPeers();
+        auto it = peers->find(peerID);
+        if (it == peers->end()) {
+            return SendStatus::DROPPED;
         }
+        return it->second->sendMessage(message);
     }
 
-    // Broadcasts a message to all connected peers.
-    void NetworkManager::broadcastMessage(const std::string& message) {
+    // Broadcasts a message to the peers subscribed to its topic.
+    // Encodes the frame once and shares it across every peer's write queue.
+    // Each peer applies its own limits, so one slow peer does not hold up the others.
+    // Only the topic is read from the message; one that cannot be parsed goes to every peer.
+    std::size_t NetworkManager::broadcastMessage(const std::string& message) {
+        std::string_view topic;
+        bool filtered = false;
+        try {
+            message::MessageView view;
+            message::Message::decodeView(message, view);
+            topic = view.topic;
+            filtered = true;
+        } catch (...) {
+        }
+        auto interested = subscriptions_.match(topic);
+        SharedFrame frame = makeSharedFrame(FrameType::MESSAGE, message);
+        std::size_t backlogged = 0;
+        auto peers = loadPeers();
+        for (const auto& [id, peer] : *peers) {
+            if (filtered && !interested.wants(peer.get())) {
+                continue;
+            }
+            if (peer->sendFrame(frame) != SendStatus::QUEUED) {
+                ++backlogged;
+            }
+        }
+        return backlogged;
+    }
+
+    // Starts a gossip round from this node. The message is only handed to the first peers;
+    // how far it gets depends on the network's connectivity and the TTL.
+    std::size_t NetworkManager::gossipMessage(const std::string& message) {
+        SharedFrame frame = gossip_.originate(message);
+        std::size_t sent = 0;
+        for (const auto& peer : gossip_.pickTargets(snapshotPeers(), nullptr)) {
+            if (peer->sendFrame(frame) != SendStatus::DROPPED) {
+                ++sent;
+            }
+        }
+        return sent;
+    }
+
+    // Sets the gossip fan-out and TTL.
+    void NetworkManager::setGossip(std::size_t fanout, std::uint8_t ttl) {
+        gossip_.setOptions(GossipRouter::Options{fanout, ttl});
+    }
+
+    // Adds a valid pattern and announces the new set.
+    bool NetworkManager::subscribeTopic(const std::string& pattern) {
+        if (!isValidTopicPattern(pattern)) {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(peersMutex_);
+            if (std::find(localTopics_.begin(), localTopics_.end(), pattern) != localTopics_.end()) {
+                return false;
+            }
+            localTopics_.push_back(pattern);
+        }
+        for (const auto& peer : snapshotPeers()) {
+            announceSubscriptions(peer);
+        }
+        return true;
+    }
+
+    // Removes a pattern and announces the new set.
+    bool NetworkManager::unsubscribeTopic(const std::string& pattern) {
+        {
+            std::lock_guard<std::mutex> lock(peersMutex_);
+            auto it = std::find(localTopics_.begin(), localTopics_.end(), pattern);
+            if (it == localTopics_.end()) {
+                return false;
+            }
+            localTopics_.erase(it);
+        }
+        for (const auto& peer : snapshotPeers()) {
+            announceSubscriptions(peer);
+        }
+        return true;
+    }
+
+    // Returns the topic patterns this node is subscribed to.
+    std::vector<std::string> NetworkManager::listSubscriptions() const {
         std::lock_guard<std::mutex> lock(peersMutex_);
-        for (auto& [id, peer] : peers_) {
-            peer->sendMessage(message);
+        return localTopics_;
+    }
+
+    // Sets the keepalive interval and idle timeout; the timeout is at least the interval.
+    void NetworkManager::setKeepalive(std::chrono::seconds interval, std::chrono::seconds timeout) {
+        keepaliveInterval_ = std::max(interval, std::chrono::seconds(1));
+        keepaliveTimeout_ = std::max<std::chrono::steady_clock::duration>(timeout, keepaliveInterval_);
+    }
+
+    // Sets whether traffic is encrypted with peers that support it.
+    void NetworkManager::setEncryption(bool enabled) {
+        encryption_ = enabled;
+    }
+
+    // Sets whether messages are compressed for peers that accept it.
+    void NetworkManager::setCompression(bool enabled) {
+        compression_ = enabled;
+    }
+
+    // Sets the outbound queue limits applied to every peer.
+    void NetworkManager::setSendLimits(const SendLimits& limits) {
+        sendLimits_ = limits;
+    }
+
+    // Offers a file to a specific peer identified by peerID.
+    bool NetworkManager::sendFile(const std::string& peerID, const std::string& path) {
+        auto peers = loadPeers();
+        auto it = peers->find(peerID);
+        if (it == peers->end()) {
+            return false;
         }
+        transfers_.offerFile(it->second, path);
+        return true;
+    }
+
+    // Returns descriptions of active and recently finished file transfers.
+    std::vector<std::string> NetworkManager::listTransferInfo() const {
+        return transfers_.listTransferInfo();
+    }
+
+    // Sets the maximum payload size accepted in a single frame from new peers.
+    void NetworkManager::setMaxFrameSize(std::size_t maxFrameSize) {
+        maxFrameSize_ = maxFrameSize;
     }
 
     // Retrieves the current listening address (IP:port) of the server.
@@ -145,16 +272,23 @@ namespace network {
         return ownAddress_;
     }
 
+    // Registers a callback for received messages.
+    void NetworkManager::onMessageReceived(std::function<void(const message::Message&)> handler) {
+        std::lock_guard<std::mutex> lock(peersMutex_);
+        messageHandlers_.push_back(std::move(handler));
+    }
+
     // Registers a callback to handle peer disconnection events.
     void NetworkManager::onPeerDisconnected(std::function<void(const std::string&)> handler) {
+        std::lock_guard<std::mutex> lock(peersMutex_);
         peerDisconnectHandler_ = std::move(handler);
     }
 
     // Returns a list of connected peers' information.
     std::vector<std::string> NetworkManager::listPeerInfo() const {
         std::vector<std::string> result;
-        std::lock_guard<std::mutex> lock(peersMutex_);
-        for (const auto& [id, peer] : peers_) {
+        auto peers = loadPeers();
+        for (const auto& [id, peer] : *peers) {
             if (peer) {
                 result.push_back(peer->toString());
             }
@@ -162,73 +296,69 @@ namespace network {
         return result;
     }
 
+    // Returns the connected peers from the current snapshot.
+    std::vector<std::shared_ptr<const Peer>> NetworkManager::listPeers() const {
+        auto peers = loadPeers();
+        std::vector<std::shared_ptr<const Peer>> result;
+        result.reserve(peers->size());
+        for (const auto& [id, peer] : *peers) {
+            if (peer) {
+                result.push_back(peer);
+            }
+        }
+        return result;
+    }
+
     // Shuts down the network manager and closes all connections.
     // Sends "disconnecting" message to peers before closing.
     void NetworkManager::shutdown() {
-        // Close acceptor, ignoring errors for simplicity.
+        // Close acceptor and stop the keepalive timer, ignoring errors for simplicity.
         boost::system::error_code ec;
         acceptor_.close(ec);
+        boost::asio::post(keepaliveStrand_, [this]() { keepaliveTimer_.cancel(); });
 
         // Notify and close all peers.
+        std::shared_ptr<const PeerMap> peers;
         {
             std::lock_guard<std::mutex> lock(peersMutex_);
-            for (auto& [id, peer] : peers_) {
-                if (peer->isConnected()) {
-                    peer->sendMessage("disconnecting");
-                }
+            peers = std::atomic_exchange(&peers_, std::make_shared<const PeerMap>());
+        }
+        for (const auto& [id, peer] : *peers) {
+            if (peer->isConnected()) {
+                peer->sendMessage("disconnecting");
             }
-            peers_.clear();
         }
         ioContext_.stop();
+
+        // Wait for the I/O threads, unless called from one of them.
+        for (auto& thread : ioThreads_) {
+            if (thread.joinable() && thread.get_id() != std::this_thread::get_id()) {
+                thread.join();
+            } else if (thread.joinable()) {
+                thread.detach();
+            }
+        }
+        ioThreads_.clear();
+
+        // Handle what the I/O threads already queued, then stop the receive workers.
+        pipeline_.stop();
     }
 
     // Accepts incoming connections asynchronously.
     // Registers new peers and sets up their message and disconnect handlers.
     void NetworkManager::doAccept() {
-        auto socket = std::make_shared<tcp::socket>(ioContext_);
+        auto socket = std::make_shared<tcp::socket>(boost::asio::make_strand(ioContext_));
         acceptor_.async_accept(*socket, [this, socket](const boost::system::error_code& ec) {
-            if (!ec) {
-                // Use temporary key; will be updated by received message.
-                std::string tempPeerKey = socket->remote_endpoint().address().to_string() + ":" +
-                                          std::to_string(socket->remote_endpoint().port());
+            if (ec == boost::asio::error::operation_aborted || !acceptor_.is_open()) {
+                return;
+            }
+            boost::system::error_code endpointError;
+            auto remote = socket->remote_endpoint(endpointError);
+            if (!ec && !endpointError) {
+                // Use the remote endpoint until the handshake names the listening address.
+                std::string tempPeerKey = remote.address().to_string() + ":" + std::to_string(remote.port());
                 auto peer = std::make_shared<Peer>(socket, tempPeerKey);
-                {
-                    std::lock_guard<std::mutex> lock(peersMutex_);
-                    peers_[tempPeerKey] = peer;
-                }
-
-                // Set up message handler.
-                peer->onMessage([this, peer](const std::string& msg) {
-                    try {
-                        message::Message m = message::Message::decode(msg);
-                        // Override type to RECEIVED for all incoming messages.
-                        // This ensures consistency regardless of sender's encoding.
-                        m = message::Message(m.getPeerID(), m.getTopic(), m.getContent(), message::MessageType::RECEIVED);
-
-                        // Update peerID to the sender's listening address.
-                        {
-                            std::lock_guard<std::mutex> lock(peersMutex_);
-                            if (m.getPeerID() != peer->getPeerID()) {
-                                peers_.erase(peer->getPeerID());
-                                peers_[m.getPeerID()] = peer;
-                                peer->setPeerID(m.getPeerID());
-                            }
-                        }
-                        logging::LogManager::instance().appendMessage(m);
-                        std::cout << "Received from " << m.getPeerID()
-                                  << " | Topic: " << m.getTopic()
-                                  << " | Content: " << m.getContent() << "\n";
-                    } catch (...) {
-                        // Ignore parsing errors to prevent crashes from malformed messages.
-                    }
-                });
-
-                // Set up disconnect handler.
-                peer->onDisconnect([this, peer]() {
-                    removePeer(peer->getPeerID());
-                    std::cout << "Peer disconnected\n";
-                });
-
+                attachPeer(peer, true);
                 peer->startReceiving();
                 std::cout << "Accepted connection from " << tempPeerKey << "\n";
             }
@@ -237,22 +367,350 @@ namespace network {
         });
     }
 
-    // Removes a peer from the peers list upon disconnection.
-    // Sends a "disconnecting" message if the peer is still connected.
-    void NetworkManager::removePeer(const std::string& peerID) {
+    // Copies the peer pointers of the current snapshot.
+    std::vector<std::shared_ptr<Peer>> NetworkManager::snapshotPeers() const {
+        auto peers = loadPeers();
+        std::vector<std::shared_ptr<Peer>> result;
+        result.reserve(peers->size());
+        for (const auto& [id, peer] : *peers) {
+            result.push_back(peer);
+        }
+        return result;
+    }
+
+    // Returns the current peer table snapshot.
+    std::shared_ptr<const NetworkManager::PeerMap> NetworkManager::loadPeers() const {
+        return std::atomic_load(&peers_);
+    }
+
+    // Copies the peer table, applies the change and publishes the copy.
+    // Writers are serialized by the lock, so no change is lost; readers keep the snapshot they loaded.
+    bool NetworkManager::updatePeers(const std::function<bool(PeerMap&)>& change) {
         std::lock_guard<std::mutex> lock(peersMutex_);
-        auto it = peers_.find(peerID);
-        if (it != peers_.end()) {
-            // Check connection status before sending message (best-effort).
-            if (it->second->isConnected()) {
-                boost::system::error_code ignore;
-                it->second->sendMessage("disconnecting");
+        auto peers = std::make_shared<PeerMap>(*peers_);
+        if (!change(*peers)) {
+            return false;
+        }
+        std::atomic_store(&peers_, std::shared_ptr<const PeerMap>(std::move(peers)));
+        return true;
+    }
+
+    // Sends the handshake and sets up frame and disconnect handlers shared by outgoing and
+    // accepted connections. Both call it before the peer enters the peer table, so nothing else
+    // can be queued for it yet and the handshake is its first frame; with encryption on, it
+    // carries a fresh key share and later frames wait for the peer's reply.
+    void NetworkManager::attachPeer(const std::shared_ptr<Peer>& peer, bool accepted) {
+        peer->setMaxFrameSize(maxFrameSize_);
+        peer->setSendLimits(sendLimits_);
+        Hello hello;
+        hello.listeningAddress = ownAddress_;
+        hello.capabilities = LOCAL_CAPABILITIES & ~CAPABILITY_ENCRYPTION;
+        std::shared_ptr<KeyExchange> exchange;
+        if (encryption_) {
+            exchange = std::make_shared<KeyExchange>();
+            hello.capabilities |= CAPABILITY_ENCRYPTION;
+            hello.keyShare = exchange->publicKey();
+        }
+        std::string payload;
+        hello.encode(payload);
+        peer->sendHello(makeSharedFrame(FrameType::HELLO, payload), exchange != nullptr);
+
+        // Set up message handler. The handshake is checked on the I/O thread; every later
+        // frame is handed to the receive pipeline, pausing the peer while its queue is full.
+        // The handlers are stored in the peer, so they hold it weakly; a strong reference
+        // would keep every disconnected peer, and its buffers and streams, alive forever.
+        peer->onMessage([this, weak = std::weak_ptr<Peer>(peer), accepted, exchange](const FrameView& frame) {
+            auto peer = weak.lock();
+            if (!peer) {
+                return true;
+            }
+            if (!peer->handshakeComplete()) {
+                handleHello(peer, frame, accepted, exchange.get());
+                return true;
+            }
+            if (frame.type == FrameType::PING) {
+                peer->sendFrame(makeSharedFrame(FrameType::PONG, {}));
+                return true;
+            }
+            if (frame.type == FrameType::HELLO || frame.type == FrameType::PONG) {
+                return true;
+            }
+            return pipeline_.submit(peer, frame);
+        });
+        watchPeer(peer, keepaliveInterval_);
+
+        // Set up disconnect handler.
+        peer->onDisconnect([this, weak = std::weak_ptr<Peer>(peer)]() {
+            auto peer = weak.lock();
+            if (!peer) {
+                return;
+            }
+            removePeer(peer);
+            subscriptions_.remove(peer.get());
+            transfers_.peerDisconnected(peer);
+            std::cout << "Peer disconnected\n";
+        });
+    }
+
+    // Checks the peer's handshake and fixes its key in the peer table. Outgoing peers keep the
+    // address they were dialed at; accepted peers are registered under the listening address
+    // they announce. A peer opening with any other frame, or with another protocol version, is closed.
+    // Compression is switched on only for peers that announce they accept it. Traffic is
+    // encrypted when both sides sent a key share; a peer without one is served in the clear.
+    void NetworkManager::handleHello(const std::shared_ptr<Peer>& peer, const FrameView& frame, bool accepted,
+                                     const KeyExchange* exchange) {
+        Hello hello;
+        SessionKeys keys;
+        try {
+            if (frame.type != FrameType::HELLO) {
+                throw std::runtime_error("Expected handshake");
+            }
+            hello = Hello::decode(frame.payload);
+            if (hello.version != PROTOCOL_VERSION) {
+                throw std::runtime_error("Unsupported protocol version " + std::to_string(hello.version));
+            }
+            if (exchange && (hello.capabilities & CAPABILITY_ENCRYPTION)) {
+                keys = exchange->derive(hello.keyShare);
+            }
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Protocol error from " << peer->getPeerID() << ": " << e.what() << "\n";
+            peer->close();
+            return;
+        }
+        peer->startSession(std::move(keys));
+        if (accepted && !hello.listeningAddress.empty()) {
+            peer->setPeerID(hello.listeningAddress);
+        }
+        peer->completeHandshake(hello.capabilities);
+        if (compression_ && (hello.capabilities & CAPABILITY_COMPRESSION)) {
+            peer->enableCompression();
+        }
+        if (accepted) {
+            updatePeers([&](PeerMap& peers) {
+                peers[peer->getPeerID()] = peer;
+                return true;
+            });
+        }
+        announceSubscriptions(peer);
+    }
+
+    // Peers that never announce subscriptions are sent every broadcast, so they need none either.
+    void NetworkManager::announceSubscriptions(const std::shared_ptr<Peer>& peer) {
+        if (!(peer->capabilities() & CAPABILITY_TOPICS)) {
+            return;
+        }
+        Subscribe subscribe;
+        {
+            std::lock_guard<std::mutex> lock(peersMutex_);
+            subscribe.patterns = localTopics_;
+        }
+        std::string payload;
+        subscribe.encode(payload);
+        peer->sendFrame(makeSharedFrame(FrameType::SUBSCRIBE, payload));
+    }
+
+    // Files a keepalive check for the peer in the timer wheel.
+    void NetworkManager::watchPeer(const std::shared_ptr<Peer>& peer, TimerWheel::Clock::duration delay) {
+        boost::asio::post(keepaliveStrand_, [this, weak = std::weak_ptr<Peer>(peer), delay]() {
+            wheel_.schedule(delay, [this, weak]() { checkPeer(weak); });
+        });
+    }
+
+    // Any received frame counts as activity, so a busy peer is never pinged and its check is just
+    // pushed back to when it could first have been silent for a whole interval. The timeout only
+    // applies to peers that answer pings, and to connections that never completed the handshake.
+    void NetworkManager::checkPeer(const std::weak_ptr<Peer>& weak) {
+        auto peer = weak.lock();
+        if (!peer || !peer->isConnected()) {
+            return;
+        }
+        auto idle = TimerWheel::Clock::now() - peer->lastActive();
+        if (idle < keepaliveInterval_) {
+            wheel_.schedule(keepaliveInterval_ - idle, [this, weak]() { checkPeer(weak); });
+            return;
+        }
+        bool answersPings = (peer->capabilities() & CAPABILITY_KEEPALIVE) != 0;
+        if (idle >= keepaliveTimeout_ && (answersPings || !peer->handshakeComplete())) {
+            std::cerr << "Peer " << peer->getPeerID() << " timed out after "
+                      << std::chrono::duration_cast<std::chrono::seconds>(idle).count() << " seconds of silence\n";
+            peer->close();
+            return;
+        }
+        if (answersPings) {
+            peer->sendFrame(makeSharedFrame(FrameType::PING, {}));
+        }
+        auto untilTimeout = keepaliveTimeout_ - idle;
+        auto delay = untilTimeout > TimerWheel::Clock::duration::zero() ? std::min(keepaliveInterval_, untilTimeout)
+                                                                         : keepaliveInterval_;
+        wheel_.schedule(delay, [this, weak]() { checkPeer(weak); });
+    }
+
+    // Rechecks the downloads once every interval, for as long as the wheel runs.
+    void NetworkManager::scheduleTransferCheck() {
+        wheel_.schedule(TRANSFER_CHECK_INTERVAL, [this]() {
+            transfers_.tick();
+            scheduleTransferCheck();
+        });
+    }
+
+    // Advances the wheel and rearms the timer for the next tick.
+    void NetworkManager::runKeepaliveTimer() {
+        wheel_.advance(TimerWheel::Clock::now());
+        keepaliveTimer_.expires_after(wheel_.tick());
+        keepaliveTimer_.async_wait([this](const boost::system::error_code& ec) {
+            if (!ec) {
+                runKeepaliveTimer();
+            }
+        });
+    }
+
+    // Handles a batch of received frames on a receive worker. File frames go to the transfer
+    // manager and subscription announcements to the index; messages, direct or gossiped, are
+    // decoded, logged together and then passed to the message handlers.
+    void NetworkManager::handleInbound(std::vector<InboundFrame>& batch) {
+        std::vector<message::Message> received;
+        for (auto& item : batch) {
+            if (item.type == FrameType::GOSSIP) {
+                handleGossip(item, received);
+                continue;
+            }
+            if (item.type == FrameType::SUBSCRIBE) {
+                // A peer closed meanwhile has already been removed; undo the late entry.
+                try {
+                    subscriptions_.set(item.peer.get(), Subscribe::decode(item.payload).patterns);
+                    if (!item.peer->isConnected()) {
+                        subscriptions_.remove(item.peer.get());
+                    }
+                } catch (const std::runtime_error& e) {
+                    decodeFailures_.add();
+                    std::cerr << "Protocol error from " << item.peer->getPeerID() << ": " << e.what() << "\n";
+                }
+                continue;
+            }
+            if (item.type != FrameType::MESSAGE) {
+                transfers_.handleFrame(item.peer, FrameView{item.type, item.payload});
+                continue;
+            }
+            try {
+                message::MessageView view;
+                message::Message::decodeView(item.payload, view);
+                // Override type to RECEIVED for all incoming messages.
+                // This ensures consistency regardless of sender's encoding.
+                received.emplace_back(view, message::MessageType::RECEIVED);
+            } catch (...) {
+                // Ignore parsing errors to prevent crashes from malformed messages.
+                decodeFailures_.add();
+            }
+        }
+        if (received.empty()) {
+            return;
+        }
+        logging::LogManager::instance().appendMessages(received);
+        std::vector<std::function<void(const message::Message&)>> handlers;
+        {
+            std::lock_guard<std::mutex> lock(peersMutex_);
+            handlers = messageHandlers_;
+        }
+        for (const auto& m : received) {
+            for (const auto& handler : handlers) {
+                handler(m);
+            }
+        }
+    }
+
+    // Relays before decoding, so a message this node cannot parse still spreads. The sender is
+    // skipped as a target; other peers that already have the message drop the copy by its ID.
+    void NetworkManager::handleGossip(const InboundFrame& item, std::vector<message::Message>& received) {
+        std::string_view encoded;
+        SharedFrame relay;
+        if (!gossip_.receive(item.payload, encoded, relay)) {
+            return;
+        }
+        if (relay) {
+            for (const auto& peer : gossip_.pickTargets(snapshotPeers(), item.peer.get())) {
+                peer->sendFrame(relay);
+            }
+        }
+        try {
+            message::MessageView view;
+            message::Message::decodeView(encoded, view);
+            received.emplace_back(view, message::MessageType::RECEIVED);
+        } catch (...) {
+            // Ignore parsing errors to prevent crashes from malformed messages.
+            decodeFailures_.add();
+        }
+    }
+
+    // One family at a time, as the exposition format requires, so the snapshot is walked once per family.
+    void NetworkManager::collectPeerMetrics(metrics::TextWriter& out) const {
+        auto peers = loadPeers();
+        std::vector<std::pair<metrics::Labels, PeerCounters>> counters;
+        counters.reserve(peers->size());
+        for (const auto& [id, peer] : *peers) {
+            counters.emplace_back(metrics::Labels{{"peer", id}}, peer->counters());
+        }
+        out.family("p2p_peers", "Connected peers", "gauge");
+        out.sample("p2p_peers", {}, static_cast<double>(peers->size()));
+
+        struct Family {
+            const char* name;
+            const char* help;
+            const char* type;
+            std::uint64_t PeerCounters::*field;
+        };
+        static const Family families[] = {
+            {"p2p_peer_received_bytes_total", "Bytes read from the peer's socket", "counter",
+             &PeerCounters::bytesReceived},
+            {"p2p_peer_sent_bytes_total", "Bytes written to the peer's socket", "counter", &PeerCounters::bytesSent},
+            {"p2p_peer_received_messages_total", "Messages received from the peer, direct or gossiped", "counter",
+             &PeerCounters::messagesReceived},
+            {"p2p_peer_sent_messages_total", "Messages written to the peer", "counter", &PeerCounters::messagesSent},
+            {"p2p_peer_dropped_messages_total", "Messages dropped because the peer's queue was full", "counter",
+             &PeerCounters::messagesDropped},
+            {"p2p_peer_queued_bytes", "Bytes waiting in the peer's write queue", "gauge", &PeerCounters::queuedBytes},
+            {"p2p_peer_queued_frames", "Frames waiting in the peer's write queue", "gauge",
+             &PeerCounters::queuedFrames},
+            {"p2p_peer_compression_input_bytes_total", "Bytes of batches before compression", "counter",
+             &PeerCounters::compressedIn},
+            {"p2p_peer_compression_output_bytes_total", "Bytes of batches after compression", "counter",
+             &PeerCounters::compressedOut},
+        };
+        for (const auto& family : families) {
+            out.family(family.name, family.help, family.type);
+            for (const auto& [labels, values] : counters) {
+                out.sample(family.name, labels, static_cast<double>(values.*family.field));
             }
-            peers_.erase(it);
-            std::cout << "Peer removed: " << peerID << "\n";
-            if (peerDisconnectHandler_) {
-                peerDisconnectHandler_(peerID);
+        }
+        out.family("p2p_peer_write_seconds", "Time from starting a socket write to its completion", "histogram");
+        for (const auto& [id, peer] : *peers) {
+            out.histogram("p2p_peer_write_seconds", {{"peer", id}}, peer->writeLatency().snapshot());
+        }
+    }
+
+    // Removes a peer from the peers list upon disconnection.
+    // Only removes the entry if it still refers to this peer, since the key may have been reused.
+    // Sends a "disconnecting" message if the peer is still connected.
+    void NetworkManager::removePeer(const std::shared_ptr<Peer>& peer) {
+        std::string peerID = peer->getPeerID();
+        bool removed = updatePeers([&](PeerMap& peers) {
+            auto it = peers.find(peerID);
+            if (it == peers.end() || it->second != peer) {
+                return false;
             }
+            peers.erase(it);
+            return true;
+        });
+        if (!removed) {
+            return;
+        }
+        // Check connection status before sending message (best-effort).
+        if (peer->isConnected()) {
+            peer->sendMessage("disconnecting");
+        }
+        std::cout << "Peer removed: " << peerID << "\n";
+        std::lock_guard<std::mutex> lock(peersMutex_);
+        if (peerDisconnectHandler_) {
+            peerDisconnectHandler_(peerID);
         }
     }
 
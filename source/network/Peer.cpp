@@ -1,135 +1,730 @@
 #include "network/Peer.h"
+#include <algorithm>
 #include <boost/asio.hpp>
+#include <cerrno>
 #include <chrono>
+#include <cstring>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <sys/sendfile.h>
+#include <unistd.h>
 
 namespace network {
 
+    namespace {
+
+        // Minimum free space offered to each socket read.
+        constexpr std::size_t RECEIVE_CHUNK_SIZE = 64 * 1024;
+
+        // Maximum number of frames combined into one gather write.
+        constexpr std::size_t MAX_GATHER_FRAMES = 64;
+
+        // Bytes gathered into one encrypted write; smaller writes let the peer open one batch
+        // while the next is sealed, instead of each side waiting for the other.
+        constexpr std::size_t MAX_SEALED_WRITE = 1024 * 1024;
+
+        // Send buffer capacity kept between writes; a larger one, left by a big message, is freed.
+        constexpr std::size_t SEND_BUFFER_KEEP = 4 * 1024 * 1024;
+
+        // Bytes a record adds to its plaintext.
+        constexpr std::size_t RECORD_OVERHEAD = FRAME_HEADER_SIZE + RECORD_TAG_SIZE;
+
+    }  // namespace
+
     // Constructs a Peer with a socket and listening address as its ID.
     // Initializes handlers as null (std::function default) and sets last active time.
     Peer::Peer(std::shared_ptr<tcp::socket> socket, const std::string& listeningAddress)
         : socket_(std::move(socket)),
           peerID_(listeningAddress),
-          lastActiveTime_(std::chrono::steady_clock::now()) {}
+          lastActiveTime_(std::chrono::steady_clock::now().time_since_epoch().count()) {
+        boost::system::error_code ec;
+        auto endpoint = socket_->remote_endpoint(ec);
+        if (ec) {
+            remoteAddress_ = "Unknown (error: " + ec.message() + ")";
+        } else {
+            remoteAddress_ = endpoint.address().to_string() + ":" + std::to_string(endpoint.port());
+        }
+    }
+
+    // Frames a message and queues it for writing.
+    SendStatus Peer::sendMessage(const std::string& message) {
+        return sendFrame(makeSharedFrame(FrameType::MESSAGE, message));
+    }
 
-    // Sends a message to this peer asynchronously.
-    // The message is shared to ensure it persists during async write.
-    void Peer::sendMessage(const std::string& message) {
+    // Hands a shared frame to the socket's executor for queued writing.
+    // The frame is shared so it persists until its write completes.
+    SendStatus Peer::sendFrame(SharedFrame frame) {
         if (!isConnected()) {
-            return;
+            return SendStatus::DROPPED;
         }
-        auto msg = std::make_shared<std::string>(message);
-        boost::asio::async_write(*socket_, boost::asio::buffer(*msg),
-            [this, msg](const boost::system::error_code& ec, std::size_t) {
-                if (ec) {
-                    // Log error and trigger disconnect handler if set.
-                    std::cerr << "Error sending message to " << peerID_ << ": " << ec.message() << "\n";
-                    if (disconnectHandler_) {
-                        disconnectHandler_();
-                    }
-                }
+        Outbound item;
+        item.bytes = frame->size();
+        if (frame->size() > 4) {
+            auto type = static_cast<FrameType>((*frame)[4]);
+            item.droppable = type == FrameType::MESSAGE || type == FrameType::GOSSIP;
+        }
+        item.frame = std::move(frame);
+        SendStatus status = reserve(item);
+        if (status == SendStatus::DROPPED) {
+            return status;
+        }
+        boost::asio::post(socket_->get_executor(), [self = shared_from_this(), item = std::move(item)]() mutable {
+            self->enqueue(std::move(item));
+        });
+        return status;
+    }
+
+    // Queues the handshake; the hold is set after it is queued, so only it is written.
+    SendStatus Peer::sendHello(SharedFrame frame, bool awaitSession) {
+        if (!isConnected()) {
+            return SendStatus::DROPPED;
+        }
+        Outbound item;
+        item.bytes = frame->size();
+        item.frame = std::move(frame);
+        SendStatus status = reserve(item);
+        boost::asio::post(socket_->get_executor(),
+            [self = shared_from_this(), item = std::move(item), awaitSession]() mutable {
+                self->helloQueued_ = true;
+                self->enqueue(std::move(item));
+                self->awaitingSession_ = awaitSession;
             });
+        return status;
+    }
+
+    // Queues a frame header followed by a file range, as two adjacent queue entries.
+    // Both are posted together so no other frame can be written between them.
+    SendStatus Peer::sendFileSegment(SharedFrame header, std::shared_ptr<FileHandle> file,
+                                     std::uint64_t offset, std::size_t length) {
+        if (!isConnected()) {
+            return SendStatus::DROPPED;
+        }
+        Outbound head;
+        head.bytes = header->size();
+        head.frame = std::move(header);
+        Outbound body;
+        body.file = std::move(file);
+        body.offset = offset;
+        body.length = length;
+        body.bytes = length;
+        reserve(head);
+        SendStatus status = reserve(body);
+        boost::asio::post(socket_->get_executor(),
+            [self = shared_from_this(), head = std::move(head), body = std::move(body)]() mutable {
+                self->enqueue(std::move(head));
+                self->enqueue(std::move(body));
+            });
+        return status;
+    }
+
+    // Sets the outbound queue limits.
+    void Peer::setSendLimits(const SendLimits& limits) {
+        limits_ = limits;
+    }
+
+    // Returns the number of bytes queued or being written.
+    std::size_t Peer::queuedBytes() const {
+        return queuedBytes_.load();
+    }
+
+    // Returns true while the outbound queue is congested.
+    bool Peer::isCongested() const {
+        return congested_.load();
     }
 
     // Starts asynchronous message receiving loop.
-    // Uses a fixed-size buffer (1024 bytes); larger messages may be truncated.
     void Peer::startReceiving() {
         if (!isConnected()) {
             return;
         }
-        socket_->async_read_some(
-            boost::asio::buffer(buffer_.data(), buffer_.size()),
-            [this](const boost::system::error_code& ec, std::size_t bytes) {
-                handleReceive(ec, bytes);
-            });
+        readMore();
     }
 
-    // Returns the peer's listening address (IP:port).
+    // Returns the peer's remote address (IP:port).
     std::string Peer::getAddress() const {
         if (!isConnected()) {
             return "Peer disconnected.";
         }
-        boost::system::error_code ec;
-        auto endpoint = socket_->remote_endpoint(ec);
-        if (ec) {
-            return "Unknown (error: " + ec.message() + ")";
-        }
-        return endpoint.address().to_string() + ":" + std::to_string(endpoint.port());
+        return remoteAddress_;
     }
 
     // Returns the peer's unique identifier (listening address).
-    const std::string& Peer::getPeerID() const {
+    std::string Peer::getPeerID() const {
+        std::lock_guard<std::mutex> lock(idMutex_);
         return peerID_;
     }
 
     // Sets the peer's unique identifier.
     void Peer::setPeerID(const std::string& id) {
+        std::lock_guard<std::mutex> lock(idMutex_);
         peerID_ = id;
     }
 
-    // Checks if the peer's socket is open and connected.
+    // Checks if the peer's connection is still usable.
     bool Peer::isConnected() const {
-        return socket_ && socket_->is_open();
+        return socket_ && connected_.load();
+    }
+
+    // Records the handshake's capabilities before publishing completion.
+    void Peer::completeHandshake(std::uint64_t capabilities) {
+        capabilities_ = capabilities;
+        handshakeComplete_ = true;
+    }
+
+    // Returns true once the peer's handshake has been received.
+    bool Peer::handshakeComplete() const {
+        return handshakeComplete_.load();
+    }
+
+    // Returns the capability bits the peer announced.
+    std::uint64_t Peer::capabilities() const {
+        return capabilities_.load();
+    }
+
+    // Takes effect from the next gather write.
+    void Peer::enableCompression() {
+        compress_ = true;
+    }
+
+    // The bytes after the peer's handshake are records, so the buffer holding them becomes the
+    // record buffer and opened records fill a fresh frame buffer.
+    void Peer::startSession(SessionKeys keys) {
+        if (keys.opener) {
+            records_ = std::move(buffer_);
+            records_.setMaxFrameSize(MAX_RECORD_PLAINTEXT + RECORD_TAG_SIZE);
+            buffer_ = FrameBuffer(maxFrameSize_);
+            opener_ = std::move(keys.opener);
+        }
+        sealer_ = std::move(keys.sealer);
+        encrypted_ = sealer_ != nullptr;
+        helloQueued_ = true;
+        awaitingSession_ = false;
+        if (!writing_ && !writeQueue_.empty()) {
+            startWrite();
+        }
+    }
+
+    // Returns true once traffic with the peer is encrypted.
+    bool Peer::isEncrypted() const {
+        return encrypted_.load();
+    }
+
+    // Closes the connection on the socket's executor; runs inline when already on it,
+    // so the receive loop sees the closed state before dispatching another frame.
+    void Peer::close() {
+        boost::asio::dispatch(socket_->get_executor(), [self = shared_from_this()]() {
+            self->closeWithError();
+        });
     }
 
     // Returns the last time the peer was active (received a message).
     std::chrono::steady_clock::time_point Peer::lastActive() const {
-        return lastActiveTime_;
+        return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(lastActiveTime_.load()));
     }
 
     // Registers a callback for handling incoming messages.
-    void Peer::onMessage(std::function<void(const std::string&)>&& handler) {
+    void Peer::onMessage(std::function<bool(const FrameView&)>&& handler) {
         messageHandler_ = std::move(handler);
     }
 
+    // Re-offers the refused frame on the socket's executor and continues receiving.
+    // Posted rather than dispatched, so a resume never runs inside the callback that paused.
+    void Peer::resumeReceiving() {
+        boost::asio::post(socket_->get_executor(), [self = shared_from_this()]() {
+            if (self->paused_) {
+                self->dispatchFrames();
+            }
+        });
+    }
+
     // Registers a callback for handling disconnection events.
     void Peer::onDisconnect(std::function<void()>&& handler) {
         disconnectHandler_ = std::move(handler);
     }
 
-    // Handles received messages and errors, continuing the async read loop.
+    // Sets the maximum payload size accepted in a single incoming frame.
+    void Peer::setMaxFrameSize(std::size_t maxFrameSize) {
+        maxFrameSize_ = maxFrameSize;
+        buffer_.setMaxFrameSize(maxFrameSize);
+    }
+
+    // Issues the next asynchronous read directly into the frame buffer.
+    // The read is sized to cover the rest of a partially received frame.
+    void Peer::readMore() {
+        auto region = (opener_ ? records_ : buffer_).prepare(RECEIVE_CHUNK_SIZE);
+        socket_->async_read_some(
+            boost::asio::buffer(region.first, region.second),
+            [self = shared_from_this()](const boost::system::error_code& ec, std::size_t bytes) {
+                self->handleReceive(ec, bytes);
+            });
+    }
+
+    // Handles received bytes and errors, continuing the async read loop.
+    // A single read may complete several frames, or only part of one.
     // Closes socket on any error (except operation_aborted) and triggers disconnect handler.
     void Peer::handleReceive(const boost::system::error_code& error, std::size_t bytes_transferred) {
         // Handle errors and disconnection.
         if (error) {
             if (error != boost::asio::error::operation_aborted) {
-                std::cerr << "Receive error from " << peerID_ << ": " << error.message() << "\n";
+                std::cerr << "Receive error from " << getPeerID() << ": " << error.message() << "\n";
+            }
+            closeWithError();
+            return;
+        }
+
+        // Dispatch every complete frame, then continue reading.
+        lastActiveTime_ = std::chrono::steady_clock::now().time_since_epoch().count();
+        bytesReceived_ += bytes_transferred;
+        (opener_ ? records_ : buffer_).commit(bytes_transferred);
+        dispatchFrames();
+    }
+
+    // Starts with the refused frame when resuming, then drains the inflated batch before taking
+    // more from the buffer. A refused frame's view stays valid because neither prepare() nor
+    // nextFrame() is called, and no batch is inflated, until it has been taken. Compressed
+    // batches are unpacked here, so the callback sees only the frames inside them.
+    void Peer::dispatchFrames() {
+        try {
+            FrameView frame;
+            while (isConnected()) {
+                if (paused_) {
+                    frame = stalled_;
+                    paused_ = false;
+                } else if (!nextInflatedFrame(frame) && !nextPlainFrame(frame)) {
+                    break;
+                }
+                if (frame.type == FrameType::COMPRESSED) {
+                    compressor_.decompress(frame.payload, std::max(maxFrameSize_, MAX_COMPRESSED_RUN), inflated_);
+                    inflatedPos_ = 0;
+                    continue;
+                }
+                if (messageHandler_ && !messageHandler_(frame)) {
+                    stalled_ = frame;
+                    paused_ = true;
+                    return;
+                }
+                if (frame.type == FrameType::MESSAGE || frame.type == FrameType::GOSSIP) {
+                    ++messagesReceived_;
+                }
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Protocol error from " << getPeerID() << ": " << e.what() << "\n";
+            closeWithError();
+            return;
+        }
+        if (!isConnected()) {
+            return;
+        }
+        readMore();
+    }
+
+    // Each record is opened straight into the frame buffer's free space and committed only once
+    // authenticated. Opening happens only when no complete frame is left, so earlier views stay valid.
+    bool Peer::nextPlainFrame(FrameView& frame) {
+        while (!buffer_.nextFrame(frame)) {
+            FrameView record;
+            if (!opener_ || !records_.nextFrame(record)) {
+                return false;
             }
-            boost::system::error_code ignore;
-            if (socket_ && socket_->is_open()) {
-                socket_->close(ignore);
+            if (record.type != FrameType::RECORD || record.payload.size() < RECORD_TAG_SIZE) {
+                throw std::runtime_error("Expected encrypted record");
             }
-            if (disconnectHandler_) {
-                disconnectHandler_();
+            char header[FRAME_HEADER_SIZE];
+            writeFrameHeader(header, FrameType::RECORD, static_cast<std::uint32_t>(record.payload.size()));
+            std::size_t length = record.payload.size() - RECORD_TAG_SIZE;
+            auto region = buffer_.prepare(length);
+            if (!opener_->open(header, record.payload, region.first)) {
+                throw std::runtime_error("Record failed authentication");
             }
+            buffer_.commit(length);
+        }
+        return true;
+    }
+
+    // Inner frames use the ordinary header and are bounded by the batch they came in.
+    bool Peer::nextInflatedFrame(FrameView& frame) {
+        if (inflatedPos_ >= inflated_.size()) {
+            return false;
+        }
+        std::string_view rest(inflated_);
+        rest.remove_prefix(inflatedPos_);
+        if (rest.size() < FRAME_HEADER_SIZE) {
+            throw std::runtime_error("Truncated frame in compressed batch");
+        }
+        auto byte = [&](std::size_t i) { return static_cast<std::uint32_t>(static_cast<unsigned char>(rest[i])); };
+        std::size_t length = (byte(0) << 24) | (byte(1) << 16) | (byte(2) << 8) | byte(3);
+        frame.type = static_cast<FrameType>(rest[4]);
+        if (length > rest.size() - FRAME_HEADER_SIZE || frame.type == FrameType::COMPRESSED) {
+            throw std::runtime_error("Malformed frame in compressed batch");
+        }
+        frame.payload = rest.substr(FRAME_HEADER_SIZE, length);
+        inflatedPos_ += FRAME_HEADER_SIZE + length;
+        return true;
+    }
+
+    // Closes the socket and triggers the disconnect handler.
+    // Read and write failures may both report the same broken connection; only the first counts.
+    void Peer::closeWithError() {
+        if (!connected_.exchange(false)) {
             return;
         }
+        boost::system::error_code ignore;
+        if (socket_ && socket_->is_open()) {
+            socket_->close(ignore);
+        }
+        if (disconnectHandler_) {
+            disconnectHandler_();
+        }
+    }
 
-        // Process received message and continue reading.
-        lastActiveTime_ = std::chrono::steady_clock::now();
-        std::string msg(buffer_.data(), bytes_transferred);
-        if (messageHandler_) {
-            messageHandler_(msg);
+    // Adds the entry to the queue accounting. A message frame that would take the queue past
+    // its limit is refused or closes the connection, depending on the policy; under DROP_OLDEST
+    // it is queued and enqueue() makes room by discarding older messages.
+    SendStatus Peer::reserve(const Outbound& item) {
+        std::size_t queued = queuedBytes_.fetch_add(item.bytes) + item.bytes;
+        if (item.droppable && queued > limits_.maxQueuedBytes) {
+            if (limits_.policy == OverflowPolicy::DROP_NEWEST) {
+                queuedBytes_ -= item.bytes;
+                ++droppedFrames_;
+                return SendStatus::DROPPED;
+            }
+            if (limits_.policy == OverflowPolicy::DISCONNECT) {
+                queuedBytes_ -= item.bytes;
+                std::cerr << "Disconnecting " << getPeerID() << ": " << queued - item.bytes
+                          << " bytes queued and not read\n";
+                close();
+                return SendStatus::DROPPED;
+            }
+        }
+        if (item.frame) {
+            ++queuedFrames_;
+        }
+        if (queued >= limits_.highWatermark) {
+            congested_ = true;
         }
+        return congested_ ? SendStatus::CONGESTED : SendStatus::QUEUED;
+    }
 
-        // Restart async read loop.
-        socket_->async_read_some(
-            boost::asio::buffer(buffer_.data(), buffer_.size()),
-            [this](const boost::system::error_code& ec, std::size_t bytes) {
-                handleReceive(ec, bytes);
+    // Removes the entry's bytes from the accounting.
+    void Peer::release(const Outbound& item) {
+        std::size_t queued = queuedBytes_.fetch_sub(item.bytes) - item.bytes;
+        if (item.frame) {
+            --queuedFrames_;
+        }
+        if (queued <= limits_.lowWatermark) {
+            congested_ = false;
+        }
+    }
+
+    // Drops the oldest message frames not yet being written. Other frames are kept in order.
+    void Peer::dropOldest() {
+        for (auto it = writeQueue_.begin(); it != writeQueue_.end() && queuedBytes_ > limits_.maxQueuedBytes;) {
+            if (it->droppable) {
+                release(*it);
+                ++droppedFrames_;
+                it = writeQueue_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Appends an entry to the write queue and starts a write if none is in flight.
+    // Anything queued before the handshake is refused: the remote would reject the connection
+    // for it, and with encryption it would have gone out in the clear.
+    void Peer::enqueue(Outbound item) {
+        if (!helloQueued_) {
+            release(item);
+            ++droppedFrames_;
+            std::cerr << "Refusing to send a frame to " << getPeerID() << " before the handshake\n";
+            return;
+        }
+        writeQueue_.push_back(std::move(item));
+        if (limits_.policy == OverflowPolicy::DROP_OLDEST && queuedBytes_ > limits_.maxQueuedBytes) {
+            dropOldest();
+        }
+        if (!writing_ && !writeQueue_.empty()) {
+            startWrite();
+        }
+    }
+
+    // Moves queued frames into a single gather write, stopping at the next file segment.
+    // Frames queued while it runs are coalesced into the next one.
+    void Peer::startWrite() {
+        if (!isConnected()) {
+            for (const auto& item : writeQueue_) {
+                release(item);
+            }
+            writeQueue_.clear();
+            return;
+        }
+        if (awaitingSession_) {
+            return;
+        }
+        writing_ = true;
+        writeStarted_ = std::chrono::steady_clock::now();
+        if (writeQueue_.front().file) {
+            segment_ = std::move(writeQueue_.front());
+            writeQueue_.pop_front();
+            if (sealer_) {
+                sealSegment();
+            } else {
+                writeSegment();
+            }
+            return;
+        }
+        // The header of a file segment is a partial frame; it stops the gather like the segment.
+        std::vector<boost::asio::const_buffer> buffers;
+        std::size_t gathered = 0;
+        while (!writeQueue_.empty() && !writeQueue_.front().file && inFlight_.size() < MAX_GATHER_FRAMES &&
+               (!sealer_ || gathered < MAX_SEALED_WRITE)) {
+            gathered += writeQueue_.front().frame->size();
+            inFlight_.push_back(std::move(writeQueue_.front()));
+            writeQueue_.pop_front();
+        }
+        gatherBuffers(buffers);
+        if (sealer_) {
+            sealBuffers(buffers);
+        }
+        boost::asio::async_write(*socket_, buffers,
+            [self = shared_from_this()](const boost::system::error_code& ec, std::size_t bytes) {
+                self->bytesSent_ += bytes;
+                self->handleWrite(ec);
             });
     }
 
+    // Consecutive message frames form a run, closed by any other frame or once it reaches
+    // MAX_COMPRESSED_RUN bytes; the compressor decides whether a run goes out deflated.
+    void Peer::gatherBuffers(std::vector<boost::asio::const_buffer>& buffers) {
+        if (!compress_) {
+            for (const auto& item : inFlight_) {
+                buffers.emplace_back(boost::asio::buffer(*item.frame));
+            }
+            return;
+        }
+        std::vector<SharedFrame> run;
+        std::size_t runBytes = 0;
+        auto flush = [&]() {
+            if (run.empty()) {
+                return;
+            }
+            if (SharedFrame packed = compressor_.compress(run, runBytes)) {
+                compressedIn_ += runBytes;
+                compressedOut_ += packed->size();
+                buffers.emplace_back(boost::asio::buffer(*packed));
+                packed_.push_back(std::move(packed));
+            } else {
+                for (const auto& frame : run) {
+                    buffers.emplace_back(boost::asio::buffer(*frame));
+                }
+            }
+            run.clear();
+            runBytes = 0;
+        };
+        for (const auto& item : inFlight_) {
+            if (!item.droppable) {
+                flush();
+                buffers.emplace_back(boost::asio::buffer(*item.frame));
+                continue;
+            }
+            if (runBytes > 0 && runBytes + item.frame->size() > MAX_COMPRESSED_RUN) {
+                flush();
+            }
+            run.push_back(item.frame);
+            runBytes += item.frame->size();
+        }
+        flush();
+    }
+
+    // Records are cut from the byte stream regardless of frame boundaries, so the whole gather,
+    // compressed runs and file segment headers included, is sealed in one pass. The queued
+    // frames are shared with other peers, so each piece is encrypted from the frame straight
+    // into its place in the send buffer rather than copied there first.
+    void Peer::sealBuffers(std::vector<boost::asio::const_buffer>& buffers) {
+        std::size_t total = boost::asio::buffer_size(buffers);
+        std::size_t records = (total + MAX_RECORD_PLAINTEXT - 1) / MAX_RECORD_PLAINTEXT;
+        std::size_t sealed = total + records * RECORD_OVERHEAD;
+        if (sendBuffer_.size() < sealed) {
+            sendBuffer_.resize(sealed);
+        }
+        char* out = sendBuffer_.data();
+        auto source = buffers.begin();
+        std::size_t sourceOffset = 0;
+        for (std::size_t left = total; left > 0;) {
+            std::size_t length = std::min(left, MAX_RECORD_PLAINTEXT);
+            char* payload = out + FRAME_HEADER_SIZE;
+            writeFrameHeader(out, FrameType::RECORD, static_cast<std::uint32_t>(length + RECORD_TAG_SIZE));
+            sealer_->beginSeal(out);
+            for (std::size_t done = 0; done < length;) {
+                std::size_t take = std::min(length - done, source->size() - sourceOffset);
+                sealer_->sealUpdate(static_cast<const char*>(source->data()) + sourceOffset, payload + done, take);
+                done += take;
+                sourceOffset += take;
+                if (sourceOffset == source->size()) {
+                    ++source;
+                    sourceOffset = 0;
+                }
+            }
+            sealer_->finishSeal(payload + length);
+            out += length + RECORD_OVERHEAD;
+            left -= length;
+        }
+        buffers.assign(1, boost::asio::buffer(sendBuffer_.data(), sealed));
+    }
+
+    // sendfile() cannot encrypt, so an encrypted segment is read into the records it will be
+    // sent in and sealed there. Segments are at most one chunk, read from the page cache.
+    void Peer::sealSegment() {
+        std::size_t records = (segment_.length + MAX_RECORD_PLAINTEXT - 1) / MAX_RECORD_PLAINTEXT;
+        std::size_t sealed = segment_.length + records * RECORD_OVERHEAD;
+        if (sendBuffer_.size() < sealed) {
+            sendBuffer_.resize(sealed);
+        }
+        char* out = sendBuffer_.data();
+        std::uint64_t offset = segment_.offset;
+        for (std::size_t left = segment_.length; left > 0;) {
+            std::size_t length = std::min(left, MAX_RECORD_PLAINTEXT);
+            char* payload = out + FRAME_HEADER_SIZE;
+            for (std::size_t read = 0; read < length;) {
+                ssize_t got = ::pread(segment_.file->fd(), payload + read, length - read,
+                                      static_cast<off_t>(offset + read));
+                if (got < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (got <= 0) {
+                    // The file shrank under us or cannot be read; the stream can no longer be framed.
+                    handleWrite(got < 0 ? boost::system::error_code(errno, boost::system::system_category())
+                                        : boost::asio::error::make_error_code(boost::asio::error::eof));
+                    return;
+                }
+                read += static_cast<std::size_t>(got);
+            }
+            writeFrameHeader(out, FrameType::RECORD, static_cast<std::uint32_t>(length + RECORD_TAG_SIZE));
+            sealer_->seal(out, payload, length, payload + length);
+            out += length + RECORD_OVERHEAD;
+            offset += length;
+            left -= length;
+        }
+        boost::asio::async_write(*socket_, boost::asio::buffer(sendBuffer_.data(), sealed),
+            [self = shared_from_this()](const boost::system::error_code& ec, std::size_t bytes) {
+                self->bytesSent_ += bytes;
+                self->handleWrite(ec);
+            });
+    }
+
+    // Sends the current file segment with sendfile(), so file bytes never enter user space.
+    // When the socket buffer is full, waits for writability and resumes.
+    void Peer::writeSegment() {
+        socket_->native_non_blocking(true);
+        while (segment_.length > 0) {
+            off_t offset = static_cast<off_t>(segment_.offset);
+            ssize_t sent = ::sendfile(socket_->native_handle(), segment_.file->fd(), &offset, segment_.length);
+            if (sent > 0) {
+                bytesSent_ += static_cast<std::uint64_t>(sent);
+                segment_.offset += static_cast<std::uint64_t>(sent);
+                segment_.length -= static_cast<std::size_t>(sent);
+                continue;
+            }
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                socket_->async_wait(tcp::socket::wait_write,
+                    [self = shared_from_this()](const boost::system::error_code& ec) {
+                        if (ec) {
+                            self->handleWrite(ec);
+                        } else {
+                            self->writeSegment();
+                        }
+                    });
+                return;
+            }
+            // The file shrank under us or the socket failed; the stream can no longer be framed.
+            handleWrite(sent < 0 ? boost::system::error_code(errno, boost::system::system_category())
+                                 : boost::asio::error::make_error_code(boost::asio::error::eof));
+            return;
+        }
+        handleWrite(boost::system::error_code());
+    }
+
+    // Releases the written entries and continues with whatever queued up meanwhile.
+    void Peer::handleWrite(const boost::system::error_code& error) {
+        writeLatency_.observe(std::chrono::steady_clock::now() - writeStarted_);
+        for (const auto& item : inFlight_) {
+            if (item.droppable && !error) {
+                ++messagesSent_;
+            }
+            release(item);
+        }
+        inFlight_.clear();
+        packed_.clear();
+        if (sendBuffer_.capacity() > SEND_BUFFER_KEEP) {
+            std::vector<char>().swap(sendBuffer_);
+        }
+        if (segment_.file) {
+            release(segment_);
+        }
+        segment_ = Outbound();
+        writing_ = false;
+        if (error) {
+            // Log error and trigger disconnect handler if set.
+            std::cerr << "Error sending message to " << getPeerID() << ": " << error.message() << "\n";
+            for (const auto& item : writeQueue_) {
+                release(item);
+            }
+            writeQueue_.clear();
+            closeWithError();
+            return;
+        }
+        if (!writeQueue_.empty()) {
+            startWrite();
+        }
+    }
+
+    // Returns the traffic counters; each is read on its own, so they may be a moment apart.
+    PeerCounters Peer::counters() const {
+        PeerCounters counters;
+        counters.bytesReceived = bytesReceived_;
+        counters.bytesSent = bytesSent_;
+        counters.messagesReceived = messagesReceived_;
+        counters.messagesSent = messagesSent_;
+        counters.messagesDropped = droppedFrames_;
+        counters.compressedIn = compressedIn_;
+        counters.compressedOut = compressedOut_;
+        counters.queuedBytes = queuedBytes_;
+        counters.queuedFrames = queuedFrames_;
+        return counters;
+    }
+
+    // Returns the write latency histogram.
+    const metrics::Histogram& Peer::writeLatency() const {
+        return writeLatency_;
+    }
+
     // Returns a string representation of the peer for UI display.
-    // Shows the listening address and time since last activity.
+    // Shows the listening address, time since last activity, the outbound queue depth, whether
+    // traffic is encrypted and the compression achieved.
     std::string Peer::toString() const {
         std::ostringstream oss;
-        oss << "Address: " << peerID_;
+        oss << "Address: " << getPeerID();
         auto now = std::chrono::steady_clock::now();
         auto secondsSinceActive = std::chrono::duration_cast<std::chrono::seconds>(
-            now - lastActiveTime_).count();
+            now - lastActive()).count();
         oss << " | Last active: " << secondsSinceActive << " seconds ago";
+        oss << " | Queued: " << queuedFrames_.load() << " frames, " << queuedBytes_.load() << " bytes";
+        if (isCongested()) {
+            oss << " (congested)";
+        }
+        if (droppedFrames_ > 0) {
+            oss << " | Dropped: " << droppedFrames_.load();
+        }
+        if (isEncrypted()) {
+            oss << " | Encrypted";
+        }
+        if (compressedIn_ > 0) {
+            oss << " | Compressed: " << compressedIn_.load() << " -> " << compressedOut_.load() << " bytes";
+        }
         return oss.str();
     }
 
@@ -0,0 +1,146 @@
+#include "network/ReceivePipeline.h"
+#include "network/Peer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace network {
+
+    namespace {
+
+        // Upper bound on frames handed to the handler in one batch.
+        constexpr std::size_t MAX_BATCH_FRAMES = 256;
+
+        // How long an idle worker parks before checking the queue again.
+        constexpr auto IDLE_WAIT = std::chrono::milliseconds(100);
+
+    }  // namespace
+
+    // Constructs a stopped pipeline.
+    ReceivePipeline::ReceivePipeline(std::size_t capacity) : capacity_(capacity) {}
+
+    // Stops the workers.
+    ReceivePipeline::~ReceivePipeline() {
+        stop();
+    }
+
+    // Starts the worker threads.
+    void ReceivePipeline::start(std::size_t count, BatchHandler handler) {
+        if (running_) {
+            return;
+        }
+        handler_ = std::move(handler);
+        running_ = true;
+        for (std::size_t i = 0; i < std::max<std::size_t>(1, count); ++i) {
+            workers_.push_back(std::make_unique<Worker>(capacity_));
+        }
+        for (auto& worker : workers_) {
+            Worker& w = *worker;
+            w.thread = std::thread([this, &w]() { run(w); });
+        }
+    }
+
+    // Copies the frame into the peer's worker queue and wakes the worker if it is parked.
+    // On a full queue the peer is recorded as stalled before retrying once, so a worker that
+    // drains the queue in between still sees it and no resume is lost.
+    bool ReceivePipeline::submit(const std::shared_ptr<Peer>& peer, const FrameView& frame) {
+        if (workers_.empty()) {
+            return false;
+        }
+        Worker& worker = workerFor(peer.get());
+        InboundFrame item{peer, frame.type, std::string(frame.payload)};
+        bool queued = worker.queue.tryPush(item);
+        if (!queued) {
+            {
+                std::lock_guard<std::mutex> lock(worker.stalledMutex);
+                worker.stalled.push_back(peer);
+                worker.hasStalled = true;
+            }
+            queued = worker.queue.tryPush(item);
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (worker.sleeping) {
+            std::lock_guard<std::mutex> lock(worker.wakeMutex);
+            worker.wakeCondition.notify_one();
+        }
+        return queued;
+    }
+
+    // Stops the workers after they have handled everything queued.
+    void ReceivePipeline::stop() {
+        if (!running_.exchange(false)) {
+            return;
+        }
+        for (auto& worker : workers_) {
+            std::lock_guard<std::mutex> lock(worker->wakeMutex);
+            worker->wakeCondition.notify_one();
+        }
+        for (auto& worker : workers_) {
+            if (worker->thread.joinable() && worker->thread.get_id() != std::this_thread::get_id()) {
+                worker->thread.join();
+            } else if (worker->thread.joinable()) {
+                worker->thread.detach();
+            }
+        }
+    }
+
+    // Worker loop: take up to a batch of frames, hand them to the handler, then resume
+    // any peer that was refused while the queue was full.
+    void ReceivePipeline::run(Worker& worker) {
+        std::vector<InboundFrame> batch;
+        batch.reserve(MAX_BATCH_FRAMES);
+        while (true) {
+            InboundFrame item;
+            while (batch.size() < MAX_BATCH_FRAMES && worker.queue.tryPop(item)) {
+                batch.push_back(std::move(item));
+            }
+            if (!batch.empty()) {
+                handler_(batch);
+                batch.clear();
+                resumeStalled(worker);
+                continue;
+            }
+            resumeStalled(worker);
+            if (!running_) {
+                break;
+            }
+
+            // Park until a producer wakes us; the timeout covers a wakeup racing the park.
+            worker.sleeping = true;
+            {
+                std::unique_lock<std::mutex> lock(worker.wakeMutex);
+                worker.wakeCondition.wait_for(lock, IDLE_WAIT,
+                                              [&]() { return !worker.queue.empty() || !running_; });
+            }
+            worker.sleeping = false;
+        }
+    }
+
+    // Resumes stalled peers; each re-offers its refused frame on its own executor.
+    void ReceivePipeline::resumeStalled(Worker& worker) {
+        if (!worker.hasStalled) {
+            return;
+        }
+        std::vector<std::weak_ptr<Peer>> stalled;
+        {
+            std::lock_guard<std::mutex> lock(worker.stalledMutex);
+            stalled.swap(worker.stalled);
+            worker.hasStalled = false;
+        }
+        for (const auto& weak : stalled) {
+            if (auto peer = weak.lock()) {
+                peer->resumeReceiving();
+            }
+        }
+    }
+
+    // Pins a peer to a worker by mixing its address, whose low bits are always zero.
+    ReceivePipeline::Worker& ReceivePipeline::workerFor(const Peer* peer) {
+        std::uint64_t x = reinterpret_cast<std::uintptr_t>(peer);
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return *workers_[static_cast<std::size_t>(x % workers_.size())];
+    }
+
+}  // namespace network
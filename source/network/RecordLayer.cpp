@@ -0,0 +1,204 @@
+#include "network/RecordLayer.h"
+#include <cstring>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include <stdexcept>
+
+namespace network {
+
+    namespace {
+
+        // Sizes of the per-direction key and nonce salt, and of the full nonce.
+        constexpr std::size_t KEY_SIZE = 32;
+        constexpr std::size_t SALT_SIZE = 4;
+        constexpr std::size_t NONCE_SIZE = 12;
+
+        // Frame header size of a record, authenticated as associated data.
+        constexpr int HEADER_SIZE = 5;
+
+        // HKDF salt binding the derived keys to this protocol.
+        constexpr char KDF_LABEL[] = "p2p record layer v1";
+
+        // Frees a key derivation context on scope exit.
+        struct ContextGuard {
+            EVP_PKEY_CTX* context;
+            ~ContextGuard() {
+                EVP_PKEY_CTX_free(context);
+            }
+        };
+
+        // Wipes secret bytes on scope exit.
+        struct CleanseGuard {
+            void* data;
+            std::size_t size;
+            ~CleanseGuard() {
+                OPENSSL_cleanse(data, size);
+            }
+        };
+
+        // Frees a key on scope exit.
+        struct KeyGuard {
+            EVP_PKEY* key;
+            ~KeyGuard() {
+                EVP_PKEY_free(key);
+            }
+        };
+
+    }  // namespace
+
+    // Expands the key once; records then only set their nonce.
+    RecordCipher::RecordCipher(bool encrypt, std::string_view key, std::string_view salt)
+        : context_(EVP_CIPHER_CTX_new()), salt_(salt), encrypt_(encrypt) {
+        if (!context_ || key.size() != KEY_SIZE || salt.size() != SALT_SIZE ||
+            EVP_CipherInit_ex(context_, EVP_aes_256_gcm(), nullptr,
+                              reinterpret_cast<const unsigned char*>(key.data()), nullptr, encrypt ? 1 : 0) != 1) {
+            EVP_CIPHER_CTX_free(context_);
+            throw std::runtime_error("Failed to set up record cipher");
+        }
+    }
+
+    // Frees the cipher context.
+    RecordCipher::~RecordCipher() {
+        EVP_CIPHER_CTX_free(context_);
+    }
+
+    // AES-GCM encrypts in place: input and output may be the same buffer.
+    void RecordCipher::seal(const char* header, char* data, std::size_t length, char* tag) {
+        beginSeal(header);
+        sealUpdate(data, data, length);
+        finishSeal(tag);
+    }
+
+    // Sets the record's nonce and authenticates its header.
+    void RecordCipher::beginSeal(const char* header) {
+        unsigned char nonce[NONCE_SIZE];
+        nextNonce(nonce);
+        int written = 0;
+        if (EVP_EncryptInit_ex(context_, nullptr, nullptr, nullptr, nonce) != 1 ||
+            EVP_EncryptUpdate(context_, nullptr, &written, reinterpret_cast<const unsigned char*>(header),
+                              HEADER_SIZE) != 1) {
+            throw std::runtime_error("Failed to seal record");
+        }
+    }
+
+    // GCM is a stream mode, so pieces of any length produce exactly as many output bytes.
+    void RecordCipher::sealUpdate(const char* in, char* out, std::size_t length) {
+        int written = 0;
+        if (EVP_EncryptUpdate(context_, reinterpret_cast<unsigned char*>(out), &written,
+                              reinterpret_cast<const unsigned char*>(in), static_cast<int>(length)) != 1) {
+            throw std::runtime_error("Failed to seal record");
+        }
+    }
+
+    // Writes the tag; GCM emits no further ciphertext at the end.
+    void RecordCipher::finishSeal(char* tag) {
+        unsigned char rest[16];
+        int written = 0;
+        if (EVP_EncryptFinal_ex(context_, rest, &written) != 1 ||
+            EVP_CIPHER_CTX_ctrl(context_, EVP_CTRL_GCM_GET_TAG, RECORD_TAG_SIZE, tag) != 1) {
+            throw std::runtime_error("Failed to seal record");
+        }
+    }
+
+    // The tag is checked only once all ciphertext has been processed; the caller must not use
+    // the output unless this returns true.
+    bool RecordCipher::open(const char* header, std::string_view payload, char* out) {
+        if (payload.size() < RECORD_TAG_SIZE) {
+            return false;
+        }
+        std::size_t length = payload.size() - RECORD_TAG_SIZE;
+        unsigned char nonce[NONCE_SIZE];
+        nextNonce(nonce);
+        auto* bytes = reinterpret_cast<unsigned char*>(out);
+        int written = 0;
+        return EVP_DecryptInit_ex(context_, nullptr, nullptr, nullptr, nonce) == 1 &&
+               EVP_DecryptUpdate(context_, nullptr, &written, reinterpret_cast<const unsigned char*>(header),
+                                 HEADER_SIZE) == 1 &&
+               EVP_DecryptUpdate(context_, bytes, &written, reinterpret_cast<const unsigned char*>(payload.data()),
+                                 static_cast<int>(length)) == 1 &&
+               EVP_CIPHER_CTX_ctrl(context_, EVP_CTRL_GCM_SET_TAG, RECORD_TAG_SIZE,
+                                   const_cast<char*>(payload.data() + length)) == 1 &&
+               EVP_DecryptFinal_ex(context_, bytes + written, &written) == 1;
+    }
+
+    // Salt followed by the big-endian record counter.
+    void RecordCipher::nextNonce(unsigned char* nonce) {
+        std::memcpy(nonce, salt_.data(), SALT_SIZE);
+        std::uint64_t counter = counter_++;
+        for (std::size_t i = NONCE_SIZE; i > SALT_SIZE; --i) {
+            nonce[i - 1] = static_cast<unsigned char>(counter & 0xFF);
+            counter >>= 8;
+        }
+    }
+
+    // Generates a fresh X25519 key pair.
+    KeyExchange::KeyExchange() : key_(nullptr), publicKey_(KEY_SHARE_SIZE, '\0') {
+        ContextGuard guard{EVP_PKEY_CTX_new_id(EVP_PKEY_X25519, nullptr)};
+        std::size_t length = publicKey_.size();
+        if (!guard.context || EVP_PKEY_keygen_init(guard.context) != 1 || EVP_PKEY_keygen(guard.context, &key_) != 1 ||
+            EVP_PKEY_get_raw_public_key(key_, reinterpret_cast<unsigned char*>(publicKey_.data()), &length) != 1 ||
+            length != KEY_SHARE_SIZE) {
+            EVP_PKEY_free(key_);
+            throw std::runtime_error("Failed to generate key share");
+        }
+    }
+
+    // Frees the key pair.
+    KeyExchange::~KeyExchange() {
+        EVP_PKEY_free(key_);
+    }
+
+    // Returns the public key to send to the peer.
+    const std::string& KeyExchange::publicKey() const {
+        return publicKey_;
+    }
+
+    // The side whose public key sorts first owns the first key and salt for its sending
+    // direction, so both ends agree on which half seals which way without another message.
+    SessionKeys KeyExchange::derive(std::string_view peerPublicKey) const {
+        if (peerPublicKey.size() != KEY_SHARE_SIZE || peerPublicKey == publicKey_) {
+            throw std::runtime_error("Invalid key share");
+        }
+        KeyGuard peerKey{EVP_PKEY_new_raw_public_key(EVP_PKEY_X25519, nullptr,
+                                                     reinterpret_cast<const unsigned char*>(peerPublicKey.data()),
+                                                     peerPublicKey.size())};
+        ContextGuard agree{EVP_PKEY_CTX_new(key_, nullptr)};
+        unsigned char secret[KEY_SHARE_SIZE];
+        CleanseGuard secretGuard{secret, sizeof(secret)};
+        std::size_t secretLength = sizeof(secret);
+        if (!peerKey.key || !agree.context || EVP_PKEY_derive_init(agree.context) != 1 ||
+            EVP_PKEY_derive_set_peer(agree.context, peerKey.key) != 1 ||
+            EVP_PKEY_derive(agree.context, secret, &secretLength) != 1) {
+            throw std::runtime_error("Key agreement failed");
+        }
+
+        bool first = std::string_view(publicKey_) < peerPublicKey;
+        std::string info = first ? publicKey_ + std::string(peerPublicKey) : std::string(peerPublicKey) + publicKey_;
+        unsigned char material[2 * (KEY_SIZE + SALT_SIZE)];
+        CleanseGuard materialGuard{material, sizeof(material)};
+        std::size_t materialLength = sizeof(material);
+        ContextGuard expand{EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr)};
+        if (!expand.context || EVP_PKEY_derive_init(expand.context) != 1 ||
+            EVP_PKEY_CTX_set_hkdf_md(expand.context, EVP_sha256()) != 1 ||
+            EVP_PKEY_CTX_set1_hkdf_salt(expand.context, reinterpret_cast<const unsigned char*>(KDF_LABEL),
+                                        sizeof(KDF_LABEL) - 1) != 1 ||
+            EVP_PKEY_CTX_set1_hkdf_key(expand.context, secret, static_cast<int>(secretLength)) != 1 ||
+            EVP_PKEY_CTX_add1_hkdf_info(expand.context, reinterpret_cast<const unsigned char*>(info.data()),
+                                        static_cast<int>(info.size())) != 1 ||
+            EVP_PKEY_derive(expand.context, material, &materialLength) != 1) {
+            throw std::runtime_error("Key derivation failed");
+        }
+
+        std::string_view keys(reinterpret_cast<const char*>(material), sizeof(material));
+        std::string_view firstKey = keys.substr(0, KEY_SIZE);
+        std::string_view secondKey = keys.substr(KEY_SIZE, KEY_SIZE);
+        std::string_view firstSalt = keys.substr(2 * KEY_SIZE, SALT_SIZE);
+        std::string_view secondSalt = keys.substr(2 * KEY_SIZE + SALT_SIZE, SALT_SIZE);
+        SessionKeys session;
+        session.sealer = std::make_unique<RecordCipher>(true, first ? firstKey : secondKey, first ? firstSalt : secondSalt);
+        session.opener = std::make_unique<RecordCipher>(false, first ? secondKey : firstKey, first ? secondSalt : firstSalt);
+        return session;
+    }
+
+}  // namespace network
@@ -0,0 +1,72 @@
+#include "network/SeenFilter.h"
+#include <algorithm>
+#include <cstring>
+
+namespace network {
+
+    // Constructs two empty filters.
+    SeenFilter::SeenFilter(unsigned bitsLog2, std::size_t capacity, Clock::duration window)
+        : current_((std::uint64_t{1} << bitsLog2) / 64, 0),
+          previous_(current_.size(), 0),
+          mask_((std::uint64_t{1} << bitsLog2) - 1),
+          capacity_(std::max<std::size_t>(1, capacity)),
+          started_(Clock::now()),
+          window_(window) {}
+
+    // Inserts into the current filter unless either filter already holds the ID.
+    bool SeenFilter::insert(const MessageId& id, Clock::time_point now) {
+        rotateIfDue(now);
+        auto bits = positions(id);
+        if (test(current_, bits) || test(previous_, bits)) {
+            return false;
+        }
+        for (std::uint64_t bit : bits) {
+            current_[bit / 64] |= std::uint64_t{1} << (bit % 64);
+        }
+        ++count_;
+        return true;
+    }
+
+    // Checks both filters.
+    bool SeenFilter::contains(const MessageId& id) const {
+        auto bits = positions(id);
+        return test(current_, bits) || test(previous_, bits);
+    }
+
+    // IDs are random, so their two halves serve directly as independent hashes,
+    // combined by double hashing into the remaining positions.
+    std::array<std::uint64_t, SeenFilter::HASHES> SeenFilter::positions(const MessageId& id) const {
+        std::uint64_t h1;
+        std::uint64_t h2;
+        std::memcpy(&h1, id.data(), sizeof(h1));
+        std::memcpy(&h2, id.data() + sizeof(h1), sizeof(h2));
+        h2 |= 1;
+        std::array<std::uint64_t, HASHES> bits;
+        for (unsigned i = 0; i < HASHES; ++i) {
+            bits[i] = (h1 + i * h2) & mask_;
+        }
+        return bits;
+    }
+
+    // Returns true if every position is set.
+    bool SeenFilter::test(const std::vector<std::uint64_t>& filter, const std::array<std::uint64_t, HASHES>& bits) {
+        for (std::uint64_t bit : bits) {
+            if (!(filter[bit / 64] & (std::uint64_t{1} << (bit % 64)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Retires the previous filter's IDs and starts a fresh current one.
+    void SeenFilter::rotateIfDue(Clock::time_point now) {
+        if (count_ < capacity_ && now - started_ < window_) {
+            return;
+        }
+        std::swap(current_, previous_);
+        std::fill(current_.begin(), current_.end(), 0);
+        count_ = 0;
+        started_ = now;
+    }
+
+}  // namespace network
@@ -0,0 +1,158 @@
+#include "network/Subscriptions.h"
+#include "message/Codec.h"
+#include <stdexcept>
+
+namespace network {
+
+    namespace {
+
+        // Splits a topic or pattern into its segments.
+        std::vector<std::string_view> splitTopic(std::string_view topic) {
+            std::vector<std::string_view> segments;
+            while (true) {
+                std::size_t end = topic.find(TOPIC_SEPARATOR);
+                segments.push_back(topic.substr(0, end));
+                if (end == std::string_view::npos) {
+                    return segments;
+                }
+                topic.remove_prefix(end + 1);
+            }
+        }
+
+    }  // namespace
+
+    // '#' must be the last segment.
+    bool isValidTopicPattern(std::string_view pattern) {
+        auto segments = splitTopic(pattern);
+        for (std::size_t i = 0; i + 1 < segments.size(); ++i) {
+            if (segments[i] == "#") {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Walks pattern and topic segments side by side.
+    bool topicMatches(std::string_view pattern, std::string_view topic) {
+        auto want = splitTopic(pattern);
+        auto have = splitTopic(topic);
+        for (std::size_t i = 0; i < want.size(); ++i) {
+            if (want[i] == "#") {
+                return i + 1 == want.size();
+            }
+            if (i == have.size() || (want[i] != "*" && want[i] != have[i])) {
+                return false;
+            }
+        }
+        return want.size() == have.size();
+    }
+
+    // Appends the binary encoding to out.
+    void Subscribe::encode(std::string& out) const {
+        message::putVarint(out, patterns.size());
+        for (const auto& pattern : patterns) {
+            message::putBytes(out, pattern);
+        }
+    }
+
+    // Decodes an announcement; the count is checked against the bytes left before reserving.
+    Subscribe Subscribe::decode(std::string_view data) {
+        message::ByteReader reader(data);
+        Subscribe subscribe;
+        std::uint64_t count = reader.readVarint();
+        if (count > reader.remaining()) {
+            throw std::runtime_error("Subscription count exceeds payload");
+        }
+        subscribe.patterns.reserve(count);
+        for (std::uint64_t i = 0; i < count; ++i) {
+            subscribe.patterns.emplace_back(reader.readBytes());
+        }
+        return subscribe;
+    }
+
+    // Returns true for subscribers and for peers not in the index.
+    bool SubscriptionIndex::Match::wants(const Peer* peer) const {
+        return peers_.count(peer) || !table_->patterns.count(peer);
+    }
+
+    // Constructs an empty index.
+    SubscriptionIndex::SubscriptionIndex() : table_(std::make_shared<const Table>()) {}
+
+    // Rebuilds the trie with the peer's new patterns and publishes it.
+    void SubscriptionIndex::set(const Peer* peer, const std::vector<std::string>& patterns) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto table = std::make_shared<Table>();
+        table->patterns = std::atomic_load(&table_)->patterns;
+        auto& own = table->patterns[peer];
+        own.clear();
+        for (const auto& pattern : patterns) {
+            if (isValidTopicPattern(pattern)) {
+                own.push_back(pattern);
+            }
+        }
+        build(*table);
+        std::atomic_store(&table_, std::shared_ptr<const Table>(std::move(table)));
+    }
+
+    // Rebuilds the trie without the peer and publishes it.
+    void SubscriptionIndex::remove(const Peer* peer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto current = std::atomic_load(&table_);
+        if (!current->patterns.count(peer)) {
+            return;
+        }
+        auto table = std::make_shared<Table>();
+        table->patterns = current->patterns;
+        table->patterns.erase(peer);
+        build(*table);
+        std::atomic_store(&table_, std::shared_ptr<const Table>(std::move(table)));
+    }
+
+    // Collects the subscribers from the current snapshot, which the match keeps alive.
+    SubscriptionIndex::Match SubscriptionIndex::match(std::string_view topic) const {
+        Match result;
+        result.table_ = std::atomic_load(&table_);
+        collect(result.table_->root, splitTopic(topic), 0, result.peers_);
+        return result;
+    }
+
+    // Inserts every pattern segment by segment.
+    void SubscriptionIndex::build(Table& table) {
+        for (const auto& [peer, patterns] : table.patterns) {
+            for (const auto& pattern : patterns) {
+                Node* node = &table.root;
+                bool rest = false;
+                for (std::string_view segment : splitTopic(pattern)) {
+                    if (segment == "#") {
+                        rest = true;
+                        break;
+                    }
+                    auto& child = segment == "*" ? node->anySegment : node->children[std::string(segment)];
+                    if (!child) {
+                        child = std::make_unique<Node>();
+                    }
+                    node = child.get();
+                }
+                (rest ? node->rest : node->exact).insert(peer);
+            }
+        }
+    }
+
+    // A '#' subscriber at this level takes the remaining segments, however many there are.
+    void SubscriptionIndex::collect(const Node& node, const std::vector<std::string_view>& segments,
+                                    std::size_t i, std::unordered_set<const Peer*>& out) {
+        out.insert(node.rest.begin(), node.rest.end());
+        if (i == segments.size()) {
+            out.insert(node.exact.begin(), node.exact.end());
+            return;
+        }
+        auto it = node.children.find(std::string(segments[i]));
+        if (it != node.children.end()) {
+            collect(*it->second, segments, i + 1, out);
+        }
+        if (node.anySegment) {
+            collect(*node.anySegment, segments, i + 1, out);
+        }
+    }
+
+}  // namespace network
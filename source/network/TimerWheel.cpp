@@ -0,0 +1,83 @@
+#include "network/TimerWheel.h"
+#include <algorithm>
+#include <utility>
+
+namespace network {
+
+    // Constructs an empty wheel.
+    TimerWheel::TimerWheel(Clock::duration tick, Clock::time_point now)
+        : tick_(std::max(tick, Clock::duration(1))), start_(now) {}
+
+    // Converts the delay to ticks, rounding up so a timer never fires early.
+    void TimerWheel::schedule(Clock::duration delay, std::function<void()> callback) {
+        std::uint64_t range = (std::uint64_t{1} << (SLOT_BITS * LEVELS)) - 1;
+        auto ticks = static_cast<std::uint64_t>(std::max<Clock::rep>(0, (delay + tick_ - Clock::duration(1)) / tick_));
+        ticks = std::clamp<std::uint64_t>(ticks, 1, range);
+        insert(Timer{current_ + ticks, std::move(callback)});
+        ++size_;
+    }
+
+    // Steps through every tick that has elapsed since the last call.
+    void TimerWheel::advance(Clock::time_point now) {
+        if (now < start_) {
+            return;
+        }
+        auto target = static_cast<std::uint64_t>((now - start_) / tick_);
+        while (current_ < target) {
+            step();
+        }
+    }
+
+    // Returns the number of pending timers.
+    std::size_t TimerWheel::size() const {
+        return size_;
+    }
+
+    // Returns the tick length.
+    TimerWheel::Clock::duration TimerWheel::tick() const {
+        return tick_;
+    }
+
+    // Picks the lowest level whose span covers the remaining ticks; the slot is taken from the
+    // deadline's bits at that level, so it comes round exactly when the deadline's block starts.
+    void TimerWheel::insert(Timer timer) {
+        std::uint64_t remaining = timer.deadline > current_ ? timer.deadline - current_ : 0;
+        std::size_t level = 0;
+        while (level + 1 < LEVELS && remaining >= (std::uint64_t{1} << (SLOT_BITS * (level + 1)))) {
+            ++level;
+        }
+        std::uint64_t deadline = std::max(timer.deadline, current_);
+        std::size_t slot = static_cast<std::size_t>((deadline >> (SLOT_BITS * level)) & (SLOTS - 1));
+        slots_[level][slot].push_back(std::move(timer));
+    }
+
+    // Cascades from the highest level that wrapped on this tick downwards, so timers moved out of
+    // a high level can land in a lower slot that is cascaded or run within the same tick.
+    void TimerWheel::step() {
+        ++current_;
+        std::size_t top = 0;
+        while (top + 1 < LEVELS && (current_ & ((std::uint64_t{1} << (SLOT_BITS * (top + 1))) - 1)) == 0) {
+            ++top;
+        }
+        for (std::size_t level = top; level > 0; --level) {
+            auto& slot = slots_[level][(current_ >> (SLOT_BITS * level)) & (SLOTS - 1)];
+            std::vector<Timer> moving;
+            moving.swap(slot);
+            for (auto& timer : moving) {
+                insert(std::move(timer));
+            }
+        }
+
+        std::vector<Timer> due;
+        due.swap(slots_[0][current_ & (SLOTS - 1)]);
+        for (auto& timer : due) {
+            if (timer.deadline > current_) {
+                insert(std::move(timer));
+                continue;
+            }
+            --size_;
+            timer.callback();
+        }
+    }
+
+}  // namespace network
@@ -0,0 +1,261 @@
+#include "storage/ChunkStore.h"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace storage {
+
+    namespace {
+
+        // Reads exactly length bytes at offset into out. Returns false on a short read or error.
+        bool readAt(int fd, std::uint64_t offset, std::uint32_t length, std::string& out) {
+            out.resize(length);
+            std::size_t done = 0;
+            while (done < length) {
+                ssize_t n = ::pread(fd, out.data() + done, length - done, static_cast<off_t>(offset + done));
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    return false;
+                }
+                done += static_cast<std::size_t>(n);
+            }
+            return true;
+        }
+
+        // Returns the absolute, normalized form of path, as stored in the index.
+        std::string normalizePath(const std::string& path) {
+            return std::filesystem::absolute(path).lexically_normal().string();
+        }
+
+    }  // namespace
+
+    // Constructs a store whose index lives in directory and loads it.
+    ChunkStore::ChunkStore(const std::string& directory) : indexPath_(directory + "/index") {
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        load();
+    }
+
+    // Hashes the file chunk by chunk, indexing each chunk where it lies in the file.
+    message::Manifest ChunkStore::addFile(const std::string& path, std::uint32_t chunkSize) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        std::uint64_t size = static_cast<std::uint64_t>(::lseek(fd, 0, SEEK_END));
+        std::string absolute = normalizePath(path);
+        std::vector<Digest> digests;
+        digests.reserve(static_cast<std::size_t>((size + chunkSize - 1) / chunkSize));
+        std::string buffer;
+        for (std::uint64_t offset = 0; offset < size; offset += chunkSize) {
+            auto length = static_cast<std::uint32_t>(std::min<std::uint64_t>(chunkSize, size - offset));
+            if (!readAt(fd, offset, length, buffer)) {
+                ::close(fd);
+                throw std::runtime_error("Cannot read " + path);
+            }
+            digests.push_back(sha256(buffer));
+        }
+        ::close(fd);
+
+        for (std::size_t i = 0; i < digests.size(); ++i) {
+            std::uint64_t offset = static_cast<std::uint64_t>(i) * chunkSize;
+            add(digests[i], ChunkLocation{absolute, offset,
+                                          static_cast<std::uint32_t>(std::min<std::uint64_t>(chunkSize, size - offset))});
+        }
+        return message::Manifest(std::filesystem::path(path).filename().string(), size, chunkSize, std::move(digests));
+    }
+
+    // Records a location of a chunk unless it is already known.
+    void ChunkStore::add(const Digest& digest, const ChunkLocation& location) {
+        ChunkLocation normalized{normalizePath(location.path), location.offset, location.length};
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& locations = chunks_[digest];
+        if (std::find(locations.begin(), locations.end(), normalized) != locations.end()) {
+            return;
+        }
+        locations.push_back(normalized);
+        appendEntry(digest, normalized);
+    }
+
+    // Returns the first known location of the chunk.
+    std::optional<ChunkLocation> ChunkStore::find(const Digest& digest) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = chunks_.find(digest);
+        if (it == chunks_.end() || it->second.empty()) {
+            return std::nullopt;
+        }
+        return it->second.front();
+    }
+
+    // Returns true if location is a known location of the chunk.
+    bool ChunkStore::contains(const Digest& digest, const ChunkLocation& location) const {
+        ChunkLocation normalized{normalizePath(location.path), location.offset, location.length};
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = chunks_.find(digest);
+        return it != chunks_.end() &&
+               std::find(it->second.begin(), it->second.end(), normalized) != it->second.end();
+    }
+
+    // Re-hashes the chunk at location, dropping the location on mismatch.
+    bool ChunkStore::verify(const Digest& digest, const ChunkLocation& location) {
+        std::string buffer;
+        if (readVerified(digest, location, buffer)) {
+            return true;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        dropLocked(digest, ChunkLocation{normalizePath(location.path), location.offset, location.length});
+        rewrite();
+        return false;
+    }
+
+    // Tries each known location in turn; the file I/O happens without the lock held.
+    bool ChunkStore::read(const Digest& digest, std::string& out) {
+        std::vector<ChunkLocation> locations;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = chunks_.find(digest);
+            if (it == chunks_.end()) {
+                return false;
+            }
+            locations = it->second;
+        }
+        std::vector<ChunkLocation> stale;
+        bool found = false;
+        for (const auto& location : locations) {
+            if (readVerified(digest, location, out)) {
+                found = true;
+                break;
+            }
+            stale.push_back(location);
+        }
+        if (!stale.empty()) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& location : stale) {
+                dropLocked(digest, location);
+            }
+            rewrite();
+        }
+        return found;
+    }
+
+    // Moves every location in file from to file to.
+    void ChunkStore::relocate(const std::string& from, const std::string& to) {
+        std::string absoluteFrom = normalizePath(from);
+        std::string absoluteTo = normalizePath(to);
+        std::lock_guard<std::mutex> lock(mutex_);
+        bool changed = false;
+        for (auto& [digest, locations] : chunks_) {
+            for (auto& location : locations) {
+                if (location.path == absoluteFrom) {
+                    location.path = absoluteTo;
+                    changed = true;
+                }
+            }
+        }
+        if (changed) {
+            rewrite();
+        }
+    }
+
+    // Returns the number of distinct chunks indexed.
+    std::size_t ChunkStore::size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return chunks_.size();
+    }
+
+    // Reads the persisted index; later duplicates and malformed lines are dropped by a rewrite.
+    void ChunkStore::load() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::size_t lines = 0;
+        std::size_t entries = 0;
+        {
+            std::ifstream file(indexPath_);
+            std::string line;
+            while (std::getline(file, line)) {
+                ++lines;
+                std::istringstream iss(line);
+                std::string hex;
+                ChunkLocation location;
+                Digest digest;
+                if (!(iss >> hex >> location.offset >> location.length) || !fromHex(hex, digest)) {
+                    continue;
+                }
+                iss.get();
+                std::getline(iss, location.path);
+                if (location.path.empty()) {
+                    continue;
+                }
+                auto& locations = chunks_[digest];
+                if (std::find(locations.begin(), locations.end(), location) == locations.end()) {
+                    locations.push_back(std::move(location));
+                    ++entries;
+                }
+            }
+        }
+        if (entries != lines) {
+            rewrite();
+        } else {
+            indexFile_.open(indexPath_, std::ios::app);
+        }
+    }
+
+    // Rewrites the persisted index via a temporary file.
+    void ChunkStore::rewrite() {
+        indexFile_.close();
+        std::string tempPath = indexPath_ + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::trunc);
+            for (const auto& [digest, locations] : chunks_) {
+                for (const auto& location : locations) {
+                    file << toHex(digest) << ' ' << location.offset << ' ' << location.length << ' '
+                         << location.path << '\n';
+                }
+            }
+        }
+        std::error_code ec;
+        std::filesystem::rename(tempPath, indexPath_, ec);
+        if (ec) {
+            std::cerr << "Failed to write chunk index " << indexPath_ << "\n";
+        }
+        indexFile_.open(indexPath_, std::ios::app);
+    }
+
+    // Appends one entry to the persisted index.
+    void ChunkStore::appendEntry(const Digest& digest, const ChunkLocation& location) {
+        indexFile_ << toHex(digest) << ' ' << location.offset << ' ' << location.length << ' '
+                   << location.path << '\n';
+        indexFile_.flush();
+    }
+
+    // Drops a location, and the chunk once it has none left.
+    void ChunkStore::dropLocked(const Digest& digest, const ChunkLocation& location) {
+        auto it = chunks_.find(digest);
+        if (it == chunks_.end()) {
+            return;
+        }
+        auto& locations = it->second;
+        locations.erase(std::remove(locations.begin(), locations.end(), location), locations.end());
+        if (locations.empty()) {
+            chunks_.erase(it);
+        }
+    }
+
+    // Reads location into out and checks it hashes to digest.
+    bool ChunkStore::readVerified(const Digest& digest, const ChunkLocation& location, std::string& out) {
+        int fd = ::open(location.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = readAt(fd, location.offset, location.length, out) && sha256(out) == digest;
+        ::close(fd);
+        return ok;
+    }
+
+}  // namespace storage
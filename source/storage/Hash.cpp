@@ -0,0 +1,51 @@
+#include "storage/Hash.h"
+#include <openssl/evp.h>
+#include <stdexcept>
+
+namespace storage {
+
+    // Returns the SHA-256 digest of data.
+    Digest sha256(std::string_view data) {
+        Digest digest;
+        unsigned int length = 0;
+        if (!EVP_Digest(data.data(), data.size(), digest.data(), &length, EVP_sha256(), nullptr)) {
+            throw std::runtime_error("SHA-256 failed");
+        }
+        return digest;
+    }
+
+    // Returns the lowercase hexadecimal form of a digest.
+    std::string toHex(const Digest& digest) {
+        static const char DIGITS[] = "0123456789abcdef";
+        std::string hex;
+        hex.reserve(digest.size() * 2);
+        for (std::uint8_t byte : digest) {
+            hex.push_back(DIGITS[byte >> 4]);
+            hex.push_back(DIGITS[byte & 0x0F]);
+        }
+        return hex;
+    }
+
+    // Parses a digest from its hexadecimal form.
+    bool fromHex(std::string_view hex, Digest& digest) {
+        if (hex.size() != digest.size() * 2) {
+            return false;
+        }
+        auto nibble = [](char c) -> int {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        };
+        for (std::size_t i = 0; i < digest.size(); ++i) {
+            int high = nibble(hex[2 * i]);
+            int low = nibble(hex[2 * i + 1]);
+            if (high < 0 || low < 0) {
+                return false;
+            }
+            digest[i] = static_cast<std::uint8_t>((high << 4) | low);
+        }
+        return true;
+    }
+
+}  // namespace storage
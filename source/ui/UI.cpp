@@ -1,12 +1,25 @@
 #include "ui/UI.h"
+#include "metrics/Registry.h"
 #include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <limits>
+#include <optional>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 namespace ui {
 
+    namespace {
+
+        // Messages listed per inbox page.
+        constexpr std::size_t INBOX_PAGE_SIZE = 20;
+
+    }  // namespace
+
     // Constructs the UI with a reference to the NetworkManager.
     UI::UI(network::NetworkManager& net) : net_(net), logger_(logging::LogManager::instance()) {}
 
@@ -36,6 +49,21 @@ namespace ui {
                 case 5:
                     inboxMenu();
                     break;
+                case 6:
+                    sendFileMenu();
+                    break;
+                case 7:
+                    transfersMenu();
+                    break;
+                case 8:
+                    gossipMessageMenu();
+                    break;
+                case 9:
+                    subscriptionsMenu();
+                    break;
+                case 10:
+                    statsMenu();
+                    break;
                 case 0:
                     return;
                 default:
@@ -70,6 +98,11 @@ namespace ui {
         std::cout << "3. Send message\n";
         std::cout << "4. Broadcast message\n";
         std::cout << "5. Inbox\n";
+        std::cout << "6. Send file\n";
+        std::cout << "7. File transfers\n";
+        std::cout << "8. Gossip message to the network\n";
+        std::cout << "9. Topic subscriptions\n";
+        std::cout << "10. Stats\n";
         std::cout << "0. Exit\n";
         std::cout << "-------------------\n";
     }
@@ -127,9 +160,18 @@ namespace ui {
         std::string content;
         std::getline(std::cin, content);
         message::Message msg(net_.getListeningAddress(), topic, content, message::MessageType::SENT);
-        logging::LogManager::instance().appendMessage(msg);
-        net_.sendMessage(peerAddr, msg.encode());
-        std::cout << "Message sent and logged.\n";
+        if (!logging::LogManager::instance().appendMessage(msg)) {
+            std::cout << "Warning: the message could not be written to the log.\n";
+        }
+        network::SendStatus status = net_.sendMessage(peerAddr, msg.encode());
+        if (status == network::SendStatus::DROPPED) {
+            std::cout << "Message logged but dropped: the peer is not reading its messages.\n";
+        } else {
+            std::cout << "Message sent and logged.\n";
+            if (status == network::SendStatus::CONGESTED) {
+                std::cout << "Warning: the peer is falling behind.\n";
+            }
+        }
         std::cout << "-------------------\n";
     }
 
@@ -153,18 +195,193 @@ namespace ui {
         std::string content;
         std::getline(std::cin, content);
         message::Message msg(net_.getListeningAddress(), topic, content, message::MessageType::SENT);
-        logging::LogManager::instance().appendMessage(msg);
-        net_.broadcastMessage(msg.encode());
-        std::cout << "Message broadcasted to all peers and logged.\n";
+        if (!logging::LogManager::instance().appendMessage(msg)) {
+            std::cout << "Warning: the message could not be written to the log.\n";
+        }
+        std::size_t backlogged = net_.broadcastMessage(msg.encode());
+        std::cout << "Message broadcasted to subscribed peers and logged.\n";
+        if (backlogged > 0) {
+            std::cout << "Warning: " << backlogged << " peer(s) are falling behind or dropped it.\n";
+        }
+        std::cout << "-------------------\n";
+    }
+
+    // Handles the menu for gossiping a message to the whole network.
+    void UI::gossipMessageMenu() {
+        std::cout << "\n-------------------\n";
+        auto peers = net_.listPeerInfo();
+        if (peers.empty()) {
+            std::cout << "No connected peers available to gossip to.\n";
+            return;
+        }
+
+        // Get message details.
+        std::cout << "Enter topic: ";
+        std::string topic;
+        std::getline(std::cin, topic);
+        if (topic.empty()) {
+            topic = "(empty)"; // Placeholder for empty topics.
+        }
+        std::cout << "Enter message content: ";
+        std::string content;
+        std::getline(std::cin, content);
+        message::Message msg(net_.getListeningAddress(), topic, content, message::MessageType::SENT);
+        if (!logging::LogManager::instance().appendMessage(msg)) {
+            std::cout << "Warning: the message could not be written to the log.\n";
+        }
+        std::size_t sent = net_.gossipMessage(msg.encode());
+        if (sent == 0) {
+            std::cout << "Message logged but not sent: no connected peer accepts gossip.\n";
+        } else {
+            std::cout << "Message gossiped via " << sent << " peer(s) and logged.\n";
+        }
+        std::cout << "-------------------\n";
+    }
+
+    // Handles the menu for offering a file to a specific peer.
+    void UI::sendFileMenu() {
+        std::cout << "\n-------------------\n";
+        std::cout << "Enter peer address: ";
+        std::string peerAddr;
+        std::getline(std::cin, peerAddr);
+        std::cout << "Enter file path: ";
+        std::string path;
+        std::getline(std::cin, path);
+        try {
+            if (net_.sendFile(peerAddr, path)) {
+                std::cout << "File offered to " << peerAddr << ".\n";
+            } else {
+                std::cout << "Error: Peer " << peerAddr << " is not connected.\n";
+            }
+        } catch (const std::exception& e) {
+            std::cout << "Error: " << e.what() << "\n";
+        }
+        std::cout << "-------------------\n";
+    }
+
+    // Displays active and recently finished file transfers.
+    void UI::transfersMenu() {
+        auto transfers = net_.listTransferInfo();
+        std::cout << "\n-------------------\n";
+        if (transfers.empty()) {
+            std::cout << "No file transfers.\n";
+            std::cout << "-------------------\n";
+            return;
+        }
+        for (size_t i = 0; i < transfers.size(); ++i) {
+            std::cout << i + 1 << ". " << transfers[i] << "\n";
+        }
+        std::cout << "-------------------\n";
+    }
+
+    // Displays the subscribed topic patterns with options to add or remove one.
+    void UI::subscriptionsMenu() {
+        std::cout << "\n-------------------\n";
+        std::cout << "Subscribed topics:\n";
+        auto topics = net_.listSubscriptions();
+        if (topics.empty()) {
+            std::cout << "(none)\n";
+        }
+        for (const auto& topic : topics) {
+            std::cout << "  " << topic << "\n";
+        }
+        std::cout << "Patterns use '/' between segments, '*' for any one segment and a final '#' for the rest.\n";
+        std::cout << "1. Subscribe\n";
+        std::cout << "2. Unsubscribe\n";
+        std::cout << "0. Back\n";
+        std::cout << "-------------------\n";
+        int choice;
+        std::cin >> choice;
+        // Clear input buffer after reading integer.
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (choice != 1 && choice != 2) {
+            if (choice != 0) {
+                invalidOptionMenu();
+            }
+            return;
+        }
+        std::cout << "Enter topic pattern: ";
+        std::string pattern;
+        std::getline(std::cin, pattern);
+        if (choice == 1) {
+            if (net_.subscribeTopic(pattern)) {
+                std::cout << "Subscribed to " << pattern << ".\n";
+            } else {
+                std::cout << "Error: " << pattern << " is invalid or already subscribed.\n";
+            }
+        } else if (net_.unsubscribeTopic(pattern)) {
+            std::cout << "Unsubscribed from " << pattern << ".\n";
+        } else {
+            std::cout << "Error: Not subscribed to " << pattern << ".\n";
+        }
         std::cout << "-------------------\n";
     }
 
+    // Displays per-peer traffic and node-wide counters, with an option to export them.
+    // Latencies are bucket estimates, shown in milliseconds.
+    void UI::statsMenu() {
+        auto millis = [](double ns) { return ns / 1e6; };
+        std::cout << "\n-------------------\n";
+        std::cout << std::fixed << std::setprecision(2);
+        auto peers = net_.listPeers();
+        if (peers.empty()) {
+            std::cout << "No peers connected.\n";
+        }
+        for (const auto& peer : peers) {
+            network::PeerCounters c = peer->counters();
+            auto writes = peer->writeLatency().snapshot();
+            std::cout << peer->getPeerID() << "\n";
+            std::cout << "  In:  " << c.messagesReceived << " messages, " << c.bytesReceived << " bytes\n";
+            std::cout << "  Out: " << c.messagesSent << " messages, " << c.bytesSent << " bytes, " << c.queuedFrames
+                      << " queued (" << c.queuedBytes << " bytes), " << c.messagesDropped << " dropped\n";
+            std::cout << "  Writes: p50 " << millis(writes.quantile(0.5)) << " ms, p99 "
+                      << millis(writes.quantile(0.99)) << " ms\n";
+        }
+        auto& registry = metrics::Registry::instance();
+        if (const auto* failures = registry.findCounter("p2p_decode_failures_total")) {
+            std::cout << "Decode failures: " << failures->value() << "\n";
+        }
+        const auto* appended = registry.findCounter("p2p_log_appended_messages_total");
+        const auto* appends = registry.findHistogram("p2p_log_append_seconds");
+        if (appended && appends) {
+            std::cout << "Log appends: " << appended->value() << " messages, p99 "
+                      << millis(appends->snapshot().quantile(0.99)) << " ms\n";
+        }
+        if (const auto* fsyncs = registry.findHistogram("p2p_log_fsync_seconds")) {
+            auto snapshot = fsyncs->snapshot();
+            std::cout << "Log fsyncs: " << snapshot.count << ", p99 " << millis(snapshot.quantile(0.99)) << " ms\n";
+        }
+        std::cout << std::defaultfloat;
+        std::cout << "1. Export to logs/metrics.prom\n";
+        std::cout << "0. Back\n";
+        std::cout << "-------------------\n";
+        int choice;
+        std::cin >> choice;
+        // Clear input buffer after reading integer.
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (choice != 1) {
+            if (choice != 0) {
+                invalidOptionMenu();
+            }
+            return;
+        }
+        std::ofstream out("logs/metrics.prom", std::ios::trunc);
+        out << registry.exportText();
+        if (out.flush()) {
+            std::cout << "Exported to logs/metrics.prom\n";
+        } else {
+            std::cout << "Export failed.\n";
+        }
+    }
+
     // Displays the inbox with options to view sent or received messages.
     void UI::inboxMenu() {
         std::cout << "\n-------------------\n";
         std::cout << "Inbox Menu:\n";
         std::cout << "1. View Sent\n";
         std::cout << "2. View Received\n";
+        std::cout << "3. Export to text\n";
+        std::cout << "4. Search\n";
         std::cout << "0. Back\n";
         std::cout << "-------------------\n";
         int choice;
@@ -173,10 +390,16 @@ namespace ui {
         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
         switch (choice) {
             case 1:
-                viewSent();
+                viewMessages(true);
                 break;
             case 2:
-                viewReceived();
+                viewMessages(false);
+                break;
+            case 3:
+                exportMenu();
+                break;
+            case 4:
+                searchMenu();
                 break;
             case 0:
                 return;
@@ -186,97 +409,151 @@ namespace ui {
         }
     }
 
-    // Displays the list of sent messages and allows viewing or deleting.
-    // Uses readAll() for simplicity, though direct access to sentMessages_ would be more efficient.
-    void UI::viewSent() {
-        auto messages = logger_.getSentStrings();
-        std::cout << "\n-------------------\n";
-        if (messages.empty()) {
-            std::cout << "No sent messages.\n";
-            std::cout << "-------------------\n";
-            return;
-        }
-        for (size_t i = 0; i < messages.size(); ++i) {
-            std::cout << i + 1 << ". " << messages[i] << "\n";
-        }
-
-        // Get user selection.
-        std::cout << "Enter message number to open, 0 to back: ";
-        size_t choice;
-        std::cin >> choice;
-        std::cout << "\n-------------------\n";
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        if (choice == 0 || choice > messages.size()) {
-            return;
-        }
-
-        // Filter sent messages (inefficient but simple).
-        auto sentMessages = logger_.readAll();
-        std::vector<message::Message> sentOnly;
-        for (const auto& msg : sentMessages) {
-            if (msg.getType() == message::MessageType::SENT) {
-                sentOnly.push_back(msg);
+    // Lists one page of sent or received messages in timestamp order, with paging, filters and
+    // an option to open or delete a message. Only the shown page is read from the log.
+    void UI::viewMessages(bool sent) {
+        logging::MessageQuery query;
+        query.sent = sent;
+        query.limit = INBOX_PAGE_SIZE;
+        while (true) {
+            auto page = logger_.queryMessages(query);
+            if (page.total > 0 && query.offset >= page.total) {
+                query.offset = (page.total - 1) / INBOX_PAGE_SIZE * INBOX_PAGE_SIZE;
+                continue;
             }
-        }
-        if (choice <= sentOnly.size()) {
-            const auto& msg = sentOnly[choice - 1];
-            std::cout << "Topic: " << msg.getTopic() << "\n";
-            std::cout << "Content: " << msg.getContent() << "\n";
-            std::cout << "Delete this message? (y/n): ";
-            char del;
-            std::cin >> del;
+            bool filtered = query.peer || query.topic || query.fromNs != logging::MessageQuery().fromNs;
             std::cout << "\n-------------------\n";
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            if (del == 'y' || del == 'Y') {
-                logger_.deleteMessage(choice - 1, true);
+            if (page.total == 0) {
+                std::cout << (filtered ? "No matching messages.\n" : sent ? "No sent messages.\n" : "No received messages.\n");
+            } else {
+                std::cout << (sent ? "Sent" : "Received") << " messages " << query.offset + 1 << "-"
+                          << query.offset + page.handles.size() << " of " << page.total
+                          << (filtered ? " (filtered)" : "") << ":\n";
+            }
+            for (std::size_t i = 0; i < page.handles.size(); ++i) {
+                try {
+                    std::cout << query.offset + i + 1 << ". " << logger_.getMessage(page.handles[i]).toString() << "\n";
+                } catch (const std::out_of_range&) {
+                    // Deleted meanwhile through the control socket.
+                }
+            }
+
+            // Get user selection.
+            std::cout << "Enter message number to open, n/p for next/previous page, f to filter, 0 to back: ";
+            std::string choice;
+            std::getline(std::cin, choice);
+            std::cout << "\n-------------------\n";
+            if (choice == "n") {
+                if (query.offset + INBOX_PAGE_SIZE < page.total) {
+                    query.offset += INBOX_PAGE_SIZE;
+                }
+                continue;
+            }
+            if (choice == "p") {
+                query.offset -= std::min(query.offset, INBOX_PAGE_SIZE);
+                continue;
+            }
+            if (choice == "f") {
+                filterMenu(query);
+                continue;
             }
+            std::size_t number = 0;
+            try {
+                number = static_cast<std::size_t>(std::stoul(choice));
+            } catch (...) {
+            }
+            if (number <= query.offset || number > query.offset + page.handles.size()) {
+                return;
+            }
+            openMessage(page.handles[number - query.offset - 1]);
+        }
+    }
+
+    // Sets the peer, topic and age filters of a query and returns to its first page.
+    void UI::filterMenu(logging::MessageQuery& query) {
+        std::string input;
+        std::cout << "Peer (empty for any): ";
+        std::getline(std::cin, input);
+        query.peer = input.empty() ? std::nullopt : std::optional<std::string>(input);
+        std::cout << "Topic (empty for any): ";
+        std::getline(std::cin, input);
+        query.topic = input.empty() ? std::nullopt : std::optional<std::string>(input);
+        std::cout << "Only the last N minutes (empty for any): ";
+        std::getline(std::cin, input);
+        query.fromNs = logging::MessageQuery().fromNs;
+        try {
+            auto minutes = std::chrono::minutes(std::stol(input));
+            query.fromNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                (std::chrono::system_clock::now() - minutes).time_since_epoch()).count();
+        } catch (...) {
+            // Any age.
         }
+        query.offset = 0;
     }
 
-    // Displays the list of received messages and allows viewing or deleting.
-    // Uses readAll() for simplicity, though direct access to receivedMessages_ would be more efficient.
-    void UI::viewReceived() {
-        auto messages = logger_.getReceivedStrings();
+    // Lists the best matches in both logs, best first, with an option to open one.
+    void UI::searchMenu() {
         std::cout << "\n-------------------\n";
-        if (messages.empty()) {
-            std::cout << "No received messages.\n";
+        std::cout << "Search for: ";
+        std::string text;
+        std::getline(std::cin, text);
+        auto results = logger_.searchMessages(text, INBOX_PAGE_SIZE);
+        if (results.hits.empty()) {
+            std::cout << "No matching messages.\n";
             std::cout << "-------------------\n";
             return;
         }
-        for (size_t i = 0; i < messages.size(); ++i) {
-            std::cout << i + 1 << ". " << messages[i] << "\n";
+        std::cout << results.total << " matching messages, best " << results.hits.size() << ":\n";
+        for (std::size_t i = 0; i < results.hits.size(); ++i) {
+            const auto& handle = results.hits[i].handle;
+            try {
+                std::cout << i + 1 << ". " << (handle.sent ? "[sent] " : "[received] ")
+                          << logger_.getMessage(handle).toString() << "\n";
+            } catch (const std::out_of_range&) {
+                // Deleted meanwhile through the control socket.
+            }
         }
-
-        // Get user selection.
-        std::cout << "Enter message number to open, 0 to back: ";
-        size_t choice;
+        std::cout << "Enter result number to open, 0 to back: ";
+        std::size_t choice = 0;
         std::cin >> choice;
-        std::cout << "\n-------------------\n";
         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        if (choice == 0 || choice > messages.size()) {
+        std::cout << "\n-------------------\n";
+        if (choice == 0 || choice > results.hits.size()) {
             return;
         }
+        openMessage(results.hits[choice - 1].handle);
+    }
 
-        // Filter received messages (inefficient but simple).
-        auto receivedMessages = logger_.readAll();
-        std::vector<message::Message> receivedOnly;
-        for (const auto& msg : receivedMessages) {
-            if (msg.getType() == message::MessageType::RECEIVED) {
-                receivedOnly.push_back(msg);
-            }
+    // Shows a message's topic and content and offers to delete it.
+    void UI::openMessage(const logging::MessageHandle& handle) {
+        std::optional<message::Message> msg;
+        try {
+            msg = logger_.getMessage(handle);
+        } catch (const std::out_of_range&) {
+            std::cout << "The message was deleted.\n";
+            return;
         }
-        if (choice <= receivedOnly.size()) {
-            const auto& msg = receivedOnly[choice - 1];
-            std::cout << "Topic: " << msg.getTopic() << "\n";
-            std::cout << "Content: " << msg.getContent() << "\n";
-            std::cout << "Delete this message? (y/n): ";
-            char del;
-            std::cin >> del;
-            std::cout << "\n-------------------\n";
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            if (del == 'y' || del == 'Y') {
-                logger_.deleteMessage(choice - 1, false);
-            }
+        std::cout << "Topic: " << msg->getTopic() << "\n";
+        std::cout << "Content: " << msg->getContent() << "\n";
+        std::cout << "Delete this message? (y/n): ";
+        char del;
+        std::cin >> del;
+        std::cout << "\n-------------------\n";
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (del == 'y' || del == 'Y') {
+            logger_.deleteMessage(handle);
+        }
+    }
+
+    // Exports both message logs to text files next to the binary logs.
+    void UI::exportMenu() {
+        std::cout << "\n-------------------\n";
+        bool ok = logger_.exportText(true, "logs/messages_sent.txt") &&
+                  logger_.exportText(false, "logs/messages_received.txt");
+        if (ok) {
+            std::cout << "Exported to logs/messages_sent.txt and logs/messages_received.txt\n";
+        } else {
+            std::cout << "Export failed.\n";
         }
         std::cout << "-------------------\n";
     }